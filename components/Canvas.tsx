@@ -13,7 +13,7 @@ import {
   PanGestureHandlerGestureEvent,
 } from 'react-native-gesture-handler';
 import {useCanvas} from '../hooks/useCanvas';
-import {Point, BrushStyle} from '../specs/NativeGestureCanvas';
+import {BrushStyle} from '../specs/NativeGestureCanvas';
 import {CanvasHeader} from './CanvasHeader';
 
 interface CanvasProps {
@@ -35,9 +35,9 @@ export const Canvas: React.FC<CanvasProps> = ({
 
   const {
     canvasState,
-    handleStartDrawing,
-    handleDrawMove,
-    handleEndDrawing,
+    gestureInput,
+    handleGestureStart,
+    handleGestureEnd,
     applyMotion,
     clearCanvas,
     performanceStats,
@@ -80,42 +80,41 @@ export const Canvas: React.FC<CanvasProps> = ({
       cursorScale.value = withSpring(brushStyle.size / 20);
       isDrawing.value = true;
 
-      const point: Point = {
-        x: event.x,
-        y: event.y,
-        pressure: event.pressure || 1,
-        timestamp: new Date().getTime(),
-      };
+      // Straight to the native stroke engine from the UI thread
+      gestureInput?.begin(
+        event.x,
+        event.y,
+        event.pressure || 1,
+        new Date().getTime(),
+      );
 
-      runOnJS(handleStartDrawing)(point);
+      runOnJS(handleGestureStart)();
     },
 
     onActive: (event, ctx) => {
       cursorX.value = event.x;
       cursorY.value = event.y;
 
-      const point: Point = {
-        x: event.x,
-        y: event.y,
-        pressure: event.pressure || 1,
-        timestamp: new Date().getTime(),
-      };
-
-      runOnJS(handleDrawMove)(point);
+      gestureInput?.addPoint(
+        event.x,
+        event.y,
+        event.pressure || 1,
+        new Date().getTime(),
+      );
     },
 
     onEnd: event => {
       cursorScale.value = withSpring(1);
       isDrawing.value = false;
 
-      const point: Point = {
-        x: event.x,
-        y: event.y,
-        pressure: event.pressure || 0.5,
-        timestamp: new Date().getTime(),
-      };
+      gestureInput?.end(
+        event.x,
+        event.y,
+        event.pressure || 0.5,
+        new Date().getTime(),
+      );
 
-      runOnJS(handleEndDrawing)(point);
+      runOnJS(handleGestureEnd)();
     },
   });
 
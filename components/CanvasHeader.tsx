@@ -10,6 +10,7 @@ import Animated, {
 interface CanvasHeaderProps {
   performanceStats: {
     fps: number;
+    rasterP95: number; // ms
   };
 }
 
@@ -60,6 +61,9 @@ export const CanvasHeader: React.FC<CanvasHeaderProps> = ({
               />
               <View style={styles.fpsTextContainer}>
                 <Text style={styles.fpsText}>{performanceStats.fps} FPS</Text>
+                <Text style={styles.fpsText}>
+                  p95 {performanceStats.rasterP95.toFixed(2)} ms
+                </Text>
               </View>
             </View>
           )}
@@ -1,13 +1,18 @@
-import {useState, useEffect, useRef, useCallback} from 'react';
+import {useState, useEffect, useRef, useCallback, useMemo} from 'react';
 import {useWindowDimensions} from 'react-native';
-import NativeGestureCanvas, {
-  BrushStyle,
-  Point,
-} from '../specs/NativeGestureCanvas';
+import NativeGestureCanvas, {BrushStyle} from '../specs/NativeGestureCanvas';
+import {
+  BrushStyleHandle,
+  CanvasHandle,
+  GestureInput,
+  createCanvasHandle,
+  createGestureInput,
+  registerBrushStyle,
+} from '../utils/canvasHandles';
+import {getPerformanceReport} from '../utils/performanceReport';
 
 interface CanvasState {
   canvasId: number | null;
-  strokeId: number | null;
   snapshot: string;
   averageRenderTime: number;
 }
@@ -16,44 +21,72 @@ export const useCanvas = (initialBrushStyle: BrushStyle) => {
   const {width, height} = useWindowDimensions();
   const [canvasState, setCanvasState] = useState<CanvasState>({
     canvasId: null,
-    strokeId: null,
     snapshot: '',
     averageRenderTime: 0,
   });
   const [brushStyle, setBrushStyle] = useState<BrushStyle>(initialBrushStyle);
   const [isDrawing, setIsDrawing] = useState(false);
-  const [performanceStats, setPerformanceStats] = useState({fps: 0});
+  const [performanceStats, setPerformanceStats] = useState({
+    fps: 0,
+    rasterP95: 0,
+  });
+  const [gestureInput, setGestureInput] = useState<GestureInput | null>(null);
 
   const statsTimerRef = useRef<NodeJS.Timeout | null>(null);
-  const currentStrokeIdRef = useRef<number | null>(null);
+  const canvasHandleRef = useRef<CanvasHandle | null>(null);
   const isMountedRef = useRef(true);
+  const snapshotPendingRef = useRef(false);
+  // Resolved natively once per style change rather than once per stroke
+  const brushHandle = useMemo(
+    () => registerBrushStyle(brushStyle),
+    [brushStyle],
+  );
+  const brushHandleRef = useRef<BrushStyleHandle>(brushHandle);
 
   useEffect(() => {
     setBrushStyle(initialBrushStyle);
   }, [initialBrushStyle]);
 
-  const updateSnapshot = useCallback((canvasId: number) => {
-    if (canvasId === null || !isMountedRef.current) return '';
+  useEffect(() => {
+    brushHandleRef.current = brushHandle;
+    gestureInput?.setBrushStyle(brushHandle);
+  }, [gestureInput, brushHandle]);
 
-    const snapshot = NativeGestureCanvas.getCanvasSnapshot(canvasId);
+  const updateSnapshot = useCallback((canvasId: number) => {
+    if (canvasId === null || !isMountedRef.current) return;
 
-    if (isMountedRef.current) {
-      setCanvasState(prev => ({...prev, snapshot}));
-    }
+    // Skip if the previous encode hasn't come back yet
+    if (snapshotPendingRef.current) return;
+    snapshotPendingRef.current = true;
 
-    return snapshot;
+    NativeGestureCanvas.getCanvasSnapshotAsync(canvasId)
+      .then(snapshot => {
+        if (isMountedRef.current && snapshot) {
+          setCanvasState(prev => ({...prev, snapshot}));
+        }
+      })
+      .finally(() => {
+        snapshotPendingRef.current = false;
+      });
   }, []);
 
+  // The canvas outlives dimension changes; it is created at the size of the
+  // first render and redrawn natively from its strokes on every change
+  const canvasSizeRef = useRef({width, height});
+
   useEffect(() => {
     isMountedRef.current = true;
 
-    const canvasId = NativeGestureCanvas.createCanvas({
-      width,
-      height,
+    const canvasHandle = createCanvasHandle({
+      ...canvasSizeRef.current,
       backgroundColor: '#FFFFFF',
     });
+    canvasHandleRef.current = canvasHandle;
+    const canvasId = canvasHandle.id;
 
     setCanvasState(prev => ({...prev, canvasId}));
+    const input = createGestureInput(canvasId, brushHandleRef.current);
+    setGestureInput(input);
 
     statsTimerRef.current = setInterval(() => {
       if (canvasId !== null && isMountedRef.current) {
@@ -61,7 +94,9 @@ export const useCanvas = (initialBrushStyle: BrushStyle) => {
         const fps =
           renderTime > 0 ? Math.min(60, Math.round(1000 / renderTime)) : 0;
 
-        setPerformanceStats({fps});
+        const rasterP95 = getPerformanceReport().strokeRaster.p95;
+
+        setPerformanceStats({fps, rasterP95});
         updateSnapshot(canvasId);
       }
     }, 500);
@@ -73,117 +108,93 @@ export const useCanvas = (initialBrushStyle: BrushStyle) => {
         clearInterval(statsTimerRef.current);
       }
 
-      if (canvasId !== null) {
-        NativeGestureCanvas.destroyCanvas(canvasId);
-      }
+      canvasHandleRef.current = null;
+      setGestureInput(null);
+      input.dispose();
+      canvasHandle.dispose();
     };
-  }, [width, height, updateSnapshot]);
+  }, [updateSnapshot]);
 
-  const handleStartDrawing = useCallback(
-    (point: Point) => {
-      if (canvasState.canvasId === null || !isMountedRef.current) {
-        return;
-      }
-
-      const strokeId = NativeGestureCanvas.beginStroke(
-        canvasState.canvasId,
-        point,
-        brushStyle,
-      );
+  useEffect(() => {
+    const canvasHandle = canvasHandleRef.current;
+    const size = canvasSizeRef.current;
+    if (size.width === width && size.height === height) return;
+    canvasSizeRef.current = {width, height};
+    if (canvasHandle === null || !isMountedRef.current) return;
+
+    // Ends any stroke still down, so there is nothing left to feed it
+    canvasHandle.setSize(width, height);
+    setIsDrawing(false);
+    updateSnapshot(canvasHandle.id);
+  }, [width, height, updateSnapshot]);
 
-      currentStrokeIdRef.current = strokeId;
-      setCanvasState(prev => ({...prev, strokeId}));
+  // Strokes fed through gestureInput are drawn natively; JS only tracks state
+  const handleGestureStart = useCallback(() => {
+    if (isMountedRef.current) {
       setIsDrawing(true);
-    },
-    [canvasState.canvasId, brushStyle],
-  );
-
-  const handleDrawMove = useCallback(
-    (point: Point) => {
-      if (
-        !isDrawing ||
-        canvasState.canvasId === null ||
-        currentStrokeIdRef.current === null ||
-        !isMountedRef.current
-      ) {
-        return;
-      }
-
-      NativeGestureCanvas.addPointToStroke(
-        canvasState.canvasId,
-        currentStrokeIdRef.current,
-        point,
-      );
-    },
-    [isDrawing, canvasState.canvasId],
-  );
-
-  const handleEndDrawing = useCallback(
-    (point: Point) => {
-      if (
-        canvasState.canvasId === null ||
-        currentStrokeIdRef.current === null ||
-        !isMountedRef.current
-      ) {
-        return;
-      }
-
-      NativeGestureCanvas.endStroke(
-        canvasState.canvasId,
-        currentStrokeIdRef.current,
-        point,
-      );
+    }
+  }, []);
 
-      currentStrokeIdRef.current = null;
+  const handleGestureEnd = useCallback(() => {
+    if (!isMountedRef.current) return;
 
-      if (isMountedRef.current) {
-        setCanvasState(prev => ({...prev, strokeId: null}));
-        setIsDrawing(false);
+    setIsDrawing(false);
+    setTimeout(() => {
+      if (canvasState.canvasId !== null && isMountedRef.current) {
+        updateSnapshot(canvasState.canvasId);
       }
-
-      setTimeout(() => {
-        if (canvasState.canvasId !== null && isMountedRef.current) {
-          updateSnapshot(canvasState.canvasId);
-        }
-      }, 100);
-    },
-    [canvasState.canvasId, updateSnapshot],
-  );
+    }, 100);
+  }, [canvasState.canvasId, updateSnapshot]);
 
   const applyMotion = useCallback(
     (accelerationX: number, accelerationY: number, accelerationZ: number) => {
-      if (canvasState.canvasId === null || !isMountedRef.current) return;
+      if (canvasHandleRef.current === null || !isMountedRef.current) return;
 
-      NativeGestureCanvas.applyMotionToCanvas(
-        canvasState.canvasId,
+      canvasHandleRef.current.applyMotion(
         accelerationX,
         accelerationY,
         accelerationZ,
       );
     },
-    [canvasState.canvasId],
+    [],
   );
 
   const clearCanvas = useCallback(() => {
-    if (canvasState.canvasId === null || !isMountedRef.current) return;
+    if (canvasHandleRef.current === null || !isMountedRef.current) return;
 
-    NativeGestureCanvas.clearCanvas(canvasState.canvasId);
+    canvasHandleRef.current.clear();
 
     if (isMountedRef.current && canvasState.canvasId !== null) {
       updateSnapshot(canvasState.canvasId);
     }
   }, [canvasState.canvasId, updateSnapshot]);
 
+  const undo = useCallback(() => {
+    canvasHandleRef.current?.undo();
+    if (canvasState.canvasId !== null) {
+      updateSnapshot(canvasState.canvasId);
+    }
+  }, [canvasState.canvasId, updateSnapshot]);
+
+  const redo = useCallback(() => {
+    canvasHandleRef.current?.redo();
+    if (canvasState.canvasId !== null) {
+      updateSnapshot(canvasState.canvasId);
+    }
+  }, [canvasState.canvasId, updateSnapshot]);
+
   return {
     canvasState,
     brushStyle,
     setBrushStyle,
     isDrawing,
     performanceStats,
-    handleStartDrawing,
-    handleDrawMove,
-    handleEndDrawing,
+    gestureInput,
+    handleGestureStart,
+    handleGestureEnd,
     applyMotion,
     clearCanvas,
+    undo,
+    redo,
   };
 };
@@ -4,6 +4,9 @@
 @interface CanvasNativeView : UIView
 
 @property (nonatomic, strong) UIImage *canvasImage;
+// When set, frames are pulled straight from the canvas' native FrameSink.
+// A canvas shows in one view at a time; the first view to attach keeps it.
+@property (nonatomic, assign) NSInteger canvasId;
 - (void)updateWithBase64Image:(NSString *)base64String;
 
 @end
@@ -1,9 +1,24 @@
 #import "CanvasNativeView.h"
 #import <React/RCTBridge.h>
 #import <React/RCTUIManager.h>
+#include <memory>
+#include "FrameScheduler.h"
+#include "FrameSink.h"
+
+using facebook::react::Frame;
+using facebook::react::FrameScheduler;
+using facebook::react::FrameSink;
+using facebook::react::FrameSinkRegistry;
+
+// CGDataProvider release callback: lets the sink reuse the frame's buffer
+static void releaseHeldFrame(void *info, const void *data, size_t size) {
+    delete static_cast<std::shared_ptr<const Frame> *>(info);
+}
 
 @implementation CanvasNativeView {
     UIImageView *_imageView;
+    std::shared_ptr<FrameSink> _frameSink;
+    CADisplayLink *_displayLink;
 }
 
 - (instancetype)initWithFrame:(CGRect)frame {
@@ -17,6 +32,85 @@
     return self;
 }
 
+- (void)dealloc {
+    [self detachFrameSink];
+}
+
+- (void)setCanvasId:(NSInteger)canvasId {
+    _canvasId = canvasId;
+    [self detachFrameSink];
+    
+    // A sink feeds one view; while another view shows this canvas, this one
+    // keeps whatever it last showed
+    std::shared_ptr<FrameSink> sink = FrameSinkRegistry::find(static_cast<int>(canvasId));
+    if (sink && sink->attachConsumer()) {
+        _frameSink = std::move(sink);
+    }
+    [self updateDisplayLink];
+}
+
+- (void)didMoveToWindow {
+    [super didMoveToWindow];
+    [self updateDisplayLink];
+}
+
+// The display link retains its target, so it only runs while on screen
+- (void)updateDisplayLink {
+    BOOL wantsLink = _frameSink && self.window;
+    if (wantsLink && !_displayLink) {
+        _displayLink = [CADisplayLink displayLinkWithTarget:self selector:@selector(displayLinkFired:)];
+        [_displayLink addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
+    } else if (!wantsLink && _displayLink) {
+        [_displayLink invalidate];
+        _displayLink = nil;
+    }
+}
+
+- (void)detachFrameSink {
+    if (_frameSink) {
+        _frameSink->detachConsumer();
+        _frameSink.reset();
+    }
+    [self updateDisplayLink];
+}
+
+- (void)displayLinkFired:(CADisplayLink *)link {
+    // Paces the render thread in 'display' mode; shows what the last tick drew
+    FrameScheduler::displayFrame(link.timestamp);
+    [self pullFrame];
+}
+
+- (void)pullFrame {
+    if (!_frameSink || !_frameSink->hasNewFrame()) {
+        return;
+    }
+    
+    // The rasterizer leaves a held frame alone until CoreGraphics releases the
+    // image, however long UIKit keeps it. nullptr while the previous frame is
+    // still on screen too; the next tick tries again.
+    std::shared_ptr<const Frame> frame = _frameSink->acquireHeld();
+    if (!frame || frame->width == 0 || frame->height == 0) {
+        return;
+    }
+    
+    // ARGB words are BGRA in memory; CoreGraphics reads the frame in place
+    size_t bytesPerRow = frame->width * sizeof(uint32_t);
+    CGDataProviderRef provider = CGDataProviderCreateWithData(new std::shared_ptr<const Frame>(frame),
+                                                              frame->pixels.data(), bytesPerRow * frame->height,
+                                                              releaseHeldFrame);
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGImageRef image = CGImageCreate(frame->width, frame->height, 8, 32, bytesPerRow, colorSpace,
+                                     kCGBitmapByteOrder32Little | kCGImageAlphaNoneSkipFirst,
+                                     provider, NULL, false, kCGRenderingIntentDefault);
+    
+    _canvasImage = [UIImage imageWithCGImage:image];
+    _imageView.image = _canvasImage;
+    
+    CGImageRelease(image);
+    CGColorSpaceRelease(colorSpace);
+    CGDataProviderRelease(provider);
+}
+
 - (void)setCanvasImage:(UIImage *)canvasImage {
     _canvasImage = canvasImage;
     _imageView.image = canvasImage;
@@ -56,6 +150,7 @@ RCT_EXPORT_MODULE(CanvasView)
 }
 
 RCT_EXPORT_VIEW_PROPERTY(canvasImage, UIImage)
+RCT_EXPORT_VIEW_PROPERTY(canvasId, NSInteger)
 
 RCT_EXPORT_METHOD(updateWithBase64Image:(nonnull NSNumber *)reactTag imageData:(NSString *)base64String) {
     [self.bridge.uiManager addUIBlock:^(RCTUIManager *uiManager, NSDictionary<NSNumber *,UIView *> *viewRegistry) {
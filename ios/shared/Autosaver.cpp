@@ -0,0 +1,435 @@
+#include "Autosaver.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__APPLE__)
+#include <pthread.h>
+#else
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+#include <unordered_set>
+#include "CanvasSession.h"
+#include "FileIO.h"
+#include "TileCodec.h"
+
+namespace facebook::react {
+
+namespace {
+
+// File: header, then checkpoint records back to back. A record lists the
+// tiles it carries and which of its blobs holds each one, so tiles that
+// share storage are written once, and ends in a checksum of everything
+// before it.
+constexpr size_t kFileHeaderSize = 20;
+constexpr uint32_t kCheckpointMagic = 0x50434347; // "GCCP"
+constexpr size_t kCheckpointHeaderSize = 12;
+
+// Below this much garbage a rewrite isn't worth it
+constexpr uint64_t kCompactionSlackBytes = uint64_t(1) << 20;
+
+template <typename T>
+void appendRaw(std::vector<uint8_t>& out, T value) {
+  // Native byte order; every platform we ship on is little-endian
+  const size_t offset = out.size();
+  out.resize(offset + sizeof(T));
+  std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+template <typename T>
+T getRaw(const uint8_t* data, size_t offset) {
+  T value;
+  std::memcpy(&value, data + offset, sizeof(T));
+  return value;
+}
+
+// FNV-1a; only has to catch a torn or partly flushed record
+uint32_t checksum(const uint8_t* data, size_t size) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+// Appends one checkpoint record for tiles to out, which is written at
+// fileOffset, and points each tile's location at its blob
+template <typename Location>
+void buildCheckpoint(const TileGrid& pixels, const std::vector<int>& tiles, uint64_t fileOffset,
+                     std::vector<uint8_t>& out, std::vector<Location>& locations) {
+  std::unordered_map<const PixelTile*, uint32_t> blobOfTile;
+  std::vector<std::vector<uint8_t>> blobs;
+  std::vector<uint32_t> blobIndices;
+  blobIndices.reserve(tiles.size());
+  for (int index : tiles) {
+    auto tile = pixels.tileRef(index);
+    auto [entry, inserted] = blobOfTile.try_emplace(tile.get(), static_cast<uint32_t>(blobs.size()));
+    if (inserted) {
+      blobs.emplace_back();
+      compressTile(*tile, blobs.back());
+    }
+    blobIndices.push_back(entry->second);
+  }
+  
+  const size_t recordStart = out.size();
+  appendRaw(out, kCheckpointMagic);
+  appendRaw(out, static_cast<uint32_t>(tiles.size()));
+  appendRaw(out, static_cast<uint32_t>(blobs.size()));
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    appendRaw(out, static_cast<uint32_t>(tiles[i]));
+    appendRaw(out, blobIndices[i]);
+  }
+  for (const auto& blob : blobs) {
+    appendRaw(out, static_cast<uint32_t>(blob.size()));
+  }
+  
+  std::vector<uint64_t> blobOffsets(blobs.size());
+  for (size_t blob = 0; blob < blobs.size(); ++blob) {
+    blobOffsets[blob] = fileOffset + (out.size() - recordStart);
+    out.insert(out.end(), blobs[blob].begin(), blobs[blob].end());
+  }
+  appendRaw(out, checksum(out.data() + recordStart, out.size() - recordStart));
+  
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    locations[tiles[i]].offset = blobOffsets[blobIndices[i]];
+    locations[tiles[i]].size = static_cast<uint32_t>(blobs[blobIndices[i]].size());
+  }
+}
+
+} // namespace
+
+Autosaver::Autosaver(CaptureRequest requestCapture, std::shared_ptr<PerfStats> perfStats)
+    : requestCapture_(std::move(requestCapture)), perfStats_(std::move(perfStats)),
+      thread_([this] { run(); }) {}
+
+Autosaver::~Autosaver() {
+  stop();
+}
+
+void Autosaver::enable(std::shared_ptr<CanvasSession> session, std::string path, uint64_t intervalMs,
+                       EnableCallback onEnabled) {
+  auto entry = std::make_shared<Entry>();
+  entry->canvasId = session->id();
+  entry->backgroundColor = session->backgroundColor();
+  entry->session = session;
+  entry->path = std::move(path);
+  entry->interval = std::chrono::milliseconds(std::max(intervalMs, kMinIntervalMs));
+  entry->due = Clock::now();
+  entry->onEnabled = std::move(onEnabled);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = entries_[session->id()];
+    if (slot) {
+      retired_.push_back(std::move(slot));
+    }
+    slot = std::move(entry);
+  }
+  condition_.notify_one();
+}
+
+void Autosaver::disable(int canvasId) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = entries_.find(canvasId);
+    if (found == entries_.end()) {
+      return;
+    }
+    retired_.push_back(std::move(found->second));
+    entries_.erase(found);
+  }
+  condition_.notify_one();
+}
+
+void Autosaver::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void Autosaver::run() {
+  // Background priority, so checkpoints never preempt the render thread
+#if defined(__APPLE__)
+  pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0);
+#else
+  setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+  
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    if (!retired_.empty()) {
+      auto retired = std::move(retired_);
+      retired_.clear();
+      lock.unlock();
+      for (auto& entry : retired) {
+        closeFile(*entry);
+      }
+      lock.lock();
+      continue;
+    }
+    
+    if (!captures_.empty()) {
+      Capture capture = std::move(captures_.front());
+      captures_.pop_front();
+      Entry& entry = *capture.entry;
+      auto registered = entries_.find(entry.canvasId);
+      if (registered == entries_.end() || registered->second != capture.entry) {
+        continue; // Disabled or replaced since the capture was requested
+      }
+      lock.unlock();
+      
+      std::string error;
+      const bool ok = checkpoint(entry, capture.pixels, error);
+      const bool first = entry.onEnabled != nullptr;
+      if (first) {
+        auto onEnabled = std::move(entry.onEnabled);
+        entry.onEnabled = nullptr;
+        onEnabled(ok, error);
+      }
+      
+      lock.lock();
+      entry.capturing = false;
+      entry.due = Clock::now() + entry.interval;
+      if (first && !ok) {
+        // Never got a file; later failures are retried on the next interval
+        registered = entries_.find(entry.canvasId);
+        if (registered != entries_.end() && registered->second == capture.entry) {
+          entries_.erase(registered);
+        }
+      }
+      continue;
+    }
+    
+    // Ask for captures of canvases that are due and have changed since
+    const auto now = Clock::now();
+    auto wakeAt = Clock::time_point::max();
+    std::vector<std::pair<std::shared_ptr<CanvasSession>, std::shared_ptr<Entry>>> due;
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      auto& entry = it->second;
+      auto session = entry->session.lock();
+      if (!session) {
+        retired_.push_back(std::move(entry));
+        it = entries_.erase(it);
+        continue;
+      }
+      if (!entry->capturing && entry->due <= now) {
+        if (entry->fd < 0 || session->pixelGeneration() != entry->savedGeneration) {
+          entry->capturing = true;
+          due.emplace_back(std::move(session), entry);
+        } else {
+          entry->due = now + entry->interval;
+        }
+      }
+      if (!entry->capturing) {
+        wakeAt = std::min(wakeAt, entry->due);
+      }
+      ++it;
+    }
+    if (!due.empty()) {
+      lock.unlock();
+      for (auto& [session, entry] : due) {
+        // The render thread only copies tile pointers and hands them back
+        requestCapture_(std::move(session), [this, entry](TileGrid pixels) {
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            captures_.push_back({entry, std::move(pixels)});
+          }
+          condition_.notify_one();
+        });
+      }
+      lock.lock();
+      continue;
+    }
+    if (!retired_.empty()) {
+      continue;
+    }
+    
+    if (wakeAt == Clock::time_point::max()) {
+      condition_.wait(lock);
+    } else {
+      condition_.wait_until(lock, wakeAt);
+    }
+  }
+  
+  for (auto& [canvasId, entry] : entries_) {
+    closeFile(*entry);
+  }
+  for (auto& entry : retired_) {
+    closeFile(*entry);
+  }
+}
+
+bool Autosaver::checkpoint(Entry& entry, const TileGrid& pixels, std::string& error) {
+  PerfStats::Scope timing(*perfStats_, PerfOperation::Autosave);
+  
+  bool ok;
+  const bool sameShape = entry.width == pixels.width() && entry.height == pixels.height();
+  if (entry.fd < 0 || !sameShape || entry.fileBytes > 2 * entry.liveBytes + kCompactionSlackBytes) {
+    // First save, new dimensions, or mostly superseded tiles: start over
+    // with one checkpoint of everything
+    std::vector<int> everything(pixels.tileCount());
+    for (int index = 0; index < pixels.tileCount(); ++index) {
+      everything[index] = index;
+    }
+    timing.setPixels(static_cast<uint64_t>(pixels.width()) * pixels.height());
+    ok = writeFull(entry, pixels, everything, error);
+  } else {
+    auto changed = pixels.tilesChangedSince(entry.savedGeneration);
+    timing.setPixels(changed.size() * kTilePixels);
+    ok = changed.empty() || append(entry, pixels, changed, error);
+  }
+  
+  if (ok) {
+    entry.savedGeneration = pixels.generation();
+    
+    // Tiles that share a blob count once
+    std::unordered_set<uint64_t> blobs;
+    entry.liveBytes = 0;
+    for (const auto& location : entry.tiles) {
+      if (blobs.insert(location.offset).second) {
+        entry.liveBytes += location.size;
+      }
+    }
+  }
+  return ok;
+}
+
+bool Autosaver::writeFull(Entry& entry, const TileGrid& pixels, const std::vector<int>& tiles,
+                          std::string& error) {
+  std::vector<TileLocation> locations(pixels.tileCount());
+  std::vector<uint8_t> out;
+  appendRaw(out, kMagic);
+  appendRaw(out, kVersion);
+  appendRaw(out, uint16_t{0});
+  appendRaw(out, static_cast<uint32_t>(pixels.width()));
+  appendRaw(out, static_cast<uint32_t>(pixels.height()));
+  appendRaw(out, entry.backgroundColor);
+  buildCheckpoint(pixels, tiles, kFileHeaderSize, out, locations);
+  
+  // Replaced by rename, so the previous file stays recoverable until this
+  // one is complete
+  closeFile(entry);
+  if (!writeFileAtomically(entry.path, out.data(), out.size(), error)) {
+    return false;
+  }
+  entry.fd = ::open(entry.path.c_str(), O_WRONLY | O_APPEND);
+  if (entry.fd < 0) {
+    error = "Cannot open " + entry.path + ": " + std::strerror(errno);
+    return false;
+  }
+  entry.width = pixels.width();
+  entry.height = pixels.height();
+  entry.fileBytes = out.size();
+  entry.tiles = std::move(locations);
+  return true;
+}
+
+bool Autosaver::append(Entry& entry, const TileGrid& pixels, const std::vector<int>& tiles,
+                       std::string& error) {
+  std::vector<TileLocation> locations = entry.tiles;
+  std::vector<uint8_t> out;
+  buildCheckpoint(pixels, tiles, entry.fileBytes, out, locations);
+  
+  if (!writeAll(entry.fd, out.data(), out.size()) || !syncToDisk(entry.fd)) {
+    error = "Cannot write " + entry.path + ": " + std::strerror(errno);
+    // Cut the torn record off so later checkpoints stay reachable
+    if (::ftruncate(entry.fd, static_cast<off_t>(entry.fileBytes)) != 0) {
+      closeFile(entry);
+    }
+    return false;
+  }
+  entry.fileBytes += out.size();
+  entry.tiles = std::move(locations);
+  return true;
+}
+
+void Autosaver::closeFile(Entry& entry) {
+  if (entry.fd >= 0) {
+    ::close(entry.fd);
+    entry.fd = -1;
+  }
+}
+
+std::shared_ptr<CanvasDocument> Autosaver::recover(const std::string& path, std::string& error) {
+  auto file = MappedFile::open(path, error);
+  if (!file) {
+    return nullptr;
+  }
+  
+  const uint8_t* data = file->data();
+  const size_t size = file->size();
+  if (size < kFileHeaderSize || getRaw<uint32_t>(data, 0) != kMagic ||
+      getRaw<uint16_t>(data, 4) != kVersion) {
+    error = "Not a canvas autosave: " + path;
+    return nullptr;
+  }
+  const uint32_t width = getRaw<uint32_t>(data, 8);
+  const uint32_t height = getRaw<uint32_t>(data, 12);
+  const uint32_t backgroundColor = getRaw<uint32_t>(data, 16);
+  constexpr uint32_t kMaxDimension = 1 << 15;
+  if (width == 0 || height == 0 || width > kMaxDimension || height > kMaxDimension) {
+    error = "Corrupt canvas autosave: " + path;
+    return nullptr;
+  }
+  const size_t tileCount = static_cast<size_t>((width + kTileSize - 1) / kTileSize) *
+                           ((height + kTileSize - 1) / kTileSize);
+  
+  // Later checkpoints override earlier ones; stop at the first record that
+  // isn't complete (the process died mid-write)
+  std::vector<CanvasDocument::TileEntry> entries(tileCount, CanvasDocument::TileEntry{});
+  size_t checkpoints = 0;
+  size_t offset = kFileHeaderSize;
+  while (size - offset >= kCheckpointHeaderSize && getRaw<uint32_t>(data, offset) == kCheckpointMagic) {
+    const uint64_t tiles = getRaw<uint32_t>(data, offset + 4);
+    const uint64_t blobs = getRaw<uint32_t>(data, offset + 8);
+    if (tiles > tileCount || blobs > tiles) {
+      break;
+    }
+    const uint64_t tableBytes = kCheckpointHeaderSize + tiles * 8 + blobs * 4;
+    if (size - offset < tableBytes) {
+      break;
+    }
+    std::vector<uint64_t> blobOffsets(blobs);
+    uint64_t recordBytes = tableBytes;
+    for (uint64_t blob = 0; blob < blobs; ++blob) {
+      blobOffsets[blob] = offset + recordBytes;
+      recordBytes += getRaw<uint32_t>(data, offset + kCheckpointHeaderSize + tiles * 8 + blob * 4);
+    }
+    if (size - offset < recordBytes + 4 ||
+        getRaw<uint32_t>(data, offset + recordBytes) != checksum(data + offset, recordBytes)) {
+      break;
+    }
+    
+    bool valid = true;
+    for (uint64_t i = 0; i < tiles && valid; ++i) {
+      const uint32_t index = getRaw<uint32_t>(data, offset + kCheckpointHeaderSize + i * 8);
+      const uint32_t blob = getRaw<uint32_t>(data, offset + kCheckpointHeaderSize + i * 8 + 4);
+      valid = index < tileCount && blob < blobs;
+      if (valid) {
+        entries[index].pixelOffset = blobOffsets[blob];
+        entries[index].pixelSize =
+          getRaw<uint32_t>(data, offset + kCheckpointHeaderSize + tiles * 8 + blob * 4);
+      }
+    }
+    if (!valid) {
+      break;
+    }
+    ++checkpoints;
+    offset += recordBytes + 4;
+  }
+  if (checkpoints == 0) {
+    error = "No complete checkpoint in " + path;
+    return nullptr;
+  }
+  
+  return std::make_shared<CanvasDocument>(std::move(file), static_cast<int>(width), static_cast<int>(height),
+                                          backgroundColor, std::move(entries));
+}
+
+} // namespace facebook::react
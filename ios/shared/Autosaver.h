@@ -0,0 +1,114 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "CanvasDocument.h"
+#include "PerfStats.h"
+#include "TileGrid.h"
+
+namespace facebook::react {
+
+class CanvasSession;
+
+// Crash protection for canvases. Every interval, tiles changed since the
+// last checkpoint are compressed and appended to the canvas's autosave file
+// as one checksummed checkpoint record; a torn record at the end is simply
+// ignored on recovery. Once the file holds more than twice its live data it
+// is rewritten as a single checkpoint.
+//
+// The render thread only hands over a copy-on-write capture of the pixels;
+// compression, IO and compaction all run on the autosave thread.
+class Autosaver {
+public:
+  static constexpr uint32_t kMagic = 0x31414347; // "GCA1"
+  static constexpr uint16_t kVersion = 1;
+  static constexpr uint64_t kMinIntervalMs = 100;
+
+  // Queues a pixel capture of the session on the render thread; the
+  // callback runs there and must not block
+  using CaptureRequest = std::function<void(std::shared_ptr<CanvasSession>, std::function<void(TileGrid)>)>;
+  // Called on the autosave thread once the first checkpoint is written
+  using EnableCallback = std::function<void(bool ok, const std::string& error)>;
+
+  Autosaver(CaptureRequest requestCapture, std::shared_ptr<PerfStats> perfStats);
+  ~Autosaver();
+
+  Autosaver(const Autosaver&) = delete;
+  Autosaver& operator=(const Autosaver&) = delete;
+
+  // Starts a fresh autosave file at path, replacing any autosave the canvas
+  // already had. Stops by itself once the session is gone.
+  void enable(std::shared_ptr<CanvasSession> session, std::string path, uint64_t intervalMs,
+              EnableCallback onEnabled);
+  void disable(int canvasId);
+
+  // Stops the autosave thread; captures delivered afterwards are dropped
+  void stop();
+
+  // Latest complete checkpoint of an autosave file as a document
+  static std::shared_ptr<CanvasDocument> recover(const std::string& path, std::string& error);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct TileLocation {
+    uint64_t offset = 0;
+    uint32_t size = 0;
+  };
+
+  struct Entry {
+    int canvasId = 0;
+    std::weak_ptr<CanvasSession> session;
+    std::string path;
+    std::chrono::milliseconds interval;
+    Clock::time_point due;
+    EnableCallback onEnabled; // Cleared after the first checkpoint
+    bool capturing = false;
+
+    // Owned by the autosave thread
+    uint32_t backgroundColor = 0;
+    int fd = -1;
+    int width = 0;
+    int height = 0;
+    uint64_t savedGeneration = 0;
+    uint64_t fileBytes = 0;
+    uint64_t liveBytes = 0; // Bytes the latest checkpoint of each tile takes
+    std::vector<TileLocation> tiles;
+  };
+
+  struct Capture {
+    std::shared_ptr<Entry> entry;
+    TileGrid pixels;
+  };
+
+  void run();
+  bool checkpoint(Entry& entry, const TileGrid& pixels, std::string& error);
+  // Replaces the file with a single checkpoint of tiles
+  static bool writeFull(Entry& entry, const TileGrid& pixels, const std::vector<int>& tiles,
+                        std::string& error);
+  static bool append(Entry& entry, const TileGrid& pixels, const std::vector<int>& tiles,
+                     std::string& error);
+  static void closeFile(Entry& entry);
+
+  CaptureRequest requestCapture_;
+  std::shared_ptr<PerfStats> perfStats_;
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::unordered_map<int, std::shared_ptr<Entry>> entries_; // Guarded by mutex_
+  std::deque<Capture> captures_; // Guarded by mutex_
+  std::vector<std::shared_ptr<Entry>> retired_; // Guarded by mutex_; closed on the autosave thread
+  bool stopping_ = false; // Guarded by mutex_
+  std::thread thread_;
+};
+
+} // namespace facebook::react
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <cstdint>
+#include "CanvasTypes.h"
 
 namespace facebook::react {
 
@@ -9,14 +10,13 @@ class BrushEngine {
 public:
   BrushEngine();
   
-  void configureBrush(double size, double opacity, uint32_t color, 
-                     const std::string& texture, double dampening, double fluidResponse);
+  void configureBrush(const BrushStyleData& style);
   void simulatePhysics(double accelX, double accelY, double accelZ);
   
   double size_;
   double opacity_;
   uint32_t color_;
-  std::string texture_;
+  BrushTexture texture_;
   double dampening_;
   double fluidResponse_;
   
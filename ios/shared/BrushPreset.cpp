@@ -0,0 +1,15 @@
+#include "BrushPreset.h"
+#include <utility>
+
+namespace facebook::react {
+
+BrushPreset::BrushPreset(const BrushStyleData& style)
+    : BrushPreset(style, BrushTextureAtlas::shared().get(style.texture, BrushImageKind::Tip),
+                  BrushTextureAtlas::shared().get(style.texture, BrushImageKind::Grain)) {}
+
+BrushPreset::BrushPreset(const BrushStyleData& style, std::shared_ptr<const BrushImage> tip,
+                         std::shared_ptr<const BrushImage> grain)
+    : style_(style), falloff_(&Canvas::falloffFor(style.texture)),
+      tip_(std::move(tip)), grain_(std::move(grain)) {}
+
+} // namespace facebook::react
@@ -0,0 +1,165 @@
+#include "BrushTextureAtlas.h"
+#include <algorithm>
+#include <cmath>
+
+namespace facebook::react {
+
+namespace {
+
+constexpr int kChalkGrainSize = 128;
+
+// Repeatable value in [0, 1] for a lattice point, wrapping every period points
+double latticeValue(int x, int y, int period) {
+  uint32_t hash = static_cast<uint32_t>(x % period) * 73856093u ^ static_cast<uint32_t>(y % period) * 19349663u;
+  hash ^= hash >> 13;
+  hash *= 0x5BD1E995u;
+  hash ^= hash >> 15;
+  return (hash & 0xFFFF) / 65535.0;
+}
+
+// Smoothly interpolated lattice values; tiles every period lattice cells
+double valueNoise(double x, double y, int period) {
+  const int x0 = static_cast<int>(x);
+  const int y0 = static_cast<int>(y);
+  const double fx = (x - x0) * (x - x0) * (3 - 2 * (x - x0));
+  const double fy = (y - y0) * (y - y0) * (3 - 2 * (y - y0));
+  const double top = latticeValue(x0, y0, period) + (latticeValue(x0 + 1, y0, period) - latticeValue(x0, y0, period)) * fx;
+  const double bottom = latticeValue(x0, y0 + 1, period) + (latticeValue(x0 + 1, y0 + 1, period) - latticeValue(x0, y0 + 1, period)) * fx;
+  return top + (bottom - top) * fy;
+}
+
+// Two octaves of tileable noise over 0.6-1.0, the range the old per-pixel
+// sine pattern covered, without its 8 px period
+std::shared_ptr<const BrushImage> makeChalkGrain() {
+  std::vector<uint8_t> pixels(kChalkGrainSize * kChalkGrainSize);
+  for (int y = 0; y < kChalkGrainSize; ++y) {
+    for (int x = 0; x < kChalkGrainSize; ++x) {
+      const double coarse = valueNoise(x / 8.0, y / 8.0, kChalkGrainSize / 8);
+      const double fine = valueNoise(x / 2.0, y / 2.0, kChalkGrainSize / 2);
+      const double value = 0.6 + 0.4 * (0.65 * coarse + 0.35 * fine);
+      pixels[y * kChalkGrainSize + x] = static_cast<uint8_t>(std::lround(value * 255));
+    }
+  }
+  return std::make_shared<BrushImage>(kChalkGrainSize, kChalkGrainSize, pixels.data(), BrushImageKind::Grain);
+}
+
+} // namespace
+
+bool parseBrushImageKind(std::string_view name, BrushImageKind& kind) {
+  if (name == "tip") {
+    kind = BrushImageKind::Tip;
+  } else if (name == "grain") {
+    kind = BrushImageKind::Grain;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+BrushImage::BrushImage(int width, int height, const uint8_t* pixels, BrushImageKind kind)
+    : wraps_(kind == BrushImageKind::Grain) {
+  levels_.push_back({width, height, 0});
+  while (levels_.back().width > 1 || levels_.back().height > 1) {
+    const Level& last = levels_.back();
+    levels_.push_back({(last.width + 1) / 2, (last.height + 1) / 2,
+                       last.offset + static_cast<size_t>(last.width) * last.height});
+  }
+  const Level& smallest = levels_.back();
+  pixels_.resize(smallest.offset + static_cast<size_t>(smallest.width) * smallest.height);
+  std::copy_n(pixels, static_cast<size_t>(width) * height, pixels_.begin());
+
+  // Each level is the 2x2 average of the one above; odd sizes fold the
+  // last row/column in by the image's edge rule
+  for (size_t level = 1; level < levels_.size(); ++level) {
+    const Level& src = levels_[level - 1];
+    const Level& dst = levels_[level];
+    const uint8_t* in = pixels_.data() + src.offset;
+    uint8_t* out = pixels_.data() + dst.offset;
+    for (int y = 0; y < dst.height; ++y) {
+      const uint8_t* row0 = in + static_cast<size_t>(edge(y * 2, src.height)) * src.width;
+      const uint8_t* row1 = in + static_cast<size_t>(edge(y * 2 + 1, src.height)) * src.width;
+      for (int x = 0; x < dst.width; ++x) {
+        const int x0 = edge(x * 2, src.width);
+        const int x1 = edge(x * 2 + 1, src.width);
+        out[y * dst.width + x] = static_cast<uint8_t>((row0[x0] + row0[x1] + row1[x0] + row1[x1] + 2) >> 2);
+      }
+    }
+  }
+}
+
+int BrushImage::levelForWidth(double size) const {
+  int level = 0;
+  while (level + 1 < levelCount() && levelWidth(level + 1) >= size) {
+    ++level;
+  }
+  return level;
+}
+
+int BrushImage::edge(int index, int size) const {
+  if (wraps_) {
+    index %= size;
+    return index < 0 ? index + size : index;
+  }
+  return std::clamp(index, 0, size - 1);
+}
+
+void BrushImage::sampleRow(int level, double u, double v, double du, int count, uint8_t* out) const {
+  const Level& source = levels_[level];
+  const uint8_t* pixels = pixels_.data() + source.offset;
+
+  // 16.16 fixed point, shifted so texel centers fall on whole numbers;
+  // the shifts floor, so coordinates left of the image work too
+  const int64_t stepU = std::llround(du * 65536);
+  int64_t fixedU = std::llround((u - 0.5) * 65536);
+  const int64_t fixedV = std::llround((v - 0.5) * 65536);
+  const int y0 = static_cast<int>(fixedV >> 16);
+  const uint32_t fy = static_cast<uint32_t>(fixedV >> 8) & 0xFF;
+  const uint8_t* row0 = pixels + static_cast<size_t>(edge(y0, source.height)) * source.width;
+  const uint8_t* row1 = pixels + static_cast<size_t>(edge(y0 + 1, source.height)) * source.width;
+
+  // Texel-aligned 1:1 reads (grain under a dab) are straight copies
+  if (stepU == 65536 && (fixedU & 0xFFFF) == 0 && fy == 0) {
+    int x = edge(static_cast<int>(fixedU >> 16), source.width);
+    for (int i = 0; i < count;) {
+      const int run = std::min(count - i, source.width - x);
+      std::copy_n(row0 + x, run, out + i);
+      i += run;
+      x = edge(x + run, source.width);
+    }
+    return;
+  }
+
+  for (int i = 0; i < count; ++i) {
+    const int x0 = static_cast<int>(fixedU >> 16);
+    const uint32_t fx = static_cast<uint32_t>(fixedU >> 8) & 0xFF;
+    const int left = edge(x0, source.width);
+    const int right = edge(x0 + 1, source.width);
+    const uint32_t top = row0[left] * (256 - fx) + row0[right] * fx;
+    const uint32_t bottom = row1[left] * (256 - fx) + row1[right] * fx;
+    out[i] = static_cast<uint8_t>((top * (256 - fy) + bottom * fy + 32768) >> 16);
+    fixedU += stepU;
+  }
+}
+
+BrushTextureAtlas& BrushTextureAtlas::shared() {
+  static BrushTextureAtlas atlas;
+  return atlas;
+}
+
+BrushTextureAtlas::BrushTextureAtlas() {
+  grains_[static_cast<int>(BrushTexture::Chalk)] = makeChalkGrain();
+}
+
+void BrushTextureAtlas::set(BrushTexture texture, BrushImageKind kind, std::shared_ptr<const BrushImage> image) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& slots = kind == BrushImageKind::Tip ? tips_ : grains_;
+  slots[static_cast<int>(texture)] = std::move(image);
+}
+
+std::shared_ptr<const BrushImage> BrushTextureAtlas::get(BrushTexture texture, BrushImageKind kind) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto& slots = kind == BrushImageKind::Tip ? tips_ : grains_;
+  return slots[static_cast<int>(texture)];
+}
+
+} // namespace facebook::react
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+#include "CanvasTypes.h"
+
+namespace facebook::react {
+
+// What a brush image shapes: a tip is stretched over each dab in place of
+// the radial falloff, a grain is tiled 1:1 over the canvas and scales
+// coverage wherever the brush lands
+enum class BrushImageKind : uint8_t {
+  Tip,
+  Grain,
+};
+
+bool parseBrushImageKind(std::string_view name, BrushImageKind& kind);
+
+// An 8-bit grayscale image with its half-resolution chain (level 1 = 1/2,
+// level 2 = 1/4, ... down to 1x1), all levels in one buffer. Immutable once
+// built, so strokes on any thread share it. Tips clamp at their edges,
+// grains wrap around.
+class BrushImage {
+public:
+  static constexpr int kMaxSize = 4096;
+
+  BrushImage(int width, int height, const uint8_t* pixels, BrushImageKind kind);
+
+  BrushImageKind kind() const { return wraps_ ? BrushImageKind::Grain : BrushImageKind::Tip; }
+  int levelCount() const { return static_cast<int>(levels_.size()); }
+  int levelWidth(int level) const { return levels_[level].width; }
+  int levelHeight(int level) const { return levels_[level].height; }
+  // Smallest level that is still at least size texels wide (0 if none is)
+  int levelForWidth(double size) const;
+  // Row-major texels of a level
+  const uint8_t* levelPixels(int level) const { return pixels_.data() + levels_[level].offset; }
+
+  // Bilinear samples along a row of a level: out[i] is the image at
+  // (u + i * du, v), in texels of that level with texel centers at + 0.5.
+  // Fixed point; the two source rows are found once per call.
+  void sampleRow(int level, double u, double v, double du, int count, uint8_t* out) const;
+
+private:
+  struct Level {
+    int width;
+    int height;
+    size_t offset;
+  };
+
+  int edge(int index, int size) const;
+
+  bool wraps_;
+  std::vector<Level> levels_;
+  std::vector<uint8_t> pixels_;
+};
+
+// Tip and grain images per brush texture, shared by every canvas. A brush
+// preset picks up the images current when it is resolved and keeps them,
+// so registering a new one only affects brushes resolved afterwards. The
+// journal records the images each stroke used and replays resolve from
+// those, never from here. Chalk starts with a built-in grain; every other
+// slot starts empty.
+class BrushTextureAtlas {
+public:
+  static BrushTextureAtlas& shared();
+
+  // Safe from any thread; null clears the slot
+  void set(BrushTexture texture, BrushImageKind kind, std::shared_ptr<const BrushImage> image);
+  std::shared_ptr<const BrushImage> get(BrushTexture texture, BrushImageKind kind) const;
+
+private:
+  BrushTextureAtlas();
+
+  static constexpr int kTextureCount = static_cast<int>(BrushTexture::Eraser) + 1;
+
+  mutable std::mutex mutex_;
+  std::array<std::shared_ptr<const BrushImage>, kTextureCount> tips_;
+  std::array<std::shared_ptr<const BrushImage>, kTextureCount> grains_;
+};
+
+} // namespace facebook::react
@@ -1,105 +1,366 @@
 #include "Canvas.h"
 #include <algorithm>
 #include <cmath>
-#include <cstring>
-#include <random>
-
-#pragma pack(push, 1)
-struct BMPHeader {
-    uint16_t fileType;      // File type, always "BM" (0x4D42)
-    uint32_t fileSize;      // Size of the file in bytes
-    uint16_t reserved1;     // Reserved, always 0
-    uint16_t reserved2;     // Reserved, always 0
-    uint32_t dataOffset;    // Offset to image data in bytes
-    uint32_t headerSize;    // Header size in bytes (40)
-    int32_t width;          // Width of the image
-    int32_t height;         // Height of the image
-    uint16_t planes;        // Number of color planes
-    uint16_t bitsPerPixel;  // Bits per pixel
-    uint32_t compression;   // Compression type
-    uint32_t imageSize;     // Image size in bytes
-    int32_t xPixelsPerM;    // Pixels per meter in x
-    int32_t yPixelsPerM;    // Pixels per meter in y
-    uint32_t colorsUsed;    // Number of colors used
-    uint32_t colorsImportant; // Number of important colors
-};
-#pragma pack(pop)
+#include "BlendKernels.h"
+#include "BrushTextureAtlas.h"
+#include "SnapshotEncoder.h"
 
 namespace facebook::react {
 
+// Share of a moving pixel that lands on its target each physics step
+constexpr uint32_t kFlowAlpha = 26;
+
+namespace {
+
+// Hard tips cover fully up to half a pixel inside the radius and fade out
+// over the last pixel, so edges stay antialiased
+double hardEdge(double distance, int radius) {
+  return std::min(1.0, radius + 0.5 - distance);
+}
+
+// Columns [start, end) of a row offsetY away from centerX that a hard tip
+// covers fully, i.e. where hardEdge is 1; empty when the row misses
+void solidRun(double centerX, double offsetY, int radius, int& start, int& end) {
+  const double inner = radius - 0.5;
+  const double reach = inner * inner - offsetY * offsetY;
+  if (inner <= 0 || reach < 0) {
+    return;
+  }
+  const double half = std::sqrt(reach);
+  start = static_cast<int>(std::ceil(centerX - half));
+  end = static_cast<int>(std::floor(centerX + half)) + 1;
+}
+
+// Watercolor leaves as much water as it lays down pigment; soft (never
+// filled) tips only, so every coverage entry is set
+void wet(uint8_t* water, const uint8_t* coverage, int count) {
+  for (int i = 0; i < count; ++i) {
+    water[i] = std::max(water[i], coverage[i]);
+  }
+}
+
+// Where a dab's pixels land on a tip image: the dab's bounding square
+// maps onto the whole image, read from the mip level nearest its size
+struct TipMapping {
+  TipMapping() = default;
+  TipMapping(const BrushImage& tip, int radius)
+      : level(tip.levelForWidth(2.0 * radius)),
+        scaleU(radius > 0 ? tip.levelWidth(level) / (2.0 * radius) : 0.0),
+        scaleV(radius > 0 ? tip.levelHeight(level) / (2.0 * radius) : 0.0),
+        radius(radius) {}
+  
+  // count pixels of the row offsetY below the dab center, starting
+  // offsetX across from it
+  void sample(const BrushImage& tip, double offsetX, double offsetY, int count, uint8_t* out) const {
+    const double u = radius > 0 ? (offsetX + radius) * scaleU : tip.levelWidth(level) * 0.5;
+    const double v = radius > 0 ? (offsetY + radius) * scaleV : tip.levelHeight(level) * 0.5;
+    tip.sampleRow(level, u, v, scaleU, count, out);
+  }
+  
+  int level = 0;
+  double scaleU = 0.0;
+  double scaleV = 0.0;
+  int radius = 0;
+};
+
+} // namespace
+
+FalloffTable::FalloffTable(double exponent) : hard(exponent == 0.0) {
+  for (int i = 0; i <= kSamples; ++i) {
+    values[i] = static_cast<float>(std::pow(1.0 - i / static_cast<double>(kSamples), exponent));
+  }
+  values[kSamples + 1] = values[kSamples];
+}
+
 Canvas::Canvas(int width, int height, uint32_t backgroundColor)
-    : width_(width), height_(height), backgroundColor_(backgroundColor) {
-  pixelData_.resize(width * height, backgroundColor);
+    : width_(width), height_(height), backgroundColor_(backgroundColor),
+      layers_(width, height, backgroundColor),
+      wetPaint_(width, height),
+      mips_(width, height, backgroundColor),
+      frameSink_(std::make_shared<FrameSink>()) {
   fluidLayer_.resize(width * height * 2, 0);
+  layers_.composite();
+  mipsGeneration_ = generation();
+}
+
+Canvas::Canvas(const std::shared_ptr<CanvasDocument>& document)
+    : width_(document->width()), height_(document->height()),
+      backgroundColor_(document->backgroundColor()),
+      layers_(width_, height_, backgroundColor_, [document](int index) { return document->loadTile(index); }),
+      wetPaint_(width_, height_),
+      mips_(width_, height_, backgroundColor_),
+      mipsGeneration_(0), // Every tile is new to the mips
+      frameSink_(std::make_shared<FrameSink>()) {
+  fluidLayer_.resize(static_cast<size_t>(width_) * height_ * 2, 0);
+  document->unpackFluid(fluidLayer_);
 }
 
 Canvas::~Canvas() {
 }
 
 void Canvas::clear() {
-  std::fill(pixelData_.begin(), pixelData_.end(), backgroundColor_);
+  layers_.clear();
   std::fill(fluidLayer_.begin(), fluidLayer_.end(), 0);
+  wetPaint_.reset(width_, height_);
+}
+
+void Canvas::resize(int width, int height) {
+  const int previousWidth = width_;
+  const int previousHeight = height_;
+  const std::vector<uint8_t> previousFluid = std::move(fluidLayer_);
+  reshape(width, height);
+  layers_.resize(width_, height_);
+  
+  const int copyWidth = std::min(previousWidth, width_);
+  const int copyHeight = std::min(previousHeight, height_);
+  for (int y = 0; y < copyHeight; ++y) {
+    std::copy_n(previousFluid.begin() + static_cast<size_t>(y) * previousWidth * 2, copyWidth * 2,
+                fluidLayer_.begin() + static_cast<size_t>(y) * width_ * 2);
+  }
+}
+
+void Canvas::resample(int width, int height, ResampleMode mode, WorkerPool& workers) {
+  if (mode == ResampleMode::Crop) {
+    resize(width, height);
+    return;
+  }
+  const int previousWidth = width_;
+  const int previousHeight = height_;
+  const std::vector<uint8_t> previousFluid = std::move(fluidLayer_);
+  reshape(width, height);
+  layers_.resample(width_, height_, mode, workers);
+  resampleFluid(previousFluid, previousWidth, previousHeight, fluidLayer_, width_, height_, mode, workers);
+}
+
+void Canvas::reset(int width, int height) {
+  reshape(width, height);
+  layers_.reset(width_, height_);
+  activeLayer_ = 0;
+  wetLayer_ = 0;
+}
+
+void Canvas::adopt(Canvas& redrawn) {
+  layers_.adopt(redrawn.layers_);
+  activeLayer_ = redrawn.activeLayer_;
+  wetLayer_ = redrawn.wetLayer_;
+  history_ = std::move(redrawn.history_);
+  restoredTiles_.clear();
+  mips_ = MipPyramid(width_, height_, backgroundColor_);
+  mipsGeneration_ = 0;
+}
+
+void Canvas::reshape(int width, int height) {
+  width_ = std::max(width, 1);
+  height_ = std::max(height, 1);
+  fluidLayer_.assign(static_cast<size_t>(width_) * height_ * 2, 0);
+  wetPaint_.reset(width_, height_);
+  // Rebuilt from the composite on the next thumbnail
+  mips_ = MipPyramid(width_, height_, backgroundColor_);
+  mipsGeneration_ = 0;
+  resetHistory();
+  restoredTiles_.clear();
+}
+
+bool Canvas::setLayerProperties(int layer, const LayerProperties& properties) {
+  if (layer < 0 || layer >= layers_.count()) {
+    return false;
+  }
+  layers_.setProperties(layer, properties);
+  return true;
+}
+
+bool Canvas::setActiveLayer(int layer) {
+  if (layer < 0 || layer >= layers_.count()) {
+    return false;
+  }
+  activeLayer_ = layer;
+  return true;
+}
+
+bool Canvas::setWetLayer(int layer) {
+  if (layer < 0 || layer >= layers_.count()) {
+    return false;
+  }
+  wetLayer_ = layer;
+  return true;
+}
+
+void Canvas::flattenLayers() {
+  layers_.flatten();
+  activeLayer_ = 0;
+  wetLayer_ = 0;
 }
 
 void Canvas::applyStrokeLine(double x1, double y1, double x2, double y2, 
                            double pressure, double size, uint32_t color, 
-                           double opacity, const std::string& texture) {
-  double adjustedSize = size * (0.5 + 0.5 * pressure);
+                           double opacity, BrushTexture texture) {
+  auto segment = prepareStrokeLine(x1, y1, x2, y2, pressure, size, color, opacity, texture, falloffFor(texture), 0.5);
+  const auto tip = BrushTextureAtlas::shared().get(texture, BrushImageKind::Tip);
+  const auto grain = BrushTextureAtlas::shared().get(texture, BrushImageKind::Grain);
+  segment.tip = tip.get();
+  segment.grain = grain.get();
+  rasterizeStrokeLine(segment, PixelRect{0, 0, width_, height_});
+}
+
+uint64_t Canvas::floodFill(int x, int y, uint32_t color, uint8_t tolerance, WorkerPool& workers) {
+  // Opaque like a solid brush, whatever layer it lands on
+  return floodFill_.fill(layers_.planes(), layers_.top(activeLayer_), width_, height_, x, y,
+                         color | 0xFF000000, tolerance, workers);
+}
+
+const FalloffTable& Canvas::falloffFor(BrushTexture texture) {
+  // Watercolor spreads wide and the eraser cuts a clean edge; every other
+  // tip is a soft round falloff
+  static const FalloffTable watercolor(0.7);
+  static const FalloffTable hard(0.0);
+  static const FalloffTable round(2.0);
+  if (texture == BrushTexture::Watercolor) {
+    return watercolor;
+  }
+  return texture == BrushTexture::Eraser ? hard : round;
+}
+
+StrokeSegment Canvas::prepareStrokeLine(double x1, double y1, double x2, double y2, 
+                                        double pressure, double size, uint32_t color, 
+                                        double opacity, BrushTexture texture,
+                                        const FalloffTable& falloff, double random) const {
+  StrokeSegment segment{x1, y1, x2, y2, pressure, size, color, opacity, texture};
+  segment.falloff = &falloff;
+  
   double dx = x2 - x1;
   double dy = y2 - y1;
+  if (std::sqrt(dx * dx + dy * dy) >= 1.0) {
+    if (texture == BrushTexture::Chalk) {
+      segment.textureEffect = 0.8 + 0.2 * (0.8 + 0.4 * random);
+    } else if (texture == BrushTexture::Watercolor) {
+      segment.textureEffect = 1.2;
+    }
+  }
+  return segment;
+}
+
+PixelRect Canvas::strokeLineBounds(const StrokeSegment& segment) const {
+  double adjustedSize = segment.size * (0.5 + 0.5 * segment.pressure);
+  int radius = static_cast<int>(adjustedSize * segment.textureEffect / 2.0) + 1;
+  PixelRect bounds{
+    static_cast<int>(std::floor(std::min(segment.x1, segment.x2))) - radius,
+    static_cast<int>(std::floor(std::min(segment.y1, segment.y2))) - radius,
+    static_cast<int>(std::ceil(std::max(segment.x1, segment.x2))) + radius + 1,
+    static_cast<int>(std::ceil(std::max(segment.y1, segment.y2))) + radius + 1,
+  };
+  bounds.x0 = std::max(bounds.x0, 0);
+  bounds.y0 = std::max(bounds.y0, 0);
+  bounds.x1 = std::min(bounds.x1, width_);
+  bounds.y1 = std::min(bounds.y1, height_);
+  return bounds;
+}
+
+uint64_t Canvas::rasterizeStrokeLine(const StrokeSegment& segment, const PixelRect& clip) {
+  const double x1 = segment.x1;
+  const double y1 = segment.y1;
+  const double pressure = segment.pressure;
+  const double opacity = segment.opacity;
+  const BrushTexture texture = segment.texture;
+  const FalloffTable& falloff = *segment.falloff;
+  const BrushImage* tip = segment.tip;
+  const BrushImage* grain = segment.textureNoise ? segment.grain : nullptr;
+  TileGrid& pixels = layers_.planes();
+  const int top = layers_.top(activeLayer_);
+  std::array<uint8_t, kTileSize> coverage;
+  // Tip and grain samples for the span being rasterized
+  std::array<uint8_t, kTileSize> tipRow;
+  std::array<uint8_t, kTileSize> grainRow;
+  uint64_t written = 0;
+  
+  // The eraser brings back the background on the base layer and clears
+  // alpha on the others; whatever color it was given is ignored
+  const bool erasing = texture == BrushTexture::Eraser;
+  const bool clearsAlpha = erasing && activeLayer_ != 0;
+  const uint32_t color = erasing ? backgroundColor_ : segment.color;
+  const ColorSpanKernel blendSpan = colorSpanKernel(clearsAlpha ? BlendMode::Erase : BlendMode::Normal);
+  // What a fully covered pixel becomes; an opaque hard tip writes it
+  // straight into the run its rim encloses and only blends the rim
+  uint32_t solid = color | 0xFF000000;
+  if (erasing) {
+    solid = clearsAlpha ? backgroundColor_ & 0x00FFFFFF : backgroundColor_;
+  }
+  const bool fills = falloff.hard && !tip && !grain && opacity * pressure >= 1.0;
+  
+  double adjustedSize = segment.size * (0.5 + 0.5 * pressure);
+  double dx = segment.x2 - x1;
+  double dy = segment.y2 - y1;
   double length = std::sqrt(dx * dx + dy * dy);
   
   if (length < 1.0) {
     int centerX = static_cast<int>(x1);
     int centerY = static_cast<int>(y1);
     int radius = static_cast<int>(adjustedSize / 2.0);
+    TipMapping mapping;
+    if (tip) {
+      mapping = TipMapping(*tip, radius);
+    }
     
-    for (int y = std::max(0, centerY - radius); y < std::min(height_, centerY + radius + 1); ++y) {
-      for (int x = std::max(0, centerX - radius); x < std::min(width_, centerX + radius + 1); ++x) {
-        double distance = std::sqrt(std::pow(x - centerX, 2) + std::pow(y - centerY, 2));
-        if (distance <= radius) {
-          double alpha = (1.0 - distance / radius) * opacity * pressure;
-          int index = y * width_ + x;
-          if (index >= 0 && index < pixelData_.size()) {
-            uint32_t existingColor = pixelData_[index];
-            
-            uint8_t existingR = (existingColor >> 16) & 0xFF;
-            uint8_t existingG = (existingColor >> 8) & 0xFF;
-            uint8_t existingB = existingColor & 0xFF;
-            uint8_t existingA = (existingColor >> 24) & 0xFF;
-            
-            uint8_t newR = (color >> 16) & 0xFF;
-            uint8_t newG = (color >> 8) & 0xFF;
-            uint8_t newB = color & 0xFF;
-            uint8_t newA = static_cast<uint8_t>(alpha * 255);
-            
-            double blendFactor = newA / 255.0;
-            uint8_t resultR = static_cast<uint8_t>(existingR * (1.0 - blendFactor) + newR * blendFactor);
-            uint8_t resultG = static_cast<uint8_t>(existingG * (1.0 - blendFactor) + newG * blendFactor);
-            uint8_t resultB = static_cast<uint8_t>(existingB * (1.0 - blendFactor) + newB * blendFactor);
-            uint8_t resultA = static_cast<uint8_t>(std::min(255.0, static_cast<double>(existingA + newA)));
-            
-            pixelData_[index] = (resultA << 24) | (resultR << 16) | (resultG << 8) | resultB;
+    for (int y = std::max(clip.y0, centerY - radius); y < std::min(clip.y1, centerY + radius + 1); ++y) {
+      int solidStart = 0;
+      int solidEnd = 0;
+      if (fills) {
+        solidRun(centerX, y - centerY, radius, solidStart, solidEnd);
+      }
+      const int xEnd = std::min(clip.x1, centerX + radius + 1);
+      int x = std::max(clip.x0, centerX - radius);
+      while (x < xEnd) {
+        // Walk the row one tile span at a time so each tile is detached
+        // once; coverage is worked out first and blended in one go
+        const int spanStart = x;
+        const int spanEnd = std::min(xEnd, TileGrid::spanEnd(x));
+        const int fillStart = std::clamp(solidStart, spanStart, spanEnd);
+        const int fillEnd = std::clamp(solidEnd, fillStart, spanEnd);
+        uint32_t* row = pixels.mutableSpan(spanStart, top + y);
+        if (tip) {
+          mapping.sample(*tip, spanStart - centerX, y - centerY, spanEnd - spanStart, tipRow.data());
+        }
+        if (grain) {
+          grain->sampleRow(0, spanStart + 0.5, y + 0.5, 1.0, spanEnd - spanStart, grainRow.data());
+        }
+        for (; x < spanEnd; ++x) {
+          if (x == fillStart && fillStart < fillEnd) {
+            std::fill(row + (fillStart - spanStart), row + (fillEnd - spanStart), solid);
+            written += fillEnd - fillStart;
+            x = fillEnd - 1;
+            continue;
           }
+          double distance = std::sqrt(std::pow(x - centerX, 2) + std::pow(y - centerY, 2));
+          if (distance > radius) {
+            coverage[x - spanStart] = 0;
+            continue;
+          }
+          double shape = falloff.hard ? hardEdge(distance, radius) : 1.0 - distance / radius;
+          if (tip) {
+            shape = tipRow[x - spanStart] * (1.0 / 255);
+          }
+          double alpha = shape * opacity * pressure;
+          if (grain) {
+            alpha *= grainRow[x - spanStart] * (1.0 / 255);
+          }
+          coverage[x - spanStart] = static_cast<uint8_t>(alpha * 255);
+          ++written;
+        }
+        blendSpan(row, color, coverage.data(), fillStart - spanStart);
+        blendSpan(row + (fillEnd - spanStart), color, coverage.data() + (fillEnd - spanStart), spanEnd - fillEnd);
+        if (texture == BrushTexture::Watercolor) {
+          wet(wetPaint_.mutableSpan(spanStart, y), coverage.data(), spanEnd - spanStart);
         }
       }
     }
-    return;
+    return written;
   }
   
   dx /= length;
   dy /= length;
   
-  double textureEffect = 1.0;
-  static std::random_device rd;
-  static std::mt19937 gen(rd());
-  static std::uniform_real_distribution<> dis(0.8, 1.2);
-  
-  if (texture == "chalk") {
-    textureEffect = 0.8 + 0.2 * dis(gen);
-  } else if (texture == "watercolor") {
-    textureEffect = 1.2;
-  }
+  double textureEffect = segment.textureEffect;
+  // Watercolor goes on thinner
+  const double coverageScale = texture == BrushTexture::Watercolor ? 255 * 0.7 : 255;
   
   const int steps = static_cast<int>(length) * 2; // More steps for smoother lines
   for (int i = 0; i <= steps; ++i) {
@@ -114,76 +375,91 @@ void Canvas::applyStrokeLine(double x1, double y1, double x2, double y2,
     int centerX = static_cast<int>(x);
     int centerY = static_cast<int>(y);
     int radius = static_cast<int>(brushSize / 2.0);
+    const double inverseRadius = radius > 0 ? 1.0 / radius : 0.0;
+    TipMapping mapping;
+    if (tip) {
+      mapping = TipMapping(*tip, radius);
+    }
     
-    for (int py = std::max(0, centerY - radius); py < std::min(height_, centerY + radius + 1); ++py) {
-      for (int px = std::max(0, centerX - radius); px < std::min(width_, centerX + radius + 1); ++px) {
-        double distance = std::sqrt(std::pow(px - x, 2) + std::pow(py - y, 2));
-        if (distance <= radius) {
-          double falloff = texture == "watercolor" ? 0.7 : 2.0;
-          double alpha = std::pow(1.0 - distance / radius, falloff) * opacity * pressure;
-          
-          if (texture == "chalk") {
-            double noise = std::sin(px * 0.8) * std::cos(py * 0.8) * 0.2 + 0.8;
-            alpha *= noise;
+    for (int py = std::max(clip.y0, centerY - radius); py < std::min(clip.y1, centerY + radius + 1); ++py) {
+      int solidStart = 0;
+      int solidEnd = 0;
+      if (fills) {
+        solidRun(x, py - y, radius, solidStart, solidEnd);
+      }
+      const int xEnd = std::min(clip.x1, centerX + radius + 1);
+      int px = std::max(clip.x0, centerX - radius);
+      while (px < xEnd) {
+        const int spanStart = px;
+        const int spanEnd = std::min(xEnd, TileGrid::spanEnd(px));
+        const int fillStart = std::clamp(solidStart, spanStart, spanEnd);
+        const int fillEnd = std::clamp(solidEnd, fillStart, spanEnd);
+        uint32_t* row = pixels.mutableSpan(spanStart, top + py);
+        if (tip) {
+          mapping.sample(*tip, spanStart - x, py - y, spanEnd - spanStart, tipRow.data());
+        }
+        if (grain) {
+          grain->sampleRow(0, spanStart + 0.5, py + 0.5, 1.0, spanEnd - spanStart, grainRow.data());
+        }
+        for (; px < spanEnd; ++px) {
+          if (px == fillStart && fillStart < fillEnd) {
+            std::fill(row + (fillStart - spanStart), row + (fillEnd - spanStart), solid);
+            written += fillEnd - fillStart;
+            px = fillEnd - 1;
+            continue;
+          }
+          double distance = std::sqrt(std::pow(px - x, 2) + std::pow(py - y, 2));
+          if (distance > radius) {
+            coverage[px - spanStart] = 0;
+            continue;
+          }
+          double shape = falloff.hard ? hardEdge(distance, radius) : falloff.sample(distance * inverseRadius);
+          if (tip) {
+            shape = tipRow[px - spanStart] * (1.0 / 255);
+          }
+          double alpha = shape * opacity * pressure;
+          if (grain) {
+            alpha *= grainRow[px - spanStart] * (1.0 / 255);
           }
           
-          int index = py * width_ + px;
-          if (index >= 0 && index < pixelData_.size()) {
-            uint32_t existingColor = pixelData_[index];
-            
-            uint8_t existingR = (existingColor >> 16) & 0xFF;
-            uint8_t existingG = (existingColor >> 8) & 0xFF;
-            uint8_t existingB = existingColor & 0xFF;
-            uint8_t existingA = (existingColor >> 24) & 0xFF;
-            
-            uint8_t newR = (color >> 16) & 0xFF;
-            uint8_t newG = (color >> 8) & 0xFF;
-            uint8_t newB = color & 0xFF;
-            uint8_t newA = static_cast<uint8_t>(alpha * 255);
-            
-            double blendFactor = newA / 255.0;
-            uint8_t resultR, resultG, resultB;
-            
-            if (texture == "watercolor") {
-              blendFactor *= 0.7;
-              resultR = static_cast<uint8_t>(existingR * (1.0 - blendFactor) + newR * blendFactor);
-              resultG = static_cast<uint8_t>(existingG * (1.0 - blendFactor) + newG * blendFactor);
-              resultB = static_cast<uint8_t>(existingB * (1.0 - blendFactor) + newB * blendFactor);
-            } else {
-              resultR = static_cast<uint8_t>(existingR * (1.0 - blendFactor) + newR * blendFactor);
-              resultG = static_cast<uint8_t>(existingG * (1.0 - blendFactor) + newG * blendFactor);
-              resultB = static_cast<uint8_t>(existingB * (1.0 - blendFactor) + newB * blendFactor);
-            }
-            
-            uint8_t resultA = static_cast<uint8_t>(std::min(255.0, existingA + newA * 0.5));
-            
-            pixelData_[index] = (resultA << 24) | (resultR << 16) | (resultG << 8) | resultB;
-            
-            if (texture == "watercolor") {
-              if ((index * 2 + 1) < fluidLayer_.size()) {
-                fluidLayer_[index * 2] += static_cast<uint8_t>(dx * pressure * 20);
-                fluidLayer_[index * 2 + 1] += static_cast<uint8_t>(dy * pressure * 20);
-              }
+          coverage[px - spanStart] = static_cast<uint8_t>(alpha * coverageScale);
+          ++written;
+          
+          if (texture == BrushTexture::Watercolor) {
+            int index = py * width_ + px;
+            if ((index * 2 + 1) < fluidLayer_.size()) {
+              fluidLayer_[index * 2] += static_cast<uint8_t>(dx * pressure * 20);
+              fluidLayer_[index * 2 + 1] += static_cast<uint8_t>(dy * pressure * 20);
             }
           }
         }
+        blendSpan(row, color, coverage.data(), fillStart - spanStart);
+        blendSpan(row + (fillEnd - spanStart), color, coverage.data() + (fillEnd - spanStart), spanEnd - fillEnd);
+        if (texture == BrushTexture::Watercolor) {
+          wet(wetPaint_.mutableSpan(spanStart, py), coverage.data(), spanEnd - spanStart);
+        }
       }
     }
   }
+  return written;
 }
 
-void Canvas::applyPhysics(double accelX, double accelY, double accelZ) {
+uint64_t Canvas::applyPhysics(double accelX, double accelY, double accelZ) {
   double accelMagnitude = std::sqrt(accelX * accelX + accelY * accelY + accelZ * accelZ);
   if (accelMagnitude < 0.5) {
-    return; 
+    return 0;
   }
   
   double normalizer = 1.0 / accelMagnitude;
   accelX *= normalizer;
   accelY *= normalizer;
   
-  std::vector<uint32_t> newPixelData = pixelData_;
+  // Copy-on-write: only the tiles that receive flow get duplicated
+  TileGrid& pixels = layers_.planes();
+  const int top = layers_.top(wetLayer_);
+  TileGrid newPixels = pixels;
   
+  uint64_t moved = 0;
   int flowX = static_cast<int>(accelX * 5);
   int flowY = static_cast<int>(accelY * 5);
   
@@ -208,121 +484,94 @@ void Canvas::applyPhysics(double accelX, double accelY, double accelZ) {
       int targetY = y + totalFlowY;
       
       if (targetX >= 0 && targetX < width_ && targetY >= 0 && targetY < height_) {
-        int targetIndex = targetY * width_ + targetX;
+        uint32_t sourceColor = pixels.pixel(x, top + y);
+        uint32_t targetColor = newPixels.pixel(targetX, top + targetY);
         
-        if (targetIndex >= 0 && targetIndex < newPixelData.size()) {
-          uint32_t sourceColor = pixelData_[sourceIndex];
-          uint32_t targetColor = newPixelData[targetIndex];
-          
-          uint8_t sourceA = (sourceColor >> 24) & 0xFF;
-          uint8_t sourceR = (sourceColor >> 16) & 0xFF;
-          uint8_t sourceG = (sourceColor >> 8) & 0xFF;
-          uint8_t sourceB = sourceColor & 0xFF;
-          
-          uint8_t targetA = (targetColor >> 24) & 0xFF;
-          uint8_t targetR = (targetColor >> 16) & 0xFF;
-          uint8_t targetG = (targetColor >> 8) & 0xFF;
-          uint8_t targetB = targetColor & 0xFF;
-          
-          double blendFactor = 0.1;
-          
-          uint8_t resultR = static_cast<uint8_t>(targetR * (1.0 - blendFactor) + sourceR * blendFactor);
-          uint8_t resultG = static_cast<uint8_t>(targetG * (1.0 - blendFactor) + sourceG * blendFactor);
-          uint8_t resultB = static_cast<uint8_t>(targetB * (1.0 - blendFactor) + sourceB * blendFactor);
-          uint8_t resultA = std::max(sourceA, targetA);
-          
-          newPixelData[targetIndex] = (resultA << 24) | (resultR << 16) | (resultG << 8) | resultB;
-          
-          fluidLayer_[fluidIndex] = static_cast<uint8_t>(velX * 0.95);
-          fluidLayer_[fluidIndex + 1] = static_cast<uint8_t>(velY * 0.95);
-        }
+        // About a tenth of the source carries over, less where it is translucent
+        const uint32_t alpha = div255((sourceColor >> 24) * kFlowAlpha);
+        newPixels.setPixel(targetX, top + targetY, blendPixel<BlendMode::Normal>(targetColor, sourceColor, alpha));
+        ++moved;
+        
+        fluidLayer_[fluidIndex] = static_cast<uint8_t>(velX * 0.95);
+        fluidLayer_[fluidIndex + 1] = static_cast<uint8_t>(velY * 0.95);
       }
     }
   }
   
-  pixelData_ = newPixelData;
+  pixels = std::move(newPixels);
+  return moved;
 }
 
-std::string Canvas::base64_encode(const std::vector<uint8_t>& input) {
-    static const char base64_chars[] = 
-        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-        "abcdefghijklmnopqrstuvwxyz"
-        "0123456789+/";
-        
-    std::string output;
-    int val = 0, valb = -6;
-    
-    for (uint8_t c : input) {
-        val = (val << 8) + c;
-        valb += 8;
-        while (valb >= 0) {
-            output.push_back(base64_chars[(val >> valb) & 0x3F]);
-            valb -= 6;
-        }
-    }
-    
-    if (valb > -6) {
-        output.push_back(base64_chars[((val << 8) >> (valb + 8)) & 0x3F]);
-    }
-    
-    // Add padding
-    while (output.size() % 4) {
-        output.push_back('=');
+bool Canvas::undo(uint64_t mark, UndoHistory::Marks& applied) {
+  history_.commit(layers_.planes(), UndoHistory::StepKind::Edit, mark);
+  restoredTiles_.clear();
+  if (!history_.undo(layers_.planes(), restoredTiles_, applied)) {
+    return false;
+  }
+  resetFluid(restoredTiles_);
+  return true;
+}
+
+bool Canvas::redo(uint64_t mark, UndoHistory::Marks& applied) {
+  history_.commit(layers_.planes(), UndoHistory::StepKind::Edit, mark);
+  restoredTiles_.clear();
+  if (!history_.redo(layers_.planes(), restoredTiles_, applied)) {
+    return false;
+  }
+  resetFluid(restoredTiles_);
+  return true;
+}
+
+void Canvas::resetFluid(const std::vector<int>& tiles) {
+  // Velocities and water are simulation state, not history; the restored
+  // pixels start out still and dry so an undone stroke doesn't keep flowing
+  const int tilesX = (width_ + kTileSize - 1) / kTileSize;
+  for (int planeTile : tiles) {
+    const int index = layers_.canvasTile(planeTile);
+    wetPaint_.dry(index);
+    const int x0 = (index % tilesX) * kTileSize;
+    const int y0 = (index / tilesX) * kTileSize;
+    const int x1 = std::min(x0 + kTileSize, width_);
+    const int y1 = std::min(y0 + kTileSize, height_);
+    for (int y = y0; y < y1; ++y) {
+      auto row = fluidLayer_.begin() + (static_cast<size_t>(y) * width_ + x0) * 2;
+      std::fill(row, row + (x1 - x0) * 2, 0);
     }
-    
-    return output;
+  }
 }
 
 std::string Canvas::getSnapshotAsBase64() {
-    const int headerSize = sizeof(BMPHeader);
-    const int rowSize = ((width_ * 24 + 31) / 32) * 4; // Row size must be multiple of 4 bytes
-    const int pixelDataSize = rowSize * height_;
-    const int fileSize = headerSize + pixelDataSize;
-    
-    BMPHeader header;
-    header.fileType = 0x4D42; 
-    header.fileSize = fileSize;
-    header.reserved1 = 0;
-    header.reserved2 = 0;
-    header.dataOffset = headerSize;
-    header.headerSize = 40;
-    header.width = width_;
-    header.height = -height_; // Negative for top-down image
-    header.planes = 1;
-    header.bitsPerPixel = 24; // 24-bit RGB
-    header.compression = 0;   // No compression
-    header.imageSize = pixelDataSize;
-    header.xPixelsPerM = 2835; // ~72 DPI
-    header.yPixelsPerM = 2835; // ~72 DPI
-    header.colorsUsed = 0;
-    header.colorsImportant = 0;
-    
-    // Create buffer for entire BMP file
-    std::vector<uint8_t> bmpData(fileSize);
-    
-    // Copy header to buffer
-    std::memcpy(bmpData.data(), &header, headerSize);
-    
-    // Copy pixel data to buffer
-    for (int y = 0; y < height_; ++y) {
-        for (int x = 0; x < width_; ++x) {
-            uint32_t pixel = pixelData_[y * width_ + x];
-            
-            uint8_t blue = pixel & 0xFF;
-            uint8_t green = (pixel >> 8) & 0xFF;
-            uint8_t red = (pixel >> 16) & 0xFF;
-            
-            int pos = headerSize + y * rowSize + x * 3;
-            
-            bmpData[pos] = blue;
-            bmpData[pos + 1] = green;
-            bmpData[pos + 2] = red;
-        }
-    }
-    
-    std::string base64Data = base64_encode(bmpData);
-    
-    return "data:image/bmp;base64," + base64Data;
+  return encodeBmpDataUrl(layers_.composite());
+}
+
+TileGrid Canvas::captureSnapshot() {
+  return layers_.composite();
+}
+
+void Canvas::refreshMips() {
+  const TileGrid& pixels = layers_.composite();
+  auto dirtyTiles = pixels.tilesChangedSince(mipsGeneration_);
+  if (!dirtyTiles.empty()) {
+    mips_.refresh(pixels, dirtyTiles);
+  }
+  mipsGeneration_ = pixels.generation();
+}
+
+std::string Canvas::getThumbnailAsBase64(int maxWidth) {
+  refreshMips();
+  int level = mips_.levelForWidth(maxWidth);
+  if (level == 0) {
+    return encodeBmpDataUrl(layers_.composite());
+  }
+  return encodeBmpDataUrl(mips_.levelPixels(level), mips_.levelWidth(level), mips_.levelHeight(level));
+}
+
+void Canvas::publishFrame() {
+  // Recomposited even with nobody watching, so generation() keeps up
+  const TileGrid& pixels = layers_.composite();
+  if (frameSink_->hasConsumer()) {
+    frameSink_->publish(pixels);
+  }
 }
 
-} // namespace facebook::react
\ No newline at end of file
+} // namespace facebook::react
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <jsi/jsi.h>
+#include <memory>
+#include "BrushPreset.h"
+#include "CanvasSession.h"
+
+namespace facebook::react {
+
+class NativeGestureCanvas;
+
+// Host object returned by createCanvasHandle. It holds the session itself, so
+// calls made through it skip the id lookups. Methods: beginStroke(point,
+// brushStyle), clear(), undo(), redo(), applyMotion(x, y, z), setSize(width,
+// height, scale = 1), getSnapshot(), dispose(); and the read-only `id` usable
+// with the id-based module methods.
+class CanvasHandle : public jsi::HostObject, public std::enable_shared_from_this<CanvasHandle> {
+public:
+  CanvasHandle(std::weak_ptr<NativeGestureCanvas> module, std::shared_ptr<CanvasSession> session);
+
+  jsi::Value get(jsi::Runtime& rt, const jsi::PropNameID& name) override;
+  std::vector<jsi::PropNameID> getPropertyNames(jsi::Runtime& rt) override;
+
+private:
+  std::weak_ptr<NativeGestureCanvas> module_;
+  std::shared_ptr<CanvasSession> session_; // Null once disposed
+  const int canvasId_;
+};
+
+// Host object for one stroke: addPoint(point), end(point), dispose(), `id`.
+// It points straight at the stroke, so neither side looks the stroke up per
+// point. A handle collected without end() leaves the stroke to its canvas.
+// It holds the canvas weakly, so a stroke handle kept after its canvas is
+// destroyed or disposed doesn't keep the canvas alive; its points are dropped.
+class StrokeHandle : public jsi::HostObject, public std::enable_shared_from_this<StrokeHandle> {
+public:
+  StrokeHandle(
+    std::weak_ptr<NativeGestureCanvas> module,
+    std::weak_ptr<CanvasSession> session,
+    std::shared_ptr<Stroke> stroke,
+    int strokeId
+  );
+
+  jsi::Value get(jsi::Runtime& rt, const jsi::PropNameID& name) override;
+  std::vector<jsi::PropNameID> getPropertyNames(jsi::Runtime& rt) override;
+
+private:
+  void submitPoint(jsi::Runtime& rt, RenderCommandType type, const jsi::Value* args, size_t count);
+
+  std::weak_ptr<NativeGestureCanvas> module_;
+  std::weak_ptr<CanvasSession> session_; // Reset once ended or disposed
+  std::shared_ptr<Stroke> stroke_;
+  const int strokeId_;
+};
+
+// Host object returned by registerBrushStyle. It has no properties of its
+// own; pass it anywhere a brush style object is accepted to skip reading and
+// resolving the style again.
+class BrushStyleHandle : public jsi::HostObject {
+public:
+  explicit BrushStyleHandle(std::shared_ptr<const BrushPreset> preset);
+
+  const std::shared_ptr<const BrushPreset>& preset() const { return preset_; }
+
+private:
+  std::shared_ptr<const BrushPreset> preset_;
+};
+
+} // namespace facebook::react
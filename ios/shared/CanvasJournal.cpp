@@ -0,0 +1,658 @@
+#include "CanvasJournal.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include "BrushPreset.h"
+#include "Stroke.h"
+
+namespace facebook::react {
+
+namespace {
+
+enum class JournalOp : uint8_t {
+  BeginStroke = 1,
+  AddPoint = 2,
+  AddPointTextureShed = 3, // Drawn without texture noise to make a frame
+  EndStroke = 4,
+  CancelStroke = 5,
+  Motion = 6,
+  Clear = 7,
+  Undo = 8,
+  Redo = 9,
+  HistoryBudget = 10,
+  DocumentOpened = 11,
+  Resize = 12,
+  Resample = 13,
+  AddLayer = 14,
+  LayerProperties = 15,
+  ActiveLayer = 16,
+  WetLayer = 17,
+  WetStep = 18,
+  Fill = 19,
+  BrushImage = 20,
+  BeginImageStroke = 21, // BeginStroke plus its tip and grain image ids
+};
+
+// Header flags
+constexpr size_t kFlagsOffset = 6;
+constexpr uint8_t kResampled = 1;
+
+// Keeps out-of-range input from overflowing the fixed-point conversion
+constexpr double kMaxCoordinate = 1e7;
+
+int64_t toFixed(double value, double scale) {
+  if (!std::isfinite(value)) {
+    return 0;
+  }
+  return std::llround(std::clamp(value, -kMaxCoordinate, kMaxCoordinate) * scale);
+}
+
+} // namespace
+
+CanvasJournal::CanvasJournal(int width, int height, uint32_t backgroundColor) {
+  writeRaw(kMagic);
+  writeRaw(kVersion);
+  writeRaw(uint16_t{0}); // Flags
+  writeRaw(static_cast<uint32_t>(width));
+  writeRaw(static_cast<uint32_t>(height));
+  writeRaw(backgroundColor);
+}
+
+PointData CanvasJournal::quantize(const PointData& point) {
+  PointData quantized;
+  quantized.x = toFixed(point.x, kPositionScale) / kPositionScale;
+  quantized.y = toFixed(point.y, kPositionScale) / kPositionScale;
+  quantized.pressure = toFixed(std::clamp(point.pressure, 0.0, 1.0), kPressureScale) / kPressureScale;
+  quantized.timestamp = static_cast<double>(toFixed(point.timestamp, 1.0));
+  return quantized;
+}
+
+void CanvasJournal::beginStroke(uint32_t serial, const BrushPreset& preset, const PointData& point) {
+  const uint32_t tip = imageId(preset.image(BrushImageKind::Tip));
+  const uint32_t grain = imageId(preset.image(BrushImageKind::Grain));
+  const BrushStyleData& brush = preset.style();
+  const bool images = tip != 0 || grain != 0;
+  writeRaw(images ? JournalOp::BeginImageStroke : JournalOp::BeginStroke);
+  writeVarint(serial);
+  writeRaw(brush.size);
+  writeRaw(brush.opacity);
+  writeRaw(brush.color);
+  writeRaw(brush.texture);
+  writeRaw(brush.dampening);
+  writeRaw(brush.fluidResponse);
+  writePointDelta(PointData{0.0, 0.0, 0.0, 0.0}, point);
+  if (images) {
+    writeVarint(tip);
+    writeVarint(grain);
+  }
+}
+
+size_t CanvasJournal::addPoint(uint32_t serial, const PointData& previous, const PointData& point) {
+  const size_t record = bytes_.size();
+  writeRaw(JournalOp::AddPoint);
+  writeVarint(serial);
+  writePointDelta(previous, point);
+  return record;
+}
+
+void CanvasJournal::markTextureShed(size_t record) {
+  bytes_[record] = static_cast<uint8_t>(JournalOp::AddPointTextureShed);
+}
+
+void CanvasJournal::endStroke(uint32_t serial, const PointData& previous, const PointData& point) {
+  writeRaw(JournalOp::EndStroke);
+  writeVarint(serial);
+  writePointDelta(previous, point);
+}
+
+void CanvasJournal::cancelStroke(uint32_t serial) {
+  writeRaw(JournalOp::CancelStroke);
+  writeVarint(serial);
+}
+
+void CanvasJournal::motion(const double acceleration[3]) {
+  writeRaw(JournalOp::Motion);
+  for (int i = 0; i < 3; ++i) {
+    writeRaw(static_cast<float>(acceleration[i]));
+  }
+}
+
+void CanvasJournal::clear() {
+  writeRaw(JournalOp::Clear);
+}
+
+void CanvasJournal::fill(const PointData& point, uint32_t color, uint8_t tolerance) {
+  writeRaw(JournalOp::Fill);
+  writeSigned(toFixed(point.x, kPositionScale));
+  writeSigned(toFixed(point.y, kPositionScale));
+  writeRaw(color);
+  writeRaw(tolerance);
+}
+
+void CanvasJournal::undo(const UndoHistory::Marks& applied) {
+  writeRaw(JournalOp::Undo);
+  writeStep(applied);
+}
+
+void CanvasJournal::redo(const UndoHistory::Marks& applied) {
+  writeRaw(JournalOp::Redo);
+  writeStep(applied);
+}
+
+void CanvasJournal::historyBudget(size_t bytes) {
+  writeRaw(JournalOp::HistoryBudget);
+  writeVarint(bytes);
+}
+
+void CanvasJournal::documentOpened() {
+  writeRaw(JournalOp::DocumentOpened);
+}
+
+void CanvasJournal::resize(int width, int height, double scale) {
+  writeRaw(JournalOp::Resize);
+  writeVarint(static_cast<uint32_t>(width));
+  writeVarint(static_cast<uint32_t>(height));
+  writeRaw(scale);
+}
+
+void CanvasJournal::resample(int width, int height, ResampleMode mode) {
+  bytes_[kFlagsOffset] |= kResampled;
+  writeRaw(JournalOp::Resample);
+  writeVarint(static_cast<uint32_t>(width));
+  writeVarint(static_cast<uint32_t>(height));
+  writeRaw(mode);
+}
+
+bool CanvasJournal::resampled() const {
+  return bytes_[kFlagsOffset] & kResampled;
+}
+
+void CanvasJournal::addLayer() {
+  writeRaw(JournalOp::AddLayer);
+}
+
+void CanvasJournal::layerProperties(int layer, const LayerProperties& properties) {
+  writeRaw(JournalOp::LayerProperties);
+  writeVarint(static_cast<uint32_t>(layer));
+  writeRaw(properties.opacity);
+  writeRaw(static_cast<uint8_t>(properties.visible));
+  writeRaw(properties.blendMode);
+}
+
+void CanvasJournal::activeLayer(int layer) {
+  writeRaw(JournalOp::ActiveLayer);
+  writeVarint(static_cast<uint32_t>(layer));
+}
+
+void CanvasJournal::wetLayer(int layer) {
+  writeRaw(JournalOp::WetLayer);
+  writeVarint(static_cast<uint32_t>(layer));
+}
+
+void CanvasJournal::wetStep() {
+  writeRaw(JournalOp::WetStep);
+}
+
+void CanvasJournal::writeVarint(uint64_t value) {
+  while (value >= 0x80) {
+    bytes_.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  bytes_.push_back(static_cast<uint8_t>(value));
+}
+
+void CanvasJournal::writeSigned(int64_t value) {
+  // Zigzag, so small negative deltas stay small
+  writeVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void CanvasJournal::writeStep(const UndoHistory::Marks& applied) {
+  // Length, then how far back it began from this record: both small
+  const uint64_t record = bytes_.size() - 1;
+  writeVarint(applied.end - applied.begin);
+  if (applied.end > applied.begin) {
+    writeVarint(record - applied.begin);
+  }
+}
+
+void CanvasJournal::writePointDelta(const PointData& previous, const PointData& point) {
+  writeSigned(toFixed(point.x, kPositionScale) - toFixed(previous.x, kPositionScale));
+  writeSigned(toFixed(point.y, kPositionScale) - toFixed(previous.y, kPositionScale));
+  writeSigned(toFixed(point.pressure, kPressureScale) - toFixed(previous.pressure, kPressureScale));
+  writeSigned(toFixed(point.timestamp, 1.0) - toFixed(previous.timestamp, 1.0));
+}
+
+uint32_t CanvasJournal::imageId(const std::shared_ptr<const BrushImage>& image) {
+  if (!image) {
+    return 0;
+  }
+  auto known = imageIds_.find(image.get());
+  if (known != imageIds_.end()) {
+    return known->second;
+  }
+  // A journal continued from a document starts numbering over; the reader
+  // takes the latest record for an id, so reused ids stay correct
+  const uint32_t id = static_cast<uint32_t>(images_.size()) + 1;
+  imageIds_[image.get()] = id;
+  images_.push_back(image);
+  const int width = image->levelWidth(0);
+  const int height = image->levelHeight(0);
+  writeRaw(JournalOp::BrushImage);
+  writeVarint(id);
+  writeRaw(image->kind());
+  writeVarint(static_cast<uint32_t>(width));
+  writeVarint(static_cast<uint32_t>(height));
+  const uint8_t* pixels = image->levelPixels(0);
+  bytes_.insert(bytes_.end(), pixels, pixels + static_cast<size_t>(width) * height);
+  return id;
+}
+
+template <typename T>
+void CanvasJournal::writeRaw(T value) {
+  // Native byte order; every platform we ship on is little-endian
+  const size_t offset = bytes_.size();
+  bytes_.resize(offset + sizeof(T));
+  std::memcpy(bytes_.data() + offset, &value, sizeof(T));
+}
+
+JournalReader::JournalReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+bool JournalReader::readHeader(JournalHeader& header) {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t flags;
+  uint32_t width;
+  uint32_t height;
+  if (!readRaw(magic) || !readRaw(version) || !readRaw(flags) ||
+      !readRaw(width) || !readRaw(height) || !readRaw(header.backgroundColor) ||
+      magic != CanvasJournal::kMagic || version != CanvasJournal::kVersion) {
+    unsupportedVersion_ = magic == CanvasJournal::kMagic && version != CanvasJournal::kVersion;
+    failed_ = true;
+    return false;
+  }
+  header.width = static_cast<int>(width);
+  header.height = static_cast<int>(height);
+  return true;
+}
+
+bool JournalReader::next(RenderCommand& command) {
+  // Image records are not commands; they define images for the strokes after them
+  while (!failed_ && offset_ < size_ && data_[offset_] == static_cast<uint8_t>(JournalOp::BrushImage)) {
+    ++offset_;
+    failed_ = !readImageRecord();
+  }
+  if (failed_ || offset_ >= size_) {
+    return false;
+  }
+  
+  command = RenderCommand();
+  JournalOp op{};
+  uint64_t serial = 0;
+  bool ok = readRaw(op);
+  switch (op) {
+    case JournalOp::BeginStroke:
+    case JournalOp::BeginImageStroke: {
+      BrushStyleData brush;
+      PointData point;
+      ok = ok && readVarint(serial) && readRaw(brush.size) && readRaw(brush.opacity) &&
+           readRaw(brush.color) && readRaw(brush.texture) && readRaw(brush.dampening) &&
+           readRaw(brush.fluidResponse) && readPointDelta(PointData{0.0, 0.0, 0.0, 0.0}, point) &&
+           brush.texture <= BrushTexture::Eraser;
+      // Images come from the journal only, so a replay draws what was drawn
+      // whatever the atlas holds now
+      std::shared_ptr<const BrushImage> tip;
+      std::shared_ptr<const BrushImage> grain;
+      if (op == JournalOp::BeginImageStroke) {
+        ok = ok && readImage(BrushImageKind::Tip, tip) && readImage(BrushImageKind::Grain, grain);
+      }
+      if (ok) {
+        auto stroke = std::make_shared<Stroke>(std::make_shared<BrushPreset>(brush, std::move(tip), std::move(grain)));
+        strokes_[static_cast<uint32_t>(serial)] = {stroke, point};
+        command.type = RenderCommandType::BeginStroke;
+        command.stroke = std::move(stroke);
+        command.point = point;
+      }
+      break;
+    }
+    
+    case JournalOp::AddPoint:
+    case JournalOp::AddPointTextureShed:
+    case JournalOp::EndStroke: {
+      ok = ok && readVarint(serial);
+      auto entry = strokes_.find(static_cast<uint32_t>(serial));
+      ok = ok && entry != strokes_.end() && readPointDelta(entry->second.last, command.point);
+      if (ok) {
+        entry->second.last = command.point;
+        command.stroke = entry->second.stroke;
+        command.textureShed = op == JournalOp::AddPointTextureShed;
+        command.type = op == JournalOp::EndStroke ? RenderCommandType::EndStroke : RenderCommandType::AddPoint;
+        if (op == JournalOp::EndStroke) {
+          strokes_.erase(entry);
+        }
+      }
+      break;
+    }
+    
+    case JournalOp::CancelStroke: {
+      ok = ok && readVarint(serial);
+      auto entry = strokes_.find(static_cast<uint32_t>(serial));
+      ok = ok && entry != strokes_.end();
+      if (ok) {
+        command.type = RenderCommandType::CancelStroke;
+        command.stroke = std::move(entry->second.stroke);
+        strokes_.erase(entry);
+      }
+      break;
+    }
+    
+    case JournalOp::Motion:
+      command.type = RenderCommandType::ApplyMotion;
+      for (int i = 0; ok && i < 3; ++i) {
+        float value = 0;
+        ok = readRaw(value);
+        command.acceleration[i] = value;
+      }
+      break;
+    
+    case JournalOp::Clear:
+      command.type = RenderCommandType::Clear;
+      break;
+    
+    case JournalOp::Fill: {
+      int64_t x = 0;
+      int64_t y = 0;
+      ok = ok && readSigned(x) && readSigned(y) && readRaw(command.color) && readRaw(command.tolerance);
+      command.type = RenderCommandType::Fill;
+      command.point.x = x / CanvasJournal::kPositionScale;
+      command.point.y = y / CanvasJournal::kPositionScale;
+      break;
+    }
+    
+    case JournalOp::Undo:
+    case JournalOp::Redo: {
+      const uint64_t record = offset_ - 1;
+      uint64_t length = 0;
+      uint64_t distance = 0;
+      ok = ok && readVarint(length) && (length == 0 || (readVarint(distance) && distance >= length && distance <= record));
+      command.type = op == JournalOp::Undo ? RenderCommandType::Undo : RenderCommandType::Redo;
+      command.stepBegin = record - distance;
+      command.stepEnd = command.stepBegin + length;
+      break;
+    }
+    
+    case JournalOp::HistoryBudget: {
+      uint64_t bytes = 0;
+      ok = ok && readVarint(bytes);
+      command.type = RenderCommandType::SetHistoryBudget;
+      command.historyBudget = static_cast<size_t>(bytes);
+      break;
+    }
+    
+    case JournalOp::DocumentOpened:
+      command.type = RenderCommandType::DocumentOpened;
+      // Strokes left open at the save never get another record
+      strokes_.clear();
+      break;
+    
+    case JournalOp::Resize:
+    case JournalOp::Resample: {
+      constexpr uint64_t kMaxDimension = kMaxCanvasDimension;
+      uint64_t width = 0;
+      uint64_t height = 0;
+      ok = ok && readVarint(width) && readVarint(height) &&
+           width > 0 && height > 0 && width <= kMaxDimension && height <= kMaxDimension;
+      if (op == JournalOp::Resize) {
+        ok = ok && readRaw(command.scale) && command.scale > 0.0 && command.scale <= kMaxCanvasScale;
+        command.type = RenderCommandType::Resize;
+      } else {
+        ok = ok && readRaw(command.resampleMode) && command.resampleMode <= ResampleMode::Area;
+        command.type = RenderCommandType::Resample;
+      }
+      command.width = static_cast<int>(width);
+      command.height = static_cast<int>(height);
+      break;
+    }
+    
+    case JournalOp::AddLayer:
+      command.type = RenderCommandType::AddLayer;
+      break;
+    
+    case JournalOp::LayerProperties:
+    case JournalOp::ActiveLayer:
+    case JournalOp::WetLayer: {
+      uint64_t layer = 0;
+      ok = ok && readVarint(layer) && layer < LayerStack::kMaxLayers;
+      if (op == JournalOp::LayerProperties) {
+        uint8_t visible = 0;
+        LayerProperties& properties = command.layerProperties;
+        ok = ok && readRaw(properties.opacity) && readRaw(visible) && visible <= 1 &&
+             readRaw(properties.blendMode) && properties.blendMode <= BlendMode::Erase;
+        properties.visible = visible != 0;
+        command.type = RenderCommandType::SetLayerProperties;
+      } else {
+        command.type = op == JournalOp::ActiveLayer ? RenderCommandType::SetActiveLayer
+                                                    : RenderCommandType::SetWetLayer;
+      }
+      command.layer = static_cast<int>(layer);
+      break;
+    }
+    
+    case JournalOp::WetStep:
+      command.type = RenderCommandType::WetStep;
+      break;
+    
+    default:
+      ok = false;
+      break;
+  }
+  
+  // Strokes are matched by serial, which is also a fine command stroke id
+  command.strokeId = static_cast<int>(serial);
+  failed_ = !ok;
+  return ok;
+}
+
+void JournalReader::extend(const uint8_t* data, size_t size) {
+  data_ = data;
+  size_ = size;
+}
+
+bool JournalReader::readImageRecord() {
+  uint64_t id = 0;
+  BrushImageKind kind{};
+  uint64_t width = 0;
+  uint64_t height = 0;
+  if (!readVarint(id) || id == 0 || id > UINT32_MAX || !readRaw(kind) || kind > BrushImageKind::Grain ||
+      !readVarint(width) || !readVarint(height) || width == 0 || height == 0 ||
+      width > BrushImage::kMaxSize || height > BrushImage::kMaxSize || width * height > size_ - offset_) {
+    return false;
+  }
+  images_[static_cast<uint32_t>(id)] = std::make_shared<BrushImage>(
+      static_cast<int>(width), static_cast<int>(height), data_ + offset_, kind);
+  offset_ += width * height;
+  return true;
+}
+
+bool JournalReader::readImage(BrushImageKind kind, std::shared_ptr<const BrushImage>& image) {
+  uint64_t id = 0;
+  if (!readVarint(id)) {
+    return false;
+  }
+  if (id == 0) {
+    return true;
+  }
+  auto known = images_.find(static_cast<uint32_t>(id));
+  if (id > UINT32_MAX || known == images_.end() || known->second->kind() != kind) {
+    return false;
+  }
+  image = known->second;
+  return true;
+}
+
+bool JournalReader::readVarint(uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (offset_ >= size_) {
+      return false;
+    }
+    const uint8_t byte = data_[offset_++];
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool JournalReader::readSigned(int64_t& value) {
+  uint64_t encoded;
+  if (!readVarint(encoded)) {
+    return false;
+  }
+  value = static_cast<int64_t>(encoded >> 1) ^ -static_cast<int64_t>(encoded & 1);
+  return true;
+}
+
+bool JournalReader::readPointDelta(const PointData& previous, PointData& point) {
+  int64_t dx, dy, dPressure, dTime;
+  if (!readSigned(dx) || !readSigned(dy) || !readSigned(dPressure) || !readSigned(dTime)) {
+    return false;
+  }
+  constexpr double kPosition = CanvasJournal::kPositionScale;
+  constexpr double kPressure = CanvasJournal::kPressureScale;
+  point.x = (std::llround(previous.x * kPosition) + dx) / kPosition;
+  point.y = (std::llround(previous.y * kPosition) + dy) / kPosition;
+  point.pressure = (std::llround(previous.pressure * kPressure) + dPressure) / kPressure;
+  point.timestamp = static_cast<double>(std::llround(previous.timestamp) + dTime);
+  return true;
+}
+
+template <typename T>
+bool JournalReader::readRaw(T& value) {
+  if (size_ - offset_ < sizeof(T)) {
+    return false;
+  }
+  std::memcpy(&value, data_ + offset_, sizeof(T));
+  offset_ += sizeof(T);
+  return true;
+}
+
+JournalModelReader::JournalModelReader(const uint8_t* data, size_t size) : reader_(data, size) {
+  JournalReader scan(data, size);
+  JournalHeader header;
+  if (!scan.readHeader(header)) {
+    return;
+  }
+  std::unordered_map<int, size_t> openStrokes;
+  std::vector<UndoHistory::Marks> steps;
+  std::vector<size_t> clears;
+  RenderCommand command;
+  for (size_t offset = scan.offset(); scan.next(command); offset = scan.offset()) {
+    switch (command.type) {
+      case RenderCommandType::BeginStroke:
+        openStrokes[command.strokeId] = offset;
+        break;
+      case RenderCommandType::EndStroke:
+      case RenderCommandType::CancelStroke:
+        strokeEnds_[openStrokes[command.strokeId]] = offset;
+        openStrokes.erase(command.strokeId);
+        break;
+      case RenderCommandType::DocumentOpened:
+        // Strokes left open at the save end here
+        for (const auto& [serial, begin] : openStrokes) {
+          strokeEnds_[begin] = offset;
+        }
+        openStrokes.clear();
+        break;
+      case RenderCommandType::Clear:
+        clears.push_back(offset);
+        break;
+      case RenderCommandType::Undo:
+        if (command.stepEnd > command.stepBegin) {
+          steps.push_back({command.stepBegin, command.stepEnd});
+        }
+        break;
+      case RenderCommandType::Redo:
+        // Brings back the step undone last
+        for (auto it = steps.rbegin(); command.stepEnd > command.stepBegin && it != steps.rend(); ++it) {
+          if (it->begin == command.stepBegin && it->end == command.stepEnd) {
+            steps.erase(std::next(it).base());
+            break;
+          }
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  // A stroke still open at the end of the journal is still on the canvas
+  for (const auto& [serial, begin] : openStrokes) {
+    strokeEnds_[begin] = size;
+  }
+  failed_ = scan.failed();
+  std::sort(steps.begin(), steps.end(), [](const auto& a, const auto& b) { return a.begin < b.begin; });
+  undone_ = std::move(steps);
+  for (auto it = clears.rbegin(); it != clears.rend(); ++it) {
+    if (!undone(*it, *it)) {
+      lastClear_ = *it;
+      break;
+    }
+  }
+}
+
+bool JournalModelReader::next(RenderCommand& command) {
+  for (size_t offset = reader_.offset(); reader_.next(command); offset = reader_.offset()) {
+    switch (command.type) {
+      case RenderCommandType::BeginStroke: {
+        const size_t end = strokeEnds_[offset];
+        const bool kept = end > lastClear_ && !undone(offset, end);
+        keptStrokes_[command.strokeId] = kept;
+        if (kept) {
+          return true;
+        }
+        break;
+      }
+      case RenderCommandType::AddPoint:
+        if (keptStrokes_[command.strokeId]) {
+          return true;
+        }
+        break;
+      case RenderCommandType::EndStroke:
+      case RenderCommandType::CancelStroke: {
+        const bool kept = keptStrokes_[command.strokeId];
+        keptStrokes_.erase(command.strokeId);
+        if (kept) {
+          return true;
+        }
+        break;
+      }
+      case RenderCommandType::Fill:
+      case RenderCommandType::Clear:
+        if (offset >= lastClear_ && !undone(offset, offset)) {
+          return true;
+        }
+        break;
+      case RenderCommandType::DocumentOpened:
+        keptStrokes_.clear();
+        return true;
+      case RenderCommandType::ApplyMotion:
+      case RenderCommandType::WetStep:
+      case RenderCommandType::Undo:
+      case RenderCommandType::Redo:
+        break;
+      default:
+        return true;
+    }
+  }
+  return false;
+}
+
+bool JournalModelReader::undone(size_t offset, size_t end) const {
+  // Steps never overlap, so only the last one beginning at or before offset can hold it
+  auto after = std::upper_bound(undone_.begin(), undone_.end(), offset,
+                                [](size_t value, const UndoHistory::Marks& step) { return value < step.begin; });
+  return after != undone_.begin() && end < std::prev(after)->end;
+}
+
+} // namespace facebook::react
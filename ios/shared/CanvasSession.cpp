@@ -0,0 +1,639 @@
+#include "CanvasSession.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+
+namespace facebook::react {
+
+CanvasSession::CanvasSession(int canvasId, int width, int height, uint32_t backgroundColor,
+                             std::shared_ptr<PerfStats> perfStats)
+    : canvasId_(canvasId), canvas_(width, height, backgroundColor),
+      journal_(width, height, backgroundColor), perfStats_(std::move(perfStats)) {
+  FrameSinkRegistry::add(canvasId_, canvas_.frameSink());
+}
+
+CanvasSession::CanvasSession(int canvasId, const std::shared_ptr<CanvasDocument>& document,
+                             std::shared_ptr<PerfStats> perfStats)
+    : canvasId_(canvasId), canvas_(document),
+      journal_(document->hasJournal()
+                 ? CanvasJournal(document->journal())
+                 : CanvasJournal(document->width(), document->height(), document->backgroundColor())),
+      nextStrokeSerial_(document->nextStrokeSerial()), journalComplete_(document->hasJournal()),
+      perfStats_(std::move(perfStats)) {
+  // Strokes in flight and history aren't saved; replay drops them here too
+  journal_.documentOpened();
+  FrameSinkRegistry::add(canvasId_, canvas_.frameSink());
+}
+
+CanvasSession::CanvasSession(int width, int height, uint32_t backgroundColor, std::shared_ptr<PerfStats> perfStats)
+    : canvasId_(0), registered_(false), canvas_(width, height, backgroundColor),
+      journal_(width, height, backgroundColor), perfStats_(std::move(perfStats)) {}
+
+CanvasSession::~CanvasSession() {
+  if (registered_) {
+    FrameSinkRegistry::remove(canvasId_);
+  }
+}
+
+void CanvasSession::apply(const std::vector<RenderCommand*>& commands, WorkerPool& rasterWorkers,
+                          uint64_t rasterDeadline) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (applyCommands(commands, rasterWorkers, rasterDeadline)) {
+    canvas_.publishFrame();
+  }
+}
+
+void CanvasSession::publishFrame() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  canvas_.publishFrame();
+}
+
+bool CanvasSession::applyCommands(const std::vector<RenderCommand*>& commands, WorkerPool& rasterWorkers,
+                                  uint64_t rasterDeadline) {
+  bool drawn = false;
+  for (size_t i = 0; i < commands.size();) {
+    // A run of points (everything that arrived this frame, possibly from
+    // several strokes) is rasterized in one tile-parallel pass; anything
+    // else is applied in order
+    size_t runEnd = i;
+    while (runEnd < commands.size() && commands[runEnd]->type == RenderCommandType::AddPoint) {
+      ++runEnd;
+    }
+    if (runEnd - i > 1) {
+      rasterizeConcurrently(commands.data() + i, runEnd - i, rasterWorkers, rasterDeadline);
+      drawn = true;
+      i = runEnd;
+      continue;
+    }
+    
+    RenderCommand* command = commands[i++];
+    if (command->type == RenderCommandType::Resize) {
+      resize(*command, rasterWorkers);
+      drawn = true;
+      continue;
+    }
+    if (command->type == RenderCommandType::Resample) {
+      resample(*command, rasterWorkers);
+      drawn = true;
+      continue;
+    }
+    if (command->type == RenderCommandType::Fill) {
+      fill(*command, rasterWorkers);
+      drawn = true;
+      continue;
+    }
+    applyCommand(*command, rasterDeadline);
+    drawn |= command->type == RenderCommandType::AddPoint ||
+             command->type == RenderCommandType::ApplyMotion ||
+             command->type == RenderCommandType::Clear ||
+             command->type == RenderCommandType::Undo ||
+             command->type == RenderCommandType::Redo ||
+             command->type == RenderCommandType::AddLayer ||
+             command->type == RenderCommandType::SetLayerProperties ||
+             command->type == RenderCommandType::WetStep;
+  }
+  return drawn;
+}
+
+void CanvasSession::resize(const RenderCommand& command, WorkerPool& rasterWorkers) {
+  if (rerasterizing_) {
+    // Already drawing at the final size; this only changes the scale the
+    // points that follow were captured at
+    inputScale_ = command.scale;
+    return;
+  }
+  cancelStrokes();
+  
+  if (!journalComplete_ || journal_.resampled()) {
+    // Nothing to redraw from, so the pixels are cropped or padded as they
+    // are and drawing carries on unscaled
+    PerfStats::Scope timing(*perfStats_, PerfOperation::Rerasterize);
+    timing.setPixels(static_cast<uint64_t>(command.width) * command.height);
+    canvas_.resize(command.width, command.height);
+    journal_.resize(command.width, command.height, command.scale);
+    inputScale_ = command.scale;
+    rasterScale_ = command.scale;
+    redrawId_.store(0, std::memory_order_release);
+    return;
+  }
+  
+  {
+    // Stands in until the redraw lands; drawing carries on over it at the new scale
+    PerfStats::Scope timing(*perfStats_, PerfOperation::Resample);
+    timing.setPixels(static_cast<uint64_t>(command.width) * command.height);
+    canvas_.resample(command.width, command.height, ResampleMode::Bilinear, rasterWorkers);
+  }
+  journal_.resize(command.width, command.height, command.scale);
+  inputScale_ = command.scale;
+  rasterScale_ = command.scale;
+  
+  // Supersedes a redraw still running, which this one covers
+  const uint64_t redrawId = ++redrawCount_;
+  redrawId_.store(redrawId, std::memory_order_release);
+  rasterWorkers.post([live = weak_from_this(), redrawId, journal = journal_, nextStrokeSerial = nextStrokeSerial_,
+                      width = canvas_.width(), height = canvas_.height(), backgroundColor = canvas_.backgroundColor(),
+                      scale = command.scale, perfStats = perfStats_, &rasterWorkers] {
+    CanvasSession scratch(width, height, backgroundColor, perfStats);
+    scratch.rasterScale_ = scale;
+    scratch.redraw(live, redrawId, journal, nextStrokeSerial, rasterWorkers);
+  });
+}
+
+void CanvasSession::redraw(const std::weak_ptr<CanvasSession>& live, uint64_t redrawId, const CanvasJournal& journal,
+                           uint32_t nextStrokeSerial, WorkerPool& rasterWorkers) {
+  const auto wanted = [&live, redrawId] {
+    auto session = live.lock();
+    return session && session->redrawId_.load(std::memory_order_acquire) == redrawId;
+  };
+  {
+    PerfStats::Scope timing(*perfStats_, PerfOperation::Rerasterize);
+    timing.setPixels(static_cast<uint64_t>(canvas_.width()) * canvas_.height());
+    JournalModelReader model(journal.bytes().data(), journal.bytes().size());
+    JournalHeader header;
+    model.readHeader(header);
+    // The model's points are at the scales its resizes say; replay writes
+    // a journal of its own, which is thrown away
+    inputScale_ = 1.0;
+    rerasterizing_ = true;
+    if (!replay(model, rasterWorkers, wanted)) {
+      return;
+    }
+    rerasterizing_ = false;
+  }
+  
+  // From here on this session follows live record for record, so it writes
+  // the same journal and marks its history with live's offsets
+  inputScale_ = rasterScale_;
+  journal_ = journal;
+  nextStrokeSerial_ = nextStrokeSerial;
+  canvas_.forgetHistory();
+  canvas_.dryWetPaint();
+  
+  std::vector<uint8_t> bytes = journal.bytes();
+  JournalReader tail(bytes.data(), bytes.size());
+  JournalHeader header;
+  tail.readHeader(header);
+  for (RenderCommand skipped; tail.next(skipped);) {
+  }
+  
+  // Catch up with what live journaled meanwhile: off its lock while there
+  // is much of it, the last few records under it before handing over
+  constexpr size_t kHandOverBytes = 1024;
+  for (;;) {
+    auto session = live.lock();
+    if (!session) {
+      return;
+    }
+    std::unique_lock<std::mutex> lock(session->mutex_);
+    if (session->redrawId_.load(std::memory_order_acquire) != redrawId) {
+      return;
+    }
+    const std::vector<uint8_t>& liveBytes = session->journal_.bytes();
+    const size_t caughtUp = bytes.size();
+    bytes.insert(bytes.end(), liveBytes.begin() + static_cast<ptrdiff_t>(caughtUp), liveBytes.end());
+    tail.extend(bytes.data(), bytes.size());
+    if (bytes.size() - caughtUp > kHandOverBytes) {
+      lock.unlock();
+      session.reset();
+      if (!replay(tail, rasterWorkers, wanted)) {
+        return;
+      }
+      continue;
+    }
+    replay(tail, rasterWorkers, [] { return true; });
+    session->canvas_.adopt(canvas_);
+    session->redrawId_.store(0, std::memory_order_release);
+    session->canvas_.publishFrame();
+    return;
+  }
+}
+
+template <typename Reader>
+bool CanvasSession::replay(Reader& reader, WorkerPool& rasterWorkers, const std::function<bool()>& wanted) {
+  // In chunks so the decoded commands stay small; runs of points still go
+  // through the tile-parallel path, and texture noise is only dropped where
+  // the journal says it was
+  constexpr size_t kChunkSize = 4096;
+  std::vector<RenderCommand> chunk;
+  std::vector<RenderCommand*> pointers;
+  chunk.reserve(kChunkSize);
+  pointers.reserve(kChunkSize);
+  for (bool more = true; more;) {
+    if (!wanted()) {
+      return false;
+    }
+    chunk.clear();
+    RenderCommand replayed;
+    while (chunk.size() < kChunkSize && (more = reader.next(replayed))) {
+      chunk.push_back(std::move(replayed));
+    }
+    pointers.clear();
+    for (auto& replayedCommand : chunk) {
+      pointers.push_back(&replayedCommand);
+    }
+    applyCommands(pointers, rasterWorkers, UINT64_MAX);
+  }
+  return true;
+}
+
+void CanvasSession::resample(const RenderCommand& command, WorkerPool& rasterWorkers) {
+  PerfStats::Scope timing(*perfStats_, PerfOperation::Resample);
+  timing.setPixels(static_cast<uint64_t>(command.width) * command.height);
+  cancelStrokes();
+  // The pixels a pending redraw would bring back are gone from the journal now
+  redrawId_.store(0, std::memory_order_release);
+  journal_.resample(command.width, command.height, command.resampleMode);
+  canvas_.resample(command.width, command.height, command.resampleMode, rasterWorkers);
+}
+
+void CanvasSession::fill(RenderCommand& command, WorkerPool& rasterWorkers) {
+  PerfStats::Scope timing(*perfStats_, PerfOperation::FloodFill);
+  command.point = CanvasJournal::quantize(command.point);
+  // Steps begin before their first record, so the record falls inside
+  canvas_.beginHistoryStep(journalMark());
+  journal_.fill(command.point, command.color, command.tolerance);
+  
+  // Exactly 1 unless a redraw is replaying a fill made at another scale
+  const double scale = rasterScale_ / inputScale_;
+  timing.setPixels(canvas_.floodFill(static_cast<int>(std::floor(command.point.x * scale)),
+                                     static_cast<int>(std::floor(command.point.y * scale)),
+                                     command.color, command.tolerance, rasterWorkers));
+  if (strokes_.empty()) {
+    canvas_.commitHistoryStep(journalMark());
+  }
+}
+
+void CanvasSession::cancelStrokes() {
+  // Producers still holding these strokes see them inactive and stop
+  for (const auto& [strokeId, stroke] : strokes_) {
+    journal_.cancelStroke(stroke->serial_);
+    stroke->isActive_ = false;
+  }
+  strokes_.clear();
+}
+
+void CanvasSession::rasterizeConcurrently(RenderCommand* const* commands, size_t count,
+                                          WorkerPool& rasterWorkers, uint64_t rasterDeadline) {
+  const uint64_t startTime = PerfStats::now();
+  
+  // Segment parameters (including texture randomness) are fixed up front in
+  // submission order
+  std::vector<StrokeSegment> segments;
+  std::vector<PixelRect> bounds;
+  std::vector<size_t> journalRecords;
+  segments.reserve(count);
+  bounds.reserve(count);
+  journalRecords.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    StrokeSegment segment;
+    size_t journalRecord;
+    if (!addStrokePoint(*commands[i], segment, journalRecord)) {
+      continue;
+    }
+    segments.push_back(segment);
+    bounds.push_back(canvas_.strokeLineBounds(segment));
+    journalRecords.push_back(journalRecord);
+  }
+  if (segments.empty()) {
+    return;
+  }
+  
+  // (tile, segment) pairs sorted by tile; within a tile segments keep
+  // submission order, which is also the order overlaps composite in. The
+  // result matches applying the segments one after another.
+  const int tilesX = (canvas_.width() + kTileSize - 1) / kTileSize;
+  std::vector<std::pair<int, int>> tileSegments;
+  for (int s = 0; s < static_cast<int>(segments.size()); ++s) {
+    const PixelRect& rect = bounds[s];
+    for (int ty = rect.y0 >> kTileShift; rect.y1 > rect.y0 && ty <= (rect.y1 - 1) >> kTileShift; ++ty) {
+      for (int tx = rect.x0 >> kTileShift; rect.x1 > rect.x0 && tx <= (rect.x1 - 1) >> kTileShift; ++tx) {
+        tileSegments.emplace_back(ty * tilesX + tx, s);
+      }
+    }
+  }
+  std::sort(tileSegments.begin(), tileSegments.end());
+  
+  std::vector<size_t> tileStarts;
+  for (size_t i = 0; i < tileSegments.size(); ++i) {
+    if (i == 0 || tileSegments[i].first != tileSegments[i - 1].first) {
+      tileStarts.push_back(i);
+    }
+  }
+  tileStarts.push_back(tileSegments.size());
+  const int tileGroups = static_cast<int>(tileStarts.size()) - 1;
+  
+  // Predict the pass from recent per-segment cost spread over the workers
+  // it can keep busy, and shed texture noise if it would overrun the frame
+  const double predictedNanos = perfStats_->recentMeanMs(PerfOperation::StrokeRaster) * 1e6 *
+                                segments.size() / std::max(std::min(tileGroups, rasterWorkers.parallelism()), 1);
+  if (rasterDeadline != UINT64_MAX && startTime + predictedNanos > rasterDeadline) {
+    for (auto& segment : segments) {
+      segment.textureNoise = false;
+    }
+    perfStats_->recordShed(segments.size());
+  }
+  for (size_t i = 0; i < segments.size(); ++i) {
+    if (!segments[i].textureNoise) {
+      journal_.markTextureShed(journalRecords[i]);
+    }
+  }
+  
+  // Each segment is charged the time its own clips took, whichever
+  // workers ran them
+  std::vector<std::atomic<uint64_t>> segmentNanos(segments.size());
+  std::vector<std::atomic<uint64_t>> segmentPixels(segments.size());
+  rasterWorkers.parallelFor(tileGroups, [&](int group) {
+    const int tile = tileSegments[tileStarts[group]].first;
+    const int tileX0 = (tile % tilesX) << kTileShift;
+    const int tileY0 = (tile / tilesX) << kTileShift;
+    for (size_t i = tileStarts[group]; i < tileStarts[group + 1]; ++i) {
+      const int s = tileSegments[i].second;
+      const PixelRect& rect = bounds[s];
+      PixelRect clip{
+        std::max(rect.x0, tileX0),
+        std::max(rect.y0, tileY0),
+        std::min(rect.x1, tileX0 + kTileSize),
+        std::min(rect.y1, tileY0 + kTileSize),
+      };
+      const uint64_t clipStart = PerfStats::now();
+      const uint64_t written = canvas_.rasterizeStrokeLine(segments[s], clip);
+      segmentNanos[s].fetch_add(PerfStats::now() - clipStart, std::memory_order_relaxed);
+      segmentPixels[s].fetch_add(written, std::memory_order_relaxed);
+    }
+  });
+  
+  for (size_t i = 0; i < segments.size(); ++i) {
+    perfStats_->record(PerfOperation::StrokeRaster, segmentNanos[i].load(), segmentPixels[i].load());
+  }
+}
+
+void CanvasSession::applyCommand(RenderCommand& command, uint64_t rasterDeadline) {
+  switch (command.type) {
+    case RenderCommandType::BeginStroke: {
+      // The stroke is built by the producer so handles can point at it directly
+      auto& stroke = command.stroke;
+      if (strokes_.empty()) {
+        // Strokes that overlap in time (multi-touch) undo together
+        canvas_.beginHistoryStep(journalMark());
+      }
+      command.point = CanvasJournal::quantize(command.point);
+      if (rerasterizing_) {
+        // The serial seeds the stroke's randomness, and a redraw skips strokes
+        nextStrokeSerial_ = static_cast<uint32_t>(command.strokeId);
+      }
+      stroke->serial_ = nextStrokeSerial_++;
+      journal_.beginStroke(stroke->serial_, *stroke->preset_, command.point);
+      stroke->addPoint(command.point);
+      strokes_[command.strokeId] = stroke;
+      break;
+    }
+    
+    case RenderCommandType::AddPoint: {
+      PerfStats::Scope timing(*perfStats_, PerfOperation::StrokeRaster);
+      StrokeSegment segment;
+      size_t journalRecord;
+      if (!addStrokePoint(command, segment, journalRecord)) {
+        break;
+      }
+      if (segment.textureNoise && PerfStats::now() > rasterDeadline) {
+        segment.textureNoise = false;
+        perfStats_->recordShed(1);
+      }
+      if (!segment.textureNoise) {
+        journal_.markTextureShed(journalRecord);
+      }
+      timing.setPixels(canvas_.rasterizeStrokeLine(segment, PixelRect{0, 0, canvas_.width(), canvas_.height()}));
+      break;
+    }
+    
+    case RenderCommandType::EndStroke: {
+      Stroke* stroke = findStroke(command);
+      if (stroke && stroke->isActive_) {
+        command.point = CanvasJournal::quantize(command.point);
+        journal_.endStroke(stroke->serial_, stroke->points_.back(), command.point);
+        stroke->end(command.point);
+        strokes_.erase(command.strokeId);
+        if (strokes_.empty()) {
+          canvas_.commitHistoryStep(journalMark());
+        }
+      }
+      break;
+    }
+    
+    case RenderCommandType::CancelStroke: {
+      Stroke* stroke = findStroke(command);
+      // A resize may already have cancelled it
+      if (stroke && stroke->isActive_) {
+        journal_.cancelStroke(stroke->serial_);
+        stroke->isActive_ = false;
+        strokes_.erase(command.strokeId);
+        if (strokes_.empty()) {
+          canvas_.commitHistoryStep(journalMark());
+        }
+      }
+      break;
+    }
+    
+    case RenderCommandType::ApplyMotion: {
+      double* accel = command.acceleration;
+      for (int i = 0; i < 3; ++i) {
+        accel[i] = CanvasJournal::quantizeAcceleration(accel[i]);
+      }
+      PerfStats::Scope timing(*perfStats_, PerfOperation::PhysicsStep);
+      // Flow while a stroke is down belongs to the stroke's step
+      const bool ownStep = !canvas_.isRecordingHistory();
+      if (ownStep) {
+        canvas_.beginHistoryStep(journalMark(), UndoHistory::StepKind::Physics);
+      }
+      journal_.motion(accel);
+      timing.setPixels(canvas_.applyPhysics(accel[0], accel[1], accel[2]));
+      if (ownStep) {
+        canvas_.commitHistoryStep(journalMark(), UndoHistory::StepKind::Physics);
+      }
+      for (const auto& [strokeId, stroke] : strokes_) {
+        stroke->brushEngine_.simulatePhysics(accel[0], accel[1], accel[2]);
+      }
+      break;
+    }
+    
+    case RenderCommandType::Clear:
+      canvas_.beginHistoryStep(journalMark());
+      journal_.clear();
+      canvas_.clear();
+      if (strokes_.empty()) {
+        canvas_.commitHistoryStep(journalMark());
+      }
+      break;
+    
+    case RenderCommandType::Undo: {
+      UndoHistory::Marks applied;
+      canvas_.undo(journalMark(), applied);
+      journal_.undo(applied);
+      reopenHistoryStep();
+      break;
+    }
+    
+    case RenderCommandType::Redo: {
+      UndoHistory::Marks applied;
+      canvas_.redo(journalMark(), applied);
+      journal_.redo(applied);
+      reopenHistoryStep();
+      break;
+    }
+    
+    case RenderCommandType::DocumentOpened:
+      // Only reaches a session through replay: puts it where a freshly
+      // opened copy of the document would be
+      journal_.documentOpened();
+      strokes_.clear();
+      canvas_.resetHistory();
+      canvas_.flattenLayers();
+      break;
+    
+    // Layer changes are only journaled when they apply, so replay never
+    // meets one that doesn't
+    case RenderCommandType::AddLayer:
+      if (canvas_.addLayer() >= 0) {
+        journal_.addLayer();
+      }
+      break;
+    
+    case RenderCommandType::SetLayerProperties:
+      if (canvas_.setLayerProperties(command.layer, command.layerProperties)) {
+        journal_.layerProperties(command.layer, command.layerProperties);
+      }
+      break;
+    
+    case RenderCommandType::SetActiveLayer:
+      if (canvas_.setActiveLayer(command.layer)) {
+        journal_.activeLayer(command.layer);
+      }
+      break;
+    
+    case RenderCommandType::SetWetLayer:
+      if (canvas_.setWetLayer(command.layer)) {
+        journal_.wetLayer(command.layer);
+      }
+      break;
+    
+    case RenderCommandType::WetStep: {
+      // Only journaled when something was wet, like layer changes
+      if (!canvas_.hasWetPaint()) {
+        break;
+      }
+      PerfStats::Scope timing(*perfStats_, PerfOperation::WetStep);
+      // Drying while a stroke is down belongs to the stroke's step, and
+      // otherwise merges with physics
+      const bool ownStep = !canvas_.isRecordingHistory();
+      if (ownStep) {
+        canvas_.beginHistoryStep(journalMark(), UndoHistory::StepKind::Physics);
+      }
+      journal_.wetStep();
+      timing.setPixels(canvas_.stepWetPaint());
+      if (ownStep) {
+        canvas_.commitHistoryStep(journalMark(), UndoHistory::StepKind::Physics);
+      }
+      break;
+    }
+    
+    case RenderCommandType::SetHistoryBudget:
+      journal_.historyBudget(command.historyBudget);
+      canvas_.setHistoryBudget(command.historyBudget);
+      break;
+    
+    case RenderCommandType::Capture:
+      command.onCapture(canvas_.captureSnapshot());
+      break;
+    
+    case RenderCommandType::CaptureJournal:
+      // A journal that doesn't start from a blank canvas can't be replayed
+      command.onJournal(journalComplete_ ? journal_.bytes() : std::vector<uint8_t>());
+      break;
+    
+    case RenderCommandType::CaptureDocument:
+      command.onDocument(DocumentCapture{
+        canvas_.captureSnapshot(),
+        canvas_.backgroundColor(),
+        canvas_.fluidLayer(),
+        journalComplete_ ? journal_.bytes() : std::vector<uint8_t>(),
+        nextStrokeSerial_,
+      });
+      break;
+    
+    default:
+      break;
+  }
+}
+
+bool CanvasSession::addStrokePoint(RenderCommand& command, StrokeSegment& segment, size_t& journalRecord) {
+  Stroke* stroke = findStroke(command);
+  if (!stroke || !stroke->isActive_ || stroke->points_.empty()) {
+    return false;
+  }
+  recordIngest(command);
+  command.point = CanvasJournal::quantize(command.point);
+  const PointData& point = command.point;
+  const PointData prev = stroke->points_.back();
+  journalRecord = journal_.addPoint(stroke->serial_, prev, point);
+  stroke->addPoint(point);
+  
+  // Exactly 1 unless a redraw is replaying points captured at another scale
+  const double scale = rasterScale_ / inputScale_;
+  segment = canvas_.prepareStrokeLine(
+    prev.x * scale, prev.y * scale,
+    point.x * scale, point.y * scale,
+    point.pressure,
+    stroke->brushEngine_.size_ * scale,
+    stroke->brushEngine_.color_,
+    stroke->brushEngine_.opacity_,
+    stroke->brushEngine_.texture_,
+    stroke->preset_->falloff(),
+    stroke->segmentRandom(stroke->points_.size() - 1)
+  );
+  segment.tip = stroke->preset_->tip();
+  segment.grain = stroke->preset_->grain();
+  segment.textureNoise = !command.textureShed;
+  return true;
+}
+
+void CanvasSession::reopenHistoryStep() {
+  // Strokes still down carry on into a fresh step
+  if (!strokes_.empty()) {
+    canvas_.beginHistoryStep(journalMark());
+  }
+}
+
+Stroke* CanvasSession::findStroke(const RenderCommand& command) {
+  if (command.stroke) {
+    return command.stroke.get();
+  }
+  auto it = strokes_.find(command.strokeId);
+  return it != strokes_.end() ? it->second.get() : nullptr;
+}
+
+void CanvasSession::recordIngest(const RenderCommand& command) {
+  if (command.submittedAt != 0) {
+    perfStats_->record(PerfOperation::PointIngest, PerfStats::now() - command.submittedAt);
+  }
+}
+
+std::string CanvasSession::snapshotAsBase64() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  PerfStats::Scope timing(*perfStats_, PerfOperation::SnapshotEncode);
+  timing.setPixels(static_cast<uint64_t>(canvas_.width()) * canvas_.height());
+  return canvas_.getSnapshotAsBase64();
+}
+
+TileGrid CanvasSession::captureSnapshot() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return canvas_.captureSnapshot();
+}
+
+std::string CanvasSession::thumbnailAsBase64(int maxWidth) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  PerfStats::Scope timing(*perfStats_, PerfOperation::SnapshotEncode);
+  return canvas_.getThumbnailAsBase64(maxWidth);
+}
+
+} // namespace facebook::react
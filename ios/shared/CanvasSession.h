@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Canvas.h"
+#include "CanvasJournal.h"
+#include "CommandQueue.h"
+#include "PerfStats.h"
+#include "Stroke.h"
+#include "WorkerPool.h"
+
+namespace facebook::react {
+
+// Everything that belongs to one canvas: its pixels, the strokes in flight on
+// it and their brush state. Sessions share nothing but the (lock-free)
+// perf stats, so separate canvases can be rasterized on separate threads.
+class CanvasSession : public std::enable_shared_from_this<CanvasSession> {
+public:
+  // Registers the canvas frame sink under canvasId for the lifetime of the session
+  CanvasSession(int canvasId, int width, int height, uint32_t backgroundColor,
+                std::shared_ptr<PerfStats> perfStats);
+  // Opens a saved document, continuing its journal if it has one
+  CanvasSession(int canvasId, const std::shared_ptr<CanvasDocument>& document,
+                std::shared_ptr<PerfStats> perfStats);
+  ~CanvasSession();
+
+  int id() const { return canvasId_; }
+  uint32_t backgroundColor() const { return canvas_.backgroundColor(); }
+  // Changes once pixels a batch wrote reach the composite; safe to poll from any thread
+  uint64_t pixelGeneration() const { return canvas_.generation(); }
+  // Still has wet watercolor for WetStep commands to dry; safe to poll from any thread
+  bool hasWetPaint() const { return canvas_.hasWetPaint(); }
+  // A resize's redraw has yet to land; safe to poll from any thread
+  bool isRedrawing() const { return redrawId_.load(std::memory_order_acquire) != 0; }
+  std::shared_ptr<FrameSink> frameSink() const { return canvas_.frameSink(); }
+
+  // Applies a run of commands in order and publishes one frame if anything
+  // was drawn. Runs on the render thread or one of its workers; runs of
+  // points are rasterized together, tile-parallel, on rasterWorkers. Work
+  // that would finish after rasterDeadline (PerfStats::now() ns) drops its
+  // optional texture noise.
+  void apply(const std::vector<RenderCommand*>& commands, WorkerPool& rasterWorkers, uint64_t rasterDeadline);
+  // Publishes the current image without drawing, for a consumer that
+  // attached while the canvas was idle. Render thread only, like apply.
+  void publishFrame();
+
+  std::string snapshotAsBase64();
+  TileGrid captureSnapshot();
+  std::string thumbnailAsBase64(int maxWidth);
+
+private:
+  // A canvas to redraw into off the render thread; not registered with
+  // platform views
+  CanvasSession(int width, int height, uint32_t backgroundColor, std::shared_ptr<PerfStats> perfStats);
+
+  // apply without the lock or the frame; true if anything was drawn
+  bool applyCommands(const std::vector<RenderCommand*>& commands, WorkerPool& rasterWorkers,
+                     uint64_t rasterDeadline);
+  void applyCommand(RenderCommand& command, uint64_t rasterDeadline);
+  // Resamples the pixels to the new size at once and has a raster worker
+  // redraw the journal's model (see JournalModelReader) at the new size and
+  // scale behind it. Strokes still down are cancelled first.
+  void resize(const RenderCommand& command, WorkerPool& rasterWorkers);
+  // On a raster worker, in a scratch session: draws the model of journal,
+  // then everything live journals after it until live is nearly caught up,
+  // and hands the canvas over under live's lock. Gives up once live is gone
+  // or has moved on to another redraw.
+  void redraw(const std::weak_ptr<CanvasSession>& live, uint64_t redrawId, const CanvasJournal& journal,
+              uint32_t nextStrokeSerial, WorkerPool& rasterWorkers);
+  // Applies what reader decodes, in chunks small enough to keep decoded,
+  // as long as wanted() holds; false if it stopped holding
+  template <typename Reader>
+  bool replay(Reader& reader, WorkerPool& rasterWorkers, const std::function<bool()>& wanted);
+  void resample(const RenderCommand& command, WorkerPool& rasterWorkers);
+  // Fills undo like a clear: alone, or with the strokes still down
+  void fill(RenderCommand& command, WorkerPool& rasterWorkers);
+  void cancelStrokes();
+  Stroke* findStroke(const RenderCommand& command);
+  // Quantizes, journals and appends the command's point to its stroke and
+  // prepares the segment to draw. False when the point has no live stroke.
+  bool addStrokePoint(RenderCommand& command, StrokeSegment& segment, size_t& journalRecord);
+  void reopenHistoryStep();
+  // Where the next journal record goes; history steps are marked with it
+  uint64_t journalMark() const { return journal_.bytes().size(); }
+  void rasterizeConcurrently(RenderCommand* const* commands, size_t count,
+                             WorkerPool& rasterWorkers, uint64_t rasterDeadline);
+  void recordIngest(const RenderCommand& command);
+
+  const int canvasId_;
+  const bool registered_ = true; // Its frame sink is in FrameSinkRegistry
+  std::mutex mutex_;
+  Canvas canvas_;
+  CanvasJournal journal_;
+  uint32_t nextStrokeSerial_ = 0;
+  bool journalComplete_ = true; // False when opened from a document without a usable one
+  // Points arrive in pixels at inputScale_ and are drawn at rasterScale_.
+  // The two only differ while a redraw replays the journal.
+  double inputScale_ = 1.0;
+  double rasterScale_ = 1.0;
+  bool rerasterizing_ = false;
+  // The redraw whose canvas is still to come; 0 for none
+  std::atomic<uint64_t> redrawId_{0};
+  uint64_t redrawCount_ = 0;
+  std::unordered_map<int, std::shared_ptr<Stroke>> strokes_;
+  std::shared_ptr<PerfStats> perfStats_;
+};
+
+} // namespace facebook::react
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace facebook::react {
+
+// Writes all of data to fd, retrying short writes. False with errno set on failure.
+bool writeAll(int fd, const uint8_t* data, size_t size);
+
+// Flushes fd to stable storage (F_FULLFSYNC where the platform has it, since
+// fsync there stops at the drive cache). False with errno set on failure.
+bool syncToDisk(int fd);
+
+// Writes data to a temporary file next to path and renames it into place, so
+// readers never see a partial file. The file is synced before the rename and
+// the directory after it, so after a crash path holds either the old
+// contents or all of the new. Returns false and fills error on failure.
+bool writeFileAtomically(const std::string& path, const uint8_t* data, size_t size, std::string& error);
+
+bool readWholeFile(const std::string& path, std::vector<uint8_t>& data, std::string& error);
+
+// Read-only memory map of a whole file. Pages are read in by the OS as they
+// are touched, so opening costs the same whatever the file size.
+class MappedFile {
+public:
+  static std::shared_ptr<MappedFile> open(const std::string& path, std::string& error);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+private:
+  MappedFile(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  const uint8_t* data_;
+  size_t size_;
+};
+
+} // namespace facebook::react
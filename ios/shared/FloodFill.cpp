@@ -0,0 +1,159 @@
+#include "FloodFill.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include "PixelKernels.h"
+#include "WorkerPool.h"
+
+namespace facebook::react {
+
+namespace {
+
+constexpr uint64_t kAllBits = ~uint64_t{0};
+
+// Bits [from, to) of a word, for 0 <= from < to <= 64
+uint64_t bitRange(int from, int to) {
+  const uint64_t below = to == 64 ? kAllBits : (uint64_t{1} << to) - 1;
+  return below & (kAllBits << from);
+}
+
+} // namespace
+
+uint64_t FloodFill::fill(TileGrid& pixels, int top, int width, int height, int x, int y,
+                         uint32_t color, uint8_t tolerance, WorkerPool& workers) {
+  if (x < 0 || y < 0 || x >= width || y >= height) {
+    return 0;
+  }
+  const uint32_t seed = pixels.pixel(x, top + y);
+  if (tolerance == 0 && seed == color) {
+    return 0;
+  }
+  width_ = width;
+  stride_ = (width + kTileSize - 1) / kTileSize;
+  const int tilesY = (height + kTileSize - 1) / kTileSize;
+  const int tileCount = stride_ * tilesY;
+  matches_.resize(static_cast<size_t>(stride_) * height);
+  filled_.resize(matches_.size());
+
+  // Each tile row is one word, so tiles never share a word. Pixels past
+  // the right edge never match, which ends every run there.
+  workers.parallelFor(tileCount, [&](int tile) {
+    const int x0 = (tile % stride_) * kTileSize;
+    const int y0 = (tile / stride_) * kTileSize;
+    const int columns = std::min(kTileSize, width - x0);
+    const int rows = std::min(kTileSize, height - y0);
+    const uint32_t* source = pixels.tile(pixels.tileIndexAt(x0, top + y0));
+    for (int row = 0; row < rows; ++row) {
+      const size_t index = static_cast<size_t>(y0 + row) * stride_ + (tile % stride_);
+      matches_[index] = matchColor(source + row * kTileSize, columns, seed, tolerance);
+      filled_[index] = 0;
+    }
+  });
+
+  // Each seed grows into its whole run, which is marked filled before the
+  // runs touching it above and below are queued
+  seeds_.clear();
+  seeds_.emplace_back(x, y);
+  while (!seeds_.empty()) {
+    const auto [seedX, seedY] = seeds_.back();
+    seeds_.pop_back();
+    if (!((open(seedY, seedX >> kTileShift) >> (seedX & (kTileSize - 1))) & 1)) {
+      continue;
+    }
+    const int start = runStart(seedY, seedX);
+    const int end = runEnd(seedY, seedX);
+    uint64_t* row = filled_.data() + static_cast<size_t>(seedY) * stride_;
+    for (int word = start >> kTileShift; word <= (end - 1) >> kTileShift; ++word) {
+      row[word] |= bitRange(std::max(start - word * kTileSize, 0), std::min(end - word * kTileSize, kTileSize));
+    }
+    if (seedY > 0) {
+      queueRuns(seedY - 1, start, end);
+    }
+    if (seedY + 1 < height) {
+      queueRuns(seedY + 1, start, end);
+    }
+  }
+
+  auto solidTile = std::make_shared<PixelTile>();
+  solidTile->pixels.fill(color);
+  std::atomic<uint64_t> filledPixels{0};
+  workers.parallelFor(tileCount, [&](int tile) {
+    const int x0 = (tile % stride_) * kTileSize;
+    const int y0 = (tile / stride_) * kTileSize;
+    const int rows = std::min(kTileSize, height - y0);
+    const uint64_t* bits = filled_.data() + static_cast<size_t>(y0) * stride_ + (tile % stride_);
+    int count = 0;
+    bool whole = rows == kTileSize;
+    for (int row = 0; row < rows; ++row) {
+      count += std::popcount(bits[row * stride_]);
+      whole = whole && bits[row * stride_] == kAllBits;
+    }
+    if (count == 0) {
+      return;
+    }
+    filledPixels.fetch_add(count, std::memory_order_relaxed);
+
+    const int index = pixels.tileIndexAt(x0, top + y0);
+    if (whole) {
+      pixels.exchangeTile(index, solidTile);
+      return;
+    }
+    uint32_t* out = pixels.mutableTile(index);
+    for (int row = 0; row < rows; ++row) {
+      uint64_t word = bits[row * stride_];
+      while (word) {
+        const int start = std::countr_zero(word);
+        const int length = std::countr_one(word >> start);
+        std::fill_n(out + row * kTileSize + start, length, color);
+        word &= ~bitRange(start, start + length);
+      }
+    }
+  });
+  return filledPixels.load();
+}
+
+int FloodFill::runStart(int y, int x) const {
+  int word = x >> kTileShift;
+  const int bit = x & (kTileSize - 1);
+  uint64_t closed = bit > 0 ? ~open(y, word) & bitRange(0, bit) : 0;
+  while (!closed) {
+    if (word == 0) {
+      return 0;
+    }
+    closed = ~open(y, --word);
+  }
+  return word * kTileSize + (kTileSize - std::countl_zero(closed));
+}
+
+int FloodFill::runEnd(int y, int x) const {
+  int word = x >> kTileShift;
+  uint64_t closed = ~open(y, word) & (kAllBits << (x & (kTileSize - 1)));
+  while (!closed) {
+    if (++word == stride_) {
+      return width_;
+    }
+    closed = ~open(y, word);
+  }
+  return std::min(word * kTileSize + std::countr_zero(closed), width_);
+}
+
+void FloodFill::queueRuns(int y, int x0, int x1) {
+  for (int x = x0; x < x1;) {
+    int word = x >> kTileShift;
+    uint64_t bits = open(y, word) & (kAllBits << (x & (kTileSize - 1)));
+    while (!bits) {
+      if (++word * kTileSize >= x1) {
+        return;
+      }
+      bits = open(y, word);
+    }
+    const int start = word * kTileSize + std::countr_zero(bits);
+    if (start >= x1) {
+      return;
+    }
+    seeds_.emplace_back(start, y);
+    x = runEnd(y, start);
+  }
+}
+
+} // namespace facebook::react
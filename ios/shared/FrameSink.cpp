@@ -0,0 +1,118 @@
+#include "FrameSink.h"
+#include <algorithm>
+#include <cstring>
+
+namespace facebook::react {
+
+FrameSink::FrameSink() {}
+
+void FrameSink::publish(const TileGrid& pixels) {
+  Frame& frame = frames_[backIndex_];
+  
+  if (frame.width != pixels.width() || frame.height != pixels.height()) {
+    frame.width = pixels.width();
+    frame.height = pixels.height();
+    frame.pixels.assign(static_cast<size_t>(frame.width) * frame.height, 0);
+    frame.generation = 0;
+  }
+  
+  for (int index : pixels.tilesChangedSince(frame.generation)) {
+    int x0 = (index % pixels.tilesX()) * kTileSize;
+    int y0 = (index / pixels.tilesX()) * kTileSize;
+    int count = std::min(kTileSize, frame.width - x0);
+    int y1 = std::min(y0 + kTileSize, frame.height);
+    for (int y = y0; y < y1; ++y) {
+      std::memcpy(frame.pixels.data() + static_cast<size_t>(y) * frame.width + x0,
+                  pixels.span(x0, y), count * sizeof(uint32_t));
+    }
+  }
+  
+  frame.generation = pixels.generation();
+  frame.sequence = nextSequence_++;
+  frame.publishedAt = std::chrono::steady_clock::now();
+  
+  // Release the filled buffer and take back whatever sat in the middle slot
+  uint8_t previous = middle_.exchange(backIndex_ | kFreshBit, std::memory_order_acq_rel);
+  backIndex_ = previous & kIndexMask;
+}
+
+bool FrameSink::takeFresh() {
+  if (!(middle_.load(std::memory_order_acquire) & kFreshBit)) {
+    return false;
+  }
+  if (held_[frontIndex_].load(std::memory_order_acquire)) {
+    // Both still on screen; try again once one is let go
+    if (held_[spareIndex_].load(std::memory_order_acquire)) {
+      return false;
+    }
+    std::swap(frontIndex_, spareIndex_);
+  }
+  uint8_t previous = middle_.exchange(frontIndex_, std::memory_order_acq_rel);
+  frontIndex_ = previous & kIndexMask;
+  hasFront_ = true;
+  return true;
+}
+
+const Frame* FrameSink::acquireLatest() {
+  takeFresh();
+  return hasFront_ ? &frames_[frontIndex_] : nullptr;
+}
+
+std::shared_ptr<const Frame> FrameSink::acquireHeld() {
+  if (!takeFresh()) {
+    return nullptr;
+  }
+  const uint8_t index = frontIndex_;
+  held_[index].store(true, std::memory_order_relaxed);
+  // The release keeps the sink alive, so it may outlive the canvas
+  return std::shared_ptr<const Frame>(&frames_[index], [sink = shared_from_this(), index](const Frame*) {
+    sink->held_[index].store(false, std::memory_order_release);
+  });
+}
+
+bool FrameSink::hasNewFrame() const {
+  return middle_.load(std::memory_order_acquire) & kFreshBit;
+}
+
+bool FrameSink::attachConsumer() {
+  bool attached = false;
+  if (!consumerAttached_.compare_exchange_strong(attached, true, std::memory_order_acq_rel)) {
+    return false;
+  }
+  // Nothing was published while detached
+  std::function<void()> handler;
+  {
+    std::lock_guard<std::mutex> lock(requestMutex_);
+    handler = frameRequestHandler_;
+  }
+  if (handler) {
+    handler();
+  }
+  return true;
+}
+
+void FrameSink::setFrameRequestHandler(std::function<void()> handler) {
+  std::lock_guard<std::mutex> lock(requestMutex_);
+  frameRequestHandler_ = std::move(handler);
+}
+
+std::mutex FrameSinkRegistry::mutex_;
+std::unordered_map<int, std::shared_ptr<FrameSink>> FrameSinkRegistry::sinks_;
+
+void FrameSinkRegistry::add(int canvasId, std::shared_ptr<FrameSink> sink) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  sinks_[canvasId] = std::move(sink);
+}
+
+void FrameSinkRegistry::remove(int canvasId) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  sinks_.erase(canvasId);
+}
+
+std::shared_ptr<FrameSink> FrameSinkRegistry::find(int canvasId) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = sinks_.find(canvasId);
+  return it != sinks_.end() ? it->second : nullptr;
+}
+
+} // namespace facebook::react
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <jsi/jsi.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CanvasSession.h"
+#include "RenderThread.h"
+
+namespace facebook::react {
+
+class NativeGestureCanvas;
+
+// Host object that lets gesture worklets feed a canvas from the UI runtime
+// without hopping to the JS thread. Reanimated shares host objects by
+// reference, so a worklet that captures it calls straight into native code.
+//
+// begin/addPoint/end(x, y, pressure, timestamp, pointerId = 0) take plain
+// numbers so the UI-thread path reads no object properties. Each pointer id
+// carries its own stroke, so several fingers can draw at once. They write to a render lane of
+// their own and must all be called from one thread; the first caller claims
+// it. setBrushStyle(style or registered handle) applies to the next stroke.
+// A plain style object is read on the JS thread only; from any other thread
+// it throws, and a handle from registerBrushStyle has to be passed instead.
+//
+// The input only holds the canvas weakly: once the canvas is destroyed or
+// its handle disposed, points are dropped. dispose() cancels strokes in
+// progress and gives up the lane; called from another thread than the one
+// feeding it, that happens on the feeding thread's next call.
+class GestureInput : public jsi::HostObject, public std::enable_shared_from_this<GestureInput> {
+public:
+  GestureInput(
+    std::weak_ptr<NativeGestureCanvas> module,
+    std::weak_ptr<CanvasSession> session,
+    std::shared_ptr<RenderThread::Lane> lane,
+    std::shared_ptr<const BrushPreset> brushPreset
+  );
+
+  jsi::Value get(jsi::Runtime& rt, const jsi::PropNameID& name) override;
+  std::vector<jsi::PropNameID> getPropertyNames(jsi::Runtime& rt) override;
+
+private:
+  // The cached methods of rt, made on its first lookup
+  const std::vector<std::pair<jsi::PropNameID, jsi::Function>>& methods(jsi::Runtime& rt);
+  jsi::Function createMethod(jsi::Runtime& rt, const jsi::PropNameID& name);
+  void claimProducer(jsi::Runtime& rt);
+  void dispose();
+  // Producer thread only
+  void release();
+  void submitPoint(jsi::Runtime& rt, RenderCommandType type, const jsi::Value* args, size_t count);
+
+  std::weak_ptr<NativeGestureCanvas> module_;
+  // Made by createGestureInput, so on the JS thread
+  const std::thread::id jsThread_;
+  // Producer thread only; both are dropped by release()
+  std::weak_ptr<CanvasSession> session_;
+  std::shared_ptr<RenderThread::Lane> lane_;
+  std::atomic<std::thread::id> producer_{};
+  std::atomic<bool> disposed_{false};
+
+  std::mutex brushMutex_;
+  std::shared_ptr<const BrushPreset> brushPreset_; // Guarded by brushMutex_
+
+  struct PointerStroke {
+    double pointerId;
+    int strokeId;
+    std::shared_ptr<Stroke> stroke;
+  };
+  std::vector<PointerStroke> pointers_; // Producer thread only
+  
+  // Methods are made once per runtime, since a worklet looks addPoint up on
+  // every event; they hold the input weakly. Each runtime's entry is only
+  // used on that runtime's thread, so the lock just covers finding it.
+  struct RuntimeMethods {
+    jsi::Runtime* runtime;
+    std::vector<std::pair<jsi::PropNameID, jsi::Function>> methods;
+  };
+  std::mutex methodsMutex_;
+  std::vector<std::unique_ptr<RuntimeMethods>> runtimeMethods_; // Guarded by methodsMutex_
+};
+
+} // namespace facebook::react
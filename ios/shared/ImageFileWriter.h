@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include "TileGrid.h"
+
+namespace facebook::react {
+
+enum class ImageFileFormat {
+  Bmp,  // 24-bit top-down BMP
+  Raw,  // headerless 32-bit pixels as stored (B, G, R, A bytes)
+};
+
+bool parseImageFileFormat(const std::string& name, ImageFileFormat& format);
+
+// Streams the pixels to disk one band of tile rows at a time, so peak memory
+// is a single band no matter how large the canvas is. Writes to a temporary
+// file and renames it over path on success. Returns false and fills error
+// on failure.
+bool writeImageFile(const TileGrid& pixels, const std::string& path,
+                    ImageFileFormat format, std::string& error);
+
+} // namespace facebook::react
@@ -0,0 +1,87 @@
+#include "MipPyramid.h"
+#include <algorithm>
+#include "PixelKernels.h"
+
+namespace facebook::react {
+
+// Levels stop once the image would be smaller than this on either side
+static constexpr int kMinLevelSize = 8;
+
+MipPyramid::MipPyramid(int width, int height, uint32_t fillColor)
+    : width_(width), height_(height) {
+  int levelWidth = width;
+  int levelHeight = height;
+  while (levelWidth / 2 >= kMinLevelSize && levelHeight / 2 >= kMinLevelSize) {
+    levelWidth = (levelWidth + 1) / 2;
+    levelHeight = (levelHeight + 1) / 2;
+    levels_.push_back({levelWidth, levelHeight, {}});
+  }
+  fill(fillColor);
+}
+
+void MipPyramid::fill(uint32_t color) {
+  for (auto& level : levels_) {
+    level.pixels.assign(static_cast<size_t>(level.width) * level.height, color);
+  }
+}
+
+int MipPyramid::levelWidth(int level) const {
+  return level == 0 ? width_ : levels_[level - 1].width;
+}
+
+int MipPyramid::levelHeight(int level) const {
+  return level == 0 ? height_ : levels_[level - 1].height;
+}
+
+int MipPyramid::levelForWidth(int maxWidth) const {
+  int level = 0;
+  while (level + 1 < levelCount() && levelWidth(level + 1) >= maxWidth) {
+    ++level;
+  }
+  return level;
+}
+
+void MipPyramid::refresh(const TileGrid& base, const std::vector<int>& dirtyTiles) {
+  // Level by level, since above level 6 one output pixel spans several tiles
+  for (int level = 1; level < levelCount(); ++level) {
+    for (int index : dirtyTiles) {
+      int x0 = (index % base.tilesX()) * kTileSize;
+      int y0 = (index / base.tilesX()) * kTileSize;
+      int x1 = std::min(x0 + kTileSize, width_);
+      int y1 = std::min(y0 + kTileSize, height_);
+      refreshRect(level, base, x0 >> level, y0 >> level,
+                  ((x1 - 1) >> level) + 1, ((y1 - 1) >> level) + 1);
+    }
+  }
+}
+
+void MipPyramid::refreshRect(int level, const TileGrid& base, int x0, int y0, int x1, int y1) {
+  Level& dst = levels_[level - 1];
+  x1 = std::min(x1, dst.width);
+  y1 = std::min(y1, dst.height);
+  const int srcWidth = levelWidth(level - 1);
+  const int srcHeight = levelHeight(level - 1);
+  const uint32_t* srcPixels = level == 1 ? nullptr : levels_[level - 2].pixels.data();
+
+  // Odd source sizes clamp the last column/row instead of reading past the edge
+  const int fullCount = std::max(0, std::min(x1, srcWidth / 2) - x0);
+  for (int y = y0; y < y1; ++y) {
+    int sy0 = y * 2;
+    int sy1 = std::min(sy0 + 1, srcHeight - 1);
+    // Level 1 reads straight from the tile; the rect never crosses a tile edge
+    const uint32_t* row0 = srcPixels ? srcPixels + static_cast<size_t>(sy0) * srcWidth + x0 * 2 : base.span(x0 * 2, sy0);
+    const uint32_t* row1 = srcPixels ? srcPixels + static_cast<size_t>(sy1) * srcWidth + x0 * 2 : base.span(x0 * 2, sy1);
+    uint32_t* out = dst.pixels.data() + static_cast<size_t>(y) * dst.width + x0;
+
+    downsample2x2(row0, row1, out, fullCount);
+    if (x0 + fullCount < x1) {
+      // Trailing column of an odd-width source: duplicate the last pixel
+      int last = fullCount * 2;
+      uint32_t edge[2] = {row0[last], row0[last]};
+      uint32_t edgeBelow[2] = {row1[last], row1[last]};
+      downsample2x2(edge, edgeBelow, out + fullCount, 1);
+    }
+  }
+}
+
+} // namespace facebook::react
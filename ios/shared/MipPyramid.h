@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "TileGrid.h"
+
+namespace facebook::react {
+
+// Half-resolution chain of a TileGrid (level 1 = 1/2, level 2 = 1/4, ...).
+// Levels are refreshed per dirty base tile, so keeping the chain current
+// costs proportional to what was drawn rather than to the canvas size.
+class MipPyramid {
+public:
+  MipPyramid(int width, int height, uint32_t fillColor);
+
+  void fill(uint32_t color);
+
+  // Recomputes every level over the footprint of the given base tiles
+  void refresh(const TileGrid& base, const std::vector<int>& dirtyTiles);
+
+  // Level 0 is the base grid itself and is not stored here
+  int levelCount() const { return static_cast<int>(levels_.size()) + 1; }
+  int levelWidth(int level) const;
+  int levelHeight(int level) const;
+  const uint32_t* levelPixels(int level) const { return levels_[level - 1].pixels.data(); }
+
+  // Smallest level that is still at least maxWidth wide (0 if none is)
+  int levelForWidth(int maxWidth) const;
+
+private:
+  struct Level {
+    int width;
+    int height;
+    std::vector<uint32_t> pixels;
+  };
+
+  void refreshRect(int level, const TileGrid& base, int x0, int y0, int x1, int y1);
+
+  int width_;
+  int height_;
+  std::vector<Level> levels_;
+};
+
+} // namespace facebook::react
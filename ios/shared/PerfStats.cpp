@@ -0,0 +1,120 @@
+#include "PerfStats.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+
+namespace facebook::react {
+
+const char* perfOperationName(PerfOperation operation) {
+  switch (operation) {
+    case PerfOperation::PointIngest: return "pointIngest";
+    case PerfOperation::StrokeRaster: return "strokeRaster";
+    case PerfOperation::PhysicsStep: return "physicsStep";
+    case PerfOperation::SnapshotEncode: return "snapshotEncode";
+    case PerfOperation::JsiMarshal: return "jsiMarshal";
+    case PerfOperation::Autosave: return "autosave";
+    case PerfOperation::Rerasterize: return "rerasterize";
+    case PerfOperation::Resample: return "resample";
+    case PerfOperation::WetStep: return "wetStep";
+    case PerfOperation::FloodFill: return "floodFill";
+  }
+  return "unknown";
+}
+
+int LatencyHistogram::bucketFor(uint64_t nanos) {
+  if (nanos < kSubBuckets) {
+    return static_cast<int>(nanos);
+  }
+  const int msb = 63 - std::countl_zero(nanos);
+  const int sub = static_cast<int>(nanos >> (msb - kSubBucketBits)) & (kSubBuckets - 1);
+  return std::min((msb - kSubBucketBits + 1) * kSubBuckets + sub, kBucketCount - 1);
+}
+
+uint64_t LatencyHistogram::bucketMidpoint(int bucket) {
+  if (bucket < kSubBuckets) {
+    return bucket;
+  }
+  const int shift = bucket / kSubBuckets - 1;
+  const uint64_t lower = static_cast<uint64_t>(kSubBuckets + bucket % kSubBuckets) << shift;
+  return lower + ((uint64_t{1} << shift) >> 1);
+}
+
+void LatencyHistogram::record(uint64_t nanos) {
+  buckets_[bucketFor(nanos)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(nanos, std::memory_order_relaxed);
+  
+  uint64_t currentMax = max_.load(std::memory_order_relaxed);
+  while (nanos > currentMax && !max_.compare_exchange_weak(currentMax, nanos, std::memory_order_relaxed)) {
+  }
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+  uint64_t total = 0;
+  std::array<uint32_t, kBucketCount> counts;
+  for (int i = 0; i < kBucketCount; ++i) {
+    counts[i] = buckets_[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (total == 0) {
+    return 0;
+  }
+  
+  // Rank is 1-based: p50 of 2 samples is the first
+  const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * total + 0.5));
+  uint64_t seen = 0;
+  for (int i = 0; i < kBucketCount; ++i) {
+    seen += counts[i];
+    if (seen >= rank) {
+      return std::min(bucketMidpoint(i), max());
+    }
+  }
+  return max();
+}
+
+uint64_t PerfStats::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void PerfStats::record(PerfOperation operation, uint64_t nanos, uint64_t pixels) {
+  auto& op = operations_[static_cast<int>(operation)];
+  op.histogram.record(nanos);
+  op.pixels.fetch_add(pixels, std::memory_order_relaxed);
+  
+  const uint32_t slot = op.recentNext.fetch_add(1, std::memory_order_relaxed) % kRecentSamples;
+  const uint64_t micros = std::min<uint64_t>(nanos / 1000, UINT32_MAX);
+  op.recentMicros[slot].store(static_cast<uint32_t>(micros), std::memory_order_relaxed);
+}
+
+PerfSummary PerfStats::summarize(PerfOperation operation) const {
+  const auto& op = operations_[static_cast<int>(operation)];
+  const auto& histogram = op.histogram;
+  constexpr double kNanosPerMs = 1e6;
+  
+  PerfSummary summary;
+  summary.count = histogram.count();
+  summary.p50Ms = histogram.percentile(0.50) / kNanosPerMs;
+  summary.p95Ms = histogram.percentile(0.95) / kNanosPerMs;
+  summary.p99Ms = histogram.percentile(0.99) / kNanosPerMs;
+  summary.maxMs = histogram.max() / kNanosPerMs;
+  summary.meanMs = summary.count > 0 ? histogram.sum() / kNanosPerMs / summary.count : 0.0;
+  summary.pixels = op.pixels.load(std::memory_order_relaxed);
+  return summary;
+}
+
+double PerfStats::recentMeanMs(PerfOperation operation) const {
+  const auto& op = operations_[static_cast<int>(operation)];
+  const uint32_t recorded = std::min<uint32_t>(op.recentNext.load(std::memory_order_relaxed), kRecentSamples);
+  if (recorded == 0) {
+    return 0.0;
+  }
+  
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < recorded; ++i) {
+    sum += op.recentMicros[i].load(std::memory_order_relaxed);
+  }
+  return sum / 1000.0 / recorded;
+}
+
+} // namespace facebook::react
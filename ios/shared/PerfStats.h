@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace facebook::react {
+
+enum class PerfOperation : uint8_t {
+  PointIngest,    // Queue latency from submit to the render thread picking a point up
+  StrokeRaster,   // One stroke segment
+  PhysicsStep,    // One applyPhysics pass
+  SnapshotEncode, // Snapshot, thumbnail or file export encode
+  JsiMarshal,     // Reading a point or brush style out of a JS object
+  Autosave,       // One autosave checkpoint on the autosave thread
+  Rerasterize,    // Redrawing a canvas's strokes and fills after a resize, off the render thread
+  Resample,       // Cropping or filtering a canvas to a new size
+  WetStep,        // One watercolor spread-and-dry step
+  FloodFill,      // A paint-bucket fill
+};
+
+constexpr int kPerfOperationCount = 10;
+const char* perfOperationName(PerfOperation operation);
+
+// Log-linear latency histogram in nanoseconds: every power of two is split
+// into 8 linear buckets, so any percentile is within 12.5% of the true value.
+// Recording is lock-free and safe from any thread.
+class LatencyHistogram {
+public:
+  static constexpr int kSubBucketBits = 3;
+  static constexpr int kSubBuckets = 1 << kSubBucketBits;
+  static constexpr int kBucketCount = 36 * kSubBuckets; // Up to ~68s
+
+  void record(uint64_t nanos);
+
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+  uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+
+  // Midpoint of the bucket holding the q-th quantile (0..1); 0 when empty
+  uint64_t percentile(double q) const;
+
+private:
+  static int bucketFor(uint64_t nanos);
+  static uint64_t bucketMidpoint(int bucket);
+
+  std::array<std::atomic<uint32_t>, kBucketCount> buckets_{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> max_{0};
+};
+
+struct PerfSummary {
+  uint64_t count;
+  double p50Ms;
+  double p95Ms;
+  double p99Ms;
+  double maxMs;
+  double meanMs;
+  uint64_t pixels;
+};
+
+// Per-operation histograms plus a small ring of the most recent samples.
+// Shared by every canvas session of a module.
+class PerfStats {
+public:
+  static constexpr int kRecentSamples = 64;
+
+  // Monotonic clock in nanoseconds used for all measurements
+  static uint64_t now();
+
+  void record(PerfOperation operation, uint64_t nanos, uint64_t pixels = 0);
+  PerfSummary summarize(PerfOperation operation) const;
+
+  // Mean of the last kRecentSamples samples, in milliseconds
+  double recentMeanMs(PerfOperation operation) const;
+
+  // Stroke segments drawn without optional work to stay within a frame budget
+  void recordShed(uint64_t segments) { shedSegments_.fetch_add(segments, std::memory_order_relaxed); }
+  uint64_t shedSegments() const { return shedSegments_.load(std::memory_order_relaxed); }
+
+  // Times the enclosing block and records it on destruction
+  class Scope {
+  public:
+    Scope(PerfStats& stats, PerfOperation operation)
+        : stats_(stats), operation_(operation), start_(now()) {}
+    ~Scope() { stats_.record(operation_, now() - start_, pixels_); }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    void setPixels(uint64_t pixels) { pixels_ = pixels; }
+
+  private:
+    PerfStats& stats_;
+    PerfOperation operation_;
+    uint64_t start_;
+    uint64_t pixels_ = 0;
+  };
+
+private:
+  struct Operation {
+    LatencyHistogram histogram;
+    std::atomic<uint64_t> pixels{0};
+    std::array<std::atomic<uint32_t>, kRecentSamples> recentMicros{};
+    std::atomic<uint32_t> recentNext{0};
+  };
+
+  std::array<Operation, kPerfOperationCount> operations_;
+  std::atomic<uint64_t> shedSegments_{0};
+};
+
+} // namespace facebook::react
@@ -0,0 +1,374 @@
+#include "PixelKernels.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GESTURE_CANVAS_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GESTURE_CANVAS_SSE2 1
+#endif
+
+namespace facebook::react {
+
+static inline uint32_t average4(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+  uint32_t result = 0;
+  for (int shift = 0; shift < 32; shift += 8) {
+    uint32_t sum = ((a >> shift) & 0xFF) + ((b >> shift) & 0xFF) +
+                   ((c >> shift) & 0xFF) + ((d >> shift) & 0xFF);
+    result |= ((sum + 2) >> 2) << shift;
+  }
+  return result;
+}
+
+void downsample2x2(const uint32_t* row0, const uint32_t* row1, uint32_t* out, int outCount) {
+  int i = 0;
+
+#if defined(GESTURE_CANVAS_NEON)
+  // 16 source pixels per row -> 8 output pixels, channels deinterleaved by vld4
+  for (; i + 8 <= outCount; i += 8) {
+    uint8x16x4_t top = vld4q_u8(reinterpret_cast<const uint8_t*>(row0 + i * 2));
+    uint8x16x4_t bottom = vld4q_u8(reinterpret_cast<const uint8_t*>(row1 + i * 2));
+    uint8x8x4_t result;
+    for (int c = 0; c < 4; ++c) {
+      uint16x8_t sum = vpaddlq_u8(top.val[c]);
+      sum = vpadalq_u8(sum, bottom.val[c]);
+      result.val[c] = vrshrn_n_u16(sum, 2);
+    }
+    vst4_u8(reinterpret_cast<uint8_t*>(out + i), result);
+  }
+#elif defined(GESTURE_CANVAS_SSE2)
+  // 4 source pixels per row -> 2 output pixels, summed in 16-bit lanes
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i two = _mm_set1_epi16(2);
+  for (; i + 2 <= outCount; i += 2) {
+    __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i * 2));
+    __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i * 2));
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+    lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+    hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+    __m128i sum = _mm_unpacklo_epi64(lo, hi);
+    sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(sum, zero));
+  }
+#endif
+
+  for (; i < outCount; ++i) {
+    out[i] = average4(row0[i * 2], row0[i * 2 + 1], row1[i * 2], row1[i * 2 + 1]);
+  }
+}
+
+static inline uint32_t roundChannels(const uint32_t sums[4]) {
+  uint32_t result = 0;
+  for (int c = 0; c < 4; ++c) {
+    result |= ((sums[c] + kFilterOne / 2) >> kFilterShift) << (c * 8);
+  }
+  return result;
+}
+
+static inline void accumulate(uint32_t sums[4], uint32_t pixel, int weight) {
+  for (int c = 0; c < 4; ++c) {
+    sums[c] += ((pixel >> (c * 8)) & 0xFF) * static_cast<uint32_t>(weight);
+  }
+}
+
+#if defined(GESTURE_CANVAS_SSE2)
+// Two taps per madd: pixels a and b interleaved channel by channel against
+// (weightA, weightB) pairs gives four 32-bit channel sums
+static inline __m128i madd2(__m128i a16, __m128i b16, int weightA, int weightB) {
+  const __m128i weights = _mm_set1_epi32(static_cast<uint16_t>(weightA) | (weightB << 16));
+  return _mm_madd_epi16(_mm_unpacklo_epi16(a16, b16), weights);
+}
+
+static inline __m128i roundSums(__m128i sums) {
+  return _mm_srli_epi32(_mm_add_epi32(sums, _mm_set1_epi32(kFilterOne / 2)), kFilterShift);
+}
+#endif
+
+void filterRow(const uint32_t* src, uint32_t* out, int outCount,
+               const int* starts, const int16_t* weights, int taps) {
+  int i = 0;
+
+#if defined(GESTURE_CANVAS_NEON)
+  // 4 outputs per step so their sums build up side by side
+  for (; i + 4 <= outCount; i += 4) {
+    uint32x4_t sums[4] = {vdupq_n_u32(0), vdupq_n_u32(0), vdupq_n_u32(0), vdupq_n_u32(0)};
+    for (int j = 0; j < 4; ++j) {
+      const uint32_t* pixels = src + starts[i + j];
+      const int16_t* w = weights + static_cast<size_t>(i + j) * taps;
+      for (int k = 0; k < taps; ++k) {
+        const uint16x4_t channels = vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(pixels[k]))));
+        sums[j] = vmlal_n_u16(sums[j], channels, static_cast<uint16_t>(w[k]));
+      }
+    }
+    const uint16x8_t low = vcombine_u16(vrshrn_n_u32(sums[0], kFilterShift), vrshrn_n_u32(sums[1], kFilterShift));
+    const uint16x8_t high = vcombine_u16(vrshrn_n_u32(sums[2], kFilterShift), vrshrn_n_u32(sums[3], kFilterShift));
+    vst1q_u32(out + i, vreinterpretq_u32_u8(vcombine_u8(vmovn_u16(low), vmovn_u16(high))));
+  }
+#elif defined(GESTURE_CANVAS_SSE2)
+  // 4 outputs per step so their sums build up side by side. Neighbouring
+  // taps are neighbouring pixels, so each pair is one load, then split.
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 4 <= outCount; i += 4) {
+    __m128i sums[4] = {zero, zero, zero, zero};
+    for (int j = 0; j < 4; ++j) {
+      const uint32_t* pixels = src + starts[i + j];
+      const int16_t* w = weights + static_cast<size_t>(i + j) * taps;
+      if (taps == 2) {
+        // Bilinear: both weights in one load
+        int32_t pairWeights;
+        std::memcpy(&pairWeights, w, sizeof(pairWeights));
+        const __m128i pair = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels)), zero);
+        sums[j] = _mm_madd_epi16(_mm_unpacklo_epi16(pair, _mm_srli_si128(pair, 8)), _mm_set1_epi32(pairWeights));
+        continue;
+      }
+      int k = 0;
+      for (; k + 2 <= taps; k += 2) {
+        const __m128i pair = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels + k)), zero);
+        sums[j] = _mm_add_epi32(sums[j], madd2(pair, _mm_srli_si128(pair, 8), w[k], w[k + 1]));
+      }
+      if (k < taps) {
+        const __m128i single = _mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(pixels[k])), zero);
+        sums[j] = _mm_add_epi32(sums[j], madd2(single, zero, w[k], 0));
+      }
+    }
+    const __m128i low = _mm_packs_epi32(roundSums(sums[0]), roundSums(sums[1]));
+    const __m128i high = _mm_packs_epi32(roundSums(sums[2]), roundSums(sums[3]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(low, high));
+  }
+#endif
+
+  for (; i < outCount; ++i) {
+    const uint32_t* pixels = src + starts[i];
+    const int16_t* w = weights + static_cast<size_t>(i) * taps;
+    uint32_t sums[4] = {0, 0, 0, 0};
+    for (int k = 0; k < taps; ++k) {
+      accumulate(sums, pixels[k], w[k]);
+    }
+    out[i] = roundChannels(sums);
+  }
+}
+
+void filterColumns(const uint32_t* const* rows, const int16_t* weights, int taps,
+                   uint32_t* out, int count) {
+  int x = 0;
+
+#if defined(GESTURE_CANVAS_NEON)
+  // 4 pixels per step, widened to 16 bits and accumulated in 32
+  for (; x + 4 <= count; x += 4) {
+    uint32x4_t sums[4] = {vdupq_n_u32(0), vdupq_n_u32(0), vdupq_n_u32(0), vdupq_n_u32(0)};
+    for (int k = 0; k < taps; ++k) {
+      const uint8x16_t pixels = vreinterpretq_u8_u32(vld1q_u32(rows[k] + x));
+      const uint16x8_t low = vmovl_u8(vget_low_u8(pixels));
+      const uint16x8_t high = vmovl_u8(vget_high_u8(pixels));
+      const uint16_t weight = static_cast<uint16_t>(weights[k]);
+      sums[0] = vmlal_n_u16(sums[0], vget_low_u16(low), weight);
+      sums[1] = vmlal_n_u16(sums[1], vget_high_u16(low), weight);
+      sums[2] = vmlal_n_u16(sums[2], vget_low_u16(high), weight);
+      sums[3] = vmlal_n_u16(sums[3], vget_high_u16(high), weight);
+    }
+    const uint16x8_t low = vcombine_u16(vrshrn_n_u32(sums[0], kFilterShift), vrshrn_n_u32(sums[1], kFilterShift));
+    const uint16x8_t high = vcombine_u16(vrshrn_n_u32(sums[2], kFilterShift), vrshrn_n_u32(sums[3], kFilterShift));
+    vst1q_u32(out + x, vreinterpretq_u32_u8(vcombine_u8(vmovn_u16(low), vmovn_u16(high))));
+  }
+#elif defined(GESTURE_CANVAS_SSE2)
+  // 4 pixels per step, rows taken two at a time so each madd covers two taps
+  const __m128i zero = _mm_setzero_si128();
+  for (; x + 4 <= count; x += 4) {
+    __m128i sums[4] = {zero, zero, zero, zero};
+    for (int k = 0; k < taps; k += 2) {
+      const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + x));
+      const __m128i b = k + 1 < taps ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k + 1] + x)) : zero;
+      const int weightB = k + 1 < taps ? weights[k + 1] : 0;
+      const __m128i aLow = _mm_unpacklo_epi8(a, zero);
+      const __m128i bLow = _mm_unpacklo_epi8(b, zero);
+      const __m128i aHigh = _mm_unpackhi_epi8(a, zero);
+      const __m128i bHigh = _mm_unpackhi_epi8(b, zero);
+      sums[0] = _mm_add_epi32(sums[0], madd2(aLow, bLow, weights[k], weightB));
+      sums[1] = _mm_add_epi32(sums[1], madd2(_mm_srli_si128(aLow, 8), _mm_srli_si128(bLow, 8), weights[k], weightB));
+      sums[2] = _mm_add_epi32(sums[2], madd2(aHigh, bHigh, weights[k], weightB));
+      sums[3] = _mm_add_epi32(sums[3], madd2(_mm_srli_si128(aHigh, 8), _mm_srli_si128(bHigh, 8), weights[k], weightB));
+    }
+    const __m128i low = _mm_packs_epi32(roundSums(sums[0]), roundSums(sums[1]));
+    const __m128i high = _mm_packs_epi32(roundSums(sums[2]), roundSums(sums[3]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(low, high));
+  }
+#endif
+
+  for (; x < count; ++x) {
+    uint32_t sums[4] = {0, 0, 0, 0};
+    for (int k = 0; k < taps; ++k) {
+      accumulate(sums, rows[k][x], weights[k]);
+    }
+    out[x] = roundChannels(sums);
+  }
+}
+
+static inline uint32_t roundedMean(uint32_t a, uint32_t b) {
+  return (a + b + 1) >> 1;
+}
+
+// Mean of the four neighbours the way the SIMD paths take it: two rounded
+// pairwise means, then their rounded mean
+static inline uint32_t neighbourMean(uint32_t left, uint32_t right, uint32_t up, uint32_t down) {
+  return roundedMean(roundedMean(left, right), roundedMean(up, down));
+}
+
+void diffuseWater(const uint8_t* above, const uint8_t* row, const uint8_t* below,
+                  uint8_t* out, uint8_t* rim, int count, uint8_t evaporation) {
+  int i = 0;
+
+#if defined(GESTURE_CANVAS_NEON)
+  const uint8x16_t dry = vdupq_n_u8(evaporation);
+  for (; i + 16 <= count; i += 16) {
+    const uint8x16_t center = vld1q_u8(row + i);
+    const uint8x16_t mean = vrhaddq_u8(vrhaddq_u8(vld1q_u8(row + i - 1), vld1q_u8(row + i + 1)),
+                                       vrhaddq_u8(vld1q_u8(above + i), vld1q_u8(below + i)));
+    vst1q_u8(out + i, vqsubq_u8(vrhaddq_u8(center, mean), dry));
+    vst1q_u8(rim + i, vmaxq_u8(vld1q_u8(rim + i), vqsubq_u8(center, mean)));
+  }
+#elif defined(GESTURE_CANVAS_SSE2)
+  // _mm_avg_epu8 rounds up, like roundedMean
+  const __m128i dry = _mm_set1_epi8(static_cast<char>(evaporation));
+  for (; i + 16 <= count; i += 16) {
+    const __m128i center = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+    const __m128i horizontal = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i - 1)),
+                                            _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i + 1)));
+    const __m128i vertical = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(above + i)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + i)));
+    const __m128i mean = _mm_avg_epu8(horizontal, vertical);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_subs_epu8(_mm_avg_epu8(center, mean), dry));
+    const __m128i edge = _mm_subs_epu8(center, mean);
+    const __m128i kept = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rim + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(rim + i), _mm_max_epu8(kept, edge));
+  }
+#endif
+
+  for (; i < count; ++i) {
+    const uint32_t mean = neighbourMean(row[i - 1], row[i + 1], above[i], below[i]);
+    const uint32_t spread = roundedMean(row[i], mean);
+    out[i] = static_cast<uint8_t>(spread > evaporation ? spread - evaporation : 0);
+    if (row[i] > mean) {
+      rim[i] = static_cast<uint8_t>(std::max<uint32_t>(rim[i], row[i] - mean));
+    }
+  }
+}
+
+void diffusePigment(const uint32_t* above, const uint32_t* row, const uint32_t* below,
+                    const uint8_t* water, int bleed, uint32_t* out, int count) {
+  int i = 0;
+
+#if defined(GESTURE_CANVAS_NEON)
+  // 8 pixels per step, channels deinterleaved; the weight is shared by all four
+  const uint8x8_t bleedFactor = vdup_n_u8(static_cast<uint8_t>(bleed));
+  for (; i + 8 <= count; i += 8) {
+    const uint8x8x4_t center = vld4_u8(reinterpret_cast<const uint8_t*>(row + i));
+    const uint8x8x4_t left = vld4_u8(reinterpret_cast<const uint8_t*>(row + i - 1));
+    const uint8x8x4_t right = vld4_u8(reinterpret_cast<const uint8_t*>(row + i + 1));
+    const uint8x8x4_t up = vld4_u8(reinterpret_cast<const uint8_t*>(above + i));
+    const uint8x8x4_t down = vld4_u8(reinterpret_cast<const uint8_t*>(below + i));
+    const int16x8_t weight = vreinterpretq_s16_u16(vshrq_n_u16(vmull_u8(vld1_u8(water + i), bleedFactor), 8));
+    uint8x8x4_t result;
+    for (int c = 0; c < 4; ++c) {
+      const uint8x8_t mean = vrhadd_u8(vrhadd_u8(left.val[c], right.val[c]), vrhadd_u8(up.val[c], down.val[c]));
+      const int16x8_t toward = vreinterpretq_s16_u16(vsubl_u8(mean, center.val[c]));
+      const int16x8_t moved = vrshrq_n_s16(vmulq_s16(toward, weight), 7);
+      result.val[c] = vqmovun_s16(vaddq_s16(vreinterpretq_s16_u16(vmovl_u8(center.val[c])), moved));
+    }
+    vst4_u8(reinterpret_cast<uint8_t*>(out + i), result);
+  }
+#elif defined(GESTURE_CANVAS_SSE2)
+  // 4 pixels per step, halves widened to 16-bit lanes with each pixel's
+  // weight repeated across its channels
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i bleedFactor = _mm_set1_epi16(static_cast<int16_t>(bleed));
+  const __m128i half = _mm_set1_epi16(64);
+  for (; i + 4 <= count; i += 4) {
+    const __m128i center = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+    const __m128i mean = _mm_avg_epu8(
+        _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i - 1)),
+                     _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i + 1))),
+        _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(above + i)),
+                     _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + i))));
+    int32_t wetness;
+    std::memcpy(&wetness, water + i, sizeof(wetness));
+    __m128i weights = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(wetness), zero), bleedFactor), 8);
+    weights = _mm_unpacklo_epi16(weights, weights);
+    const __m128i weightsLow = _mm_unpacklo_epi32(weights, weights);
+    const __m128i weightsHigh = _mm_unpackhi_epi32(weights, weights);
+
+    const __m128i centerLow = _mm_unpacklo_epi8(center, zero);
+    const __m128i centerHigh = _mm_unpackhi_epi8(center, zero);
+    const __m128i movedLow = _mm_srai_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(mean, zero), centerLow), weightsLow), half), 7);
+    const __m128i movedHigh = _mm_srai_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(mean, zero), centerHigh), weightsHigh), half), 7);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                     _mm_packus_epi16(_mm_add_epi16(centerLow, movedLow), _mm_add_epi16(centerHigh, movedHigh)));
+  }
+#endif
+
+  for (; i < count; ++i) {
+    const int weight = (water[i] * bleed) >> 8;
+    uint32_t result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+      const int center = (row[i] >> shift) & 0xFF;
+      const int mean = static_cast<int>(neighbourMean((row[i - 1] >> shift) & 0xFF, (row[i + 1] >> shift) & 0xFF,
+                                                      (above[i] >> shift) & 0xFF, (below[i] >> shift) & 0xFF));
+      const int moved = ((mean - center) * weight + 64) >> 7;
+      result |= static_cast<uint32_t>(center + moved) << shift;
+    }
+    out[i] = result;
+  }
+}
+
+uint64_t matchColor(const uint32_t* pixels, int count, uint32_t color, uint8_t tolerance) {
+  uint64_t bits = 0;
+  int i = 0;
+
+#if defined(GESTURE_CANVAS_NEON)
+  // A pixel matches when its four channel lanes all stay within the limit;
+  // the lane masks are weighted 1, 2, 4, 8 and summed into four bits
+  const uint8x16_t target = vreinterpretq_u8_u32(vdupq_n_u32(color));
+  const uint8x16_t limit = vdupq_n_u8(tolerance);
+  const uint32_t laneBits[4] = {1, 2, 4, 8};
+  const uint32x4_t weights = vld1q_u32(laneBits);
+  for (; i + 4 <= count; i += 4) {
+    const uint8x16_t over = vcgtq_u8(vabdq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(pixels + i)), target), limit);
+    const uint32x4_t inside = vandq_u32(vceqq_u32(vreinterpretq_u32_u8(over), vdupq_n_u32(0)), weights);
+    uint16x4_t packed = vmovn_u32(inside);
+    packed = vpadd_u16(packed, packed);
+    packed = vpadd_u16(packed, packed);
+    bits |= static_cast<uint64_t>(vget_lane_u16(packed, 0)) << i;
+  }
+#elif defined(GESTURE_CANVAS_SSE2)
+  // Absolute differences from two saturating subtractions; whatever is
+  // left over the limit rules the pixel out
+  const __m128i target = _mm_set1_epi32(static_cast<int>(color));
+  const __m128i limit = _mm_set1_epi8(static_cast<char>(tolerance));
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 4 <= count; i += 4) {
+    const __m128i pixel = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i));
+    const __m128i difference = _mm_or_si128(_mm_subs_epu8(pixel, target), _mm_subs_epu8(target, pixel));
+    const __m128i inside = _mm_cmpeq_epi32(_mm_subs_epu8(difference, limit), zero);
+    bits |= static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(inside))) << i;
+  }
+#endif
+
+  for (; i < count; ++i) {
+    bool inside = true;
+    for (int shift = 0; shift < 32; shift += 8) {
+      const int a = (pixels[i] >> shift) & 0xFF;
+      const int b = (color >> shift) & 0xFF;
+      inside = inside && std::abs(a - b) <= tolerance;
+    }
+    bits |= static_cast<uint64_t>(inside) << i;
+  }
+  return bits;
+}
+
+} // namespace facebook::react
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+namespace facebook::react {
+
+// Averages 2x2 blocks of ARGB pixels: out[i] is the rounded mean of
+// row0[2i], row0[2i+1], row1[2i], row1[2i+1]. Uses NEON or SSE2 when
+// available; all paths produce identical results.
+void downsample2x2(const uint32_t* row0, const uint32_t* row1, uint32_t* out, int outCount);
+
+// Filter weights are fixed point with kFilterOne as 1.0; every output's
+// weights are non-negative and sum to exactly kFilterOne. Results are
+// rounded per channel and identical on every path.
+constexpr int kFilterShift = 14;
+constexpr int kFilterOne = 1 << kFilterShift;
+
+// Horizontal pass: out[i] weighs src[starts[i] .. starts[i] + taps) by
+// weights[i * taps ..]
+void filterRow(const uint32_t* src, uint32_t* out, int outCount,
+               const int* starts, const int16_t* weights, int taps);
+
+// Vertical pass: out[x] weighs rows[0][x] .. rows[taps - 1][x] by weights
+void filterColumns(const uint32_t* const* rows, const int16_t* weights, int taps,
+                   uint32_t* out, int count);
+
+// Wet-paint stencils (see WetPaint.h). row[-1] and row[count] must be
+// readable; above and below line up with row. Identical on every path.
+//
+// Water: out[i] is the rounded mean of row[i] and the mean of its four
+// neighbours, less evaporation; rim[i] keeps the most row[i] has stood
+// above that neighbour mean, i.e. how sharp the wet edge there has been.
+void diffuseWater(const uint8_t* above, const uint8_t* row, const uint8_t* below,
+                  uint8_t* out, uint8_t* rim, int count, uint8_t evaporation);
+
+// Pigment: every channel of out[i] moves from row[i] towards the mean of
+// its four neighbours by water[i] * bleed / 2^15 (bleed at most 128), so
+// only wet pixels take up colour
+void diffusePigment(const uint32_t* above, const uint32_t* row, const uint32_t* below,
+                    const uint8_t* water, int bleed, uint32_t* out, int count);
+
+// Flood-fill test (see FloodFill.h): bit i is set when no channel of
+// pixels[i] differs from color by more than tolerance. count is at most 64.
+uint64_t matchColor(const uint32_t* pixels, int count, uint32_t color, uint8_t tolerance);
+
+} // namespace facebook::react
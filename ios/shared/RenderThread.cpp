@@ -0,0 +1,139 @@
+#include "RenderThread.h"
+#include <algorithm>
+#include "PerfStats.h"
+
+namespace facebook::react {
+
+RenderThread::RenderThread(BatchHandler onBatch)
+    : onBatch_(std::move(onBatch)), defaultLane_(std::make_shared<Lane>()) {
+  thread_ = std::thread([this] { run(); });
+}
+
+RenderThread::~RenderThread() {
+  RenderCommand stop;
+  stop.type = RenderCommandType::Stop;
+  submit(std::move(stop));
+  wake();
+  thread_.join();
+}
+
+void RenderThread::submit(RenderCommand&& command) {
+  submit(*defaultLane_, std::move(command));
+}
+
+std::shared_ptr<RenderThread::Lane> RenderThread::createLane() {
+  auto lane = std::make_shared<Lane>();
+  {
+    std::lock_guard<std::mutex> lock(lanesMutex_);
+    lanes_.push_back(lane);
+  }
+  lanesChanged_.store(true, std::memory_order_release);
+  return lane;
+}
+
+void RenderThread::submit(Lane& lane, RenderCommand&& command) {
+  command.submittedAt = PerfStats::now();
+  // A full ring means the render thread is far behind; wait for room rather
+  // than drop strokes
+  while (!lane.tryPush(std::move(command))) {
+    std::this_thread::yield();
+  }
+  submitted_.fetch_add(1, std::memory_order_release);
+  if (!paced_.load(std::memory_order_relaxed)) {
+    wake();
+  }
+}
+
+void RenderThread::setPaced(bool paced) {
+  paced_.store(paced, std::memory_order_relaxed);
+  // Anything queued while paced is applied straight away when unpacing
+  wake();
+}
+
+void RenderThread::tick() {
+  wake();
+}
+
+void RenderThread::wake() {
+  wakeups_.fetch_add(1, std::memory_order_release);
+  wakeups_.notify_one();
+}
+
+void RenderThread::flush() {
+  const uint64_t target = submitted_.load(std::memory_order_acquire);
+  if (processed_.load(std::memory_order_acquire) < target) {
+    // Don't wait for the next frame tick
+    wake();
+  }
+  uint64_t done = processed_.load(std::memory_order_acquire);
+  while (done < target) {
+    processed_.wait(done, std::memory_order_acquire);
+    done = processed_.load(std::memory_order_acquire);
+  }
+}
+
+size_t RenderThread::drain(Lane& lane, std::vector<RenderCommand>& batch, bool& stopping) {
+  size_t count = 0;
+  RenderCommand command;
+  while (lane.tryPop(command)) {
+    if (command.type == RenderCommandType::Stop) {
+      stopping = true;
+    } else {
+      batch.push_back(std::move(command));
+    }
+    ++count;
+  }
+  return count;
+}
+
+void RenderThread::run() {
+  uint64_t seen = 0;
+  uint64_t wakeupsSeen = 0;
+  std::vector<RenderCommand> batch;
+  std::vector<std::shared_ptr<Lane>> lanes;
+  for (;;) {
+    wakeups_.wait(wakeupsSeen, std::memory_order_acquire);
+    wakeupsSeen = wakeups_.load(std::memory_order_acquire);
+
+    // The lane list is only re-read when a producer has been added
+    if (lanesChanged_.exchange(false, std::memory_order_acq_rel)) {
+      std::lock_guard<std::mutex> lock(lanesMutex_);
+      lanes = lanes_;
+    }
+
+    size_t count = 0;
+    bool stopping = false;
+    count += drain(*defaultLane_, batch, stopping);
+    std::vector<Lane*> abandoned;
+    for (auto& lane : lanes) {
+      // Held only by lanes_ and this copy: the producer is gone, so this is
+      // its final drain
+      if (lane.use_count() == 2) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        abandoned.push_back(lane.get());
+      }
+      count += drain(*lane, batch, stopping);
+    }
+    seen += count;
+
+    onBatch_(batch);
+    batch.clear();
+    if (count > 0) {
+      processed_.store(seen, std::memory_order_release);
+      processed_.notify_all();
+    }
+    if (stopping) {
+      return;
+    }
+
+    if (!abandoned.empty()) {
+      std::lock_guard<std::mutex> lock(lanesMutex_);
+      std::erase_if(lanes_, [&abandoned](const auto& lane) {
+        return std::find(abandoned.begin(), abandoned.end(), lane.get()) != abandoned.end();
+      });
+      lanes = lanes_;
+    }
+  }
+}
+
+} // namespace facebook::react
@@ -0,0 +1,137 @@
+#include "SnapshotEncoder.h"
+#include <algorithm>
+#include <cstring>
+
+#pragma pack(push, 1)
+struct BMPHeader {
+    uint16_t fileType;      // File type, always "BM" (0x4D42)
+    uint32_t fileSize;      // Size of the file in bytes
+    uint16_t reserved1;     // Reserved, always 0
+    uint16_t reserved2;     // Reserved, always 0
+    uint32_t dataOffset;    // Offset to image data in bytes
+    uint32_t headerSize;    // Header size in bytes (40)
+    int32_t width;          // Width of the image
+    int32_t height;         // Height of the image
+    uint16_t planes;        // Number of color planes
+    uint16_t bitsPerPixel;  // Bits per pixel
+    uint32_t compression;   // Compression type
+    uint32_t imageSize;     // Image size in bytes
+    int32_t xPixelsPerM;    // Pixels per meter in x
+    int32_t yPixelsPerM;    // Pixels per meter in y
+    uint32_t colorsUsed;    // Number of colors used
+    uint32_t colorsImportant; // Number of important colors
+};
+#pragma pack(pop)
+
+namespace facebook::react {
+
+std::string base64Encode(const std::vector<uint8_t>& input) {
+    static const char base64_chars[] = 
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz"
+        "0123456789+/";
+        
+    std::string output;
+    output.reserve(((input.size() + 2) / 3) * 4);
+    int val = 0, valb = -6;
+    
+    for (uint8_t c : input) {
+        val = (val << 8) + c;
+        valb += 8;
+        while (valb >= 0) {
+            output.push_back(base64_chars[(val >> valb) & 0x3F]);
+            valb -= 6;
+        }
+    }
+    
+    if (valb > -6) {
+        output.push_back(base64_chars[((val << 8) >> (valb + 8)) & 0x3F]);
+    }
+    
+    // Add padding
+    while (output.size() % 4) {
+        output.push_back('=');
+    }
+    
+    return output;
+}
+
+int bmpRowSize(int width) {
+    return ((width * 24 + 31) / 32) * 4; // Row size must be multiple of 4 bytes
+}
+
+size_t bmpHeaderSize() {
+    return sizeof(BMPHeader);
+}
+
+size_t bmpFileSize(int width, int height) {
+    return sizeof(BMPHeader) + static_cast<size_t>(bmpRowSize(width)) * height;
+}
+
+void writeBmpHeader(uint8_t* out, int width, int height) {
+    const int headerSize = sizeof(BMPHeader);
+    const int pixelDataSize = bmpRowSize(width) * height;
+    
+    BMPHeader header;
+    header.fileType = 0x4D42; 
+    header.fileSize = headerSize + pixelDataSize;
+    header.reserved1 = 0;
+    header.reserved2 = 0;
+    header.dataOffset = headerSize;
+    header.headerSize = 40;
+    header.width = width;
+    header.height = -height; // Negative for top-down image
+    header.planes = 1;
+    header.bitsPerPixel = 24; // 24-bit RGB
+    header.compression = 0;   // No compression
+    header.imageSize = pixelDataSize;
+    header.xPixelsPerM = 2835; // ~72 DPI
+    header.yPixelsPerM = 2835; // ~72 DPI
+    header.colorsUsed = 0;
+    header.colorsImportant = 0;
+    
+    std::memcpy(out, &header, headerSize);
+}
+
+void packBmpRow(const uint32_t* src, int width, uint8_t* out) {
+    for (int x = 0; x < width; ++x) {
+        uint32_t pixel = src[x];
+        *out++ = pixel & 0xFF;          // blue
+        *out++ = (pixel >> 8) & 0xFF;   // green
+        *out++ = (pixel >> 16) & 0xFF;  // red
+    }
+}
+
+// Builds the whole BMP in memory; rowSource(y, row) fills one row of ARGB pixels
+template <typename RowSource>
+static std::string encodeBmp(int width, int height, RowSource&& rowSource) {
+    const int rowSize = bmpRowSize(width);
+    
+    // Create buffer for entire BMP file
+    std::vector<uint8_t> bmpData(bmpFileSize(width, height));
+    writeBmpHeader(bmpData.data(), width, height);
+    
+    // Copy pixel data to buffer
+    std::vector<uint32_t> row(width);
+    for (int y = 0; y < height; ++y) {
+        const uint32_t* src = rowSource(y, row.data());
+        packBmpRow(src, width, bmpData.data() + bmpHeaderSize() + static_cast<size_t>(y) * rowSize);
+    }
+    
+    return "data:image/bmp;base64," + base64Encode(bmpData);
+}
+
+std::string encodeBmpDataUrl(const TileGrid& pixels) {
+    return encodeBmp(pixels.width(), pixels.height(), [&](int y, uint32_t* row) {
+        pixels.copyRow(y, row);
+        return static_cast<const uint32_t*>(row);
+    });
+}
+
+std::string encodeBmpDataUrl(const uint32_t* pixels, int width, int height) {
+    return encodeBmp(width, height, [&](int y, uint32_t*) {
+        return pixels + static_cast<size_t>(y) * width;
+    });
+}
+
+} // namespace facebook::react
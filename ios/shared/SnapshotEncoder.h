@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "TileGrid.h"
+
+namespace facebook::react {
+
+// Encodes a pixel plane as a 24-bit top-down BMP wrapped in a base64 data URL.
+// Only reads from the grid, so it is safe to run on a captured copy while the
+// live canvas keeps drawing.
+std::string encodeBmpDataUrl(const TileGrid& pixels);
+std::string encodeBmpDataUrl(const uint32_t* pixels, int width, int height);
+
+std::string base64Encode(const std::vector<uint8_t>& input);
+
+// Building blocks for writers that stream a BMP instead of holding it whole
+int bmpRowSize(int width);
+size_t bmpHeaderSize();
+size_t bmpFileSize(int width, int height);
+void writeBmpHeader(uint8_t* out, int width, int height);
+void packBmpRow(const uint32_t* src, int width, uint8_t* out);
+
+} // namespace facebook::react
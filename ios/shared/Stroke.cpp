@@ -1,16 +1,28 @@
 #include "Stroke.h"
+#include <utility>
 
 namespace facebook::react {
 
-Stroke::Stroke(std::shared_ptr<BrushEngine> brushEngine) 
-    : brushEngine_(brushEngine), isActive_(true) {}
+Stroke::Stroke(std::shared_ptr<const BrushPreset> preset)
+    : preset_(std::move(preset)), isActive_(true) {
+  brushEngine_.configureBrush(preset_->style());
+}
+
+void Stroke::addPoint(const PointData& point) {
+  points_.push_back(point);
+}
 
-void Stroke::addPoint(double x, double y, double pressure, double timestamp) {
-  points_.push_back(std::make_tuple(x, y, pressure, timestamp));
+double Stroke::segmentRandom(size_t index) const {
+  // splitmix64 of (serial, index): no state to carry across threads
+  uint64_t z = (static_cast<uint64_t>(serial_) << 32 | index) + 0x9e3779b97f4a7c15ull;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  z ^= z >> 31;
+  return (z >> 11) * 0x1.0p-53;
 }
 
-void Stroke::end(double x, double y, double pressure, double timestamp) {
-  addPoint(x, y, pressure, timestamp);
+void Stroke::end(const PointData& point) {
+  addPoint(point);
   isActive_ = false;
 }
 
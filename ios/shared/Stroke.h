@@ -1,22 +1,29 @@
 #pragma once
 
 #include <vector>
-#include <tuple>
 #include <memory>
 #include "BrushEngine.h"
+#include "BrushPreset.h"
+#include "CanvasTypes.h"
 
 namespace facebook::react {
 
 class Stroke {
 public:
-  Stroke(std::shared_ptr<BrushEngine> brushEngine);
+  explicit Stroke(std::shared_ptr<const BrushPreset> preset);
   
-  void addPoint(double x, double y, double pressure, double timestamp);
-  void end(double x, double y, double pressure, double timestamp);
+  void addPoint(const PointData& point);
+  void end(const PointData& point);
   
-  std::shared_ptr<BrushEngine> brushEngine_;
-  std::vector<std::tuple<double, double, double, double>> points_; // x, y, pressure, timestamp
+  // Deterministic random number in [0, 1) for the segment ending at point
+  // index, so a replay draws the same texture jitter
+  double segmentRandom(size_t index) const;
+  
+  std::shared_ptr<const BrushPreset> preset_;
+  BrushEngine brushEngine_; // Per-stroke physics state, seeded from the preset
+  std::vector<PointData> points_;
   bool isActive_;
+  uint32_t serial_ = 0; // Per-canvas stroke number; seeds segmentRandom and names the stroke in the journal
 };
 
 } // namespace facebook::react
\ No newline at end of file
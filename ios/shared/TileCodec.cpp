@@ -0,0 +1,112 @@
+#include "TileCodec.h"
+#include <algorithm>
+#include <array>
+
+namespace facebook::react {
+
+namespace {
+
+constexpr size_t kTileBytes = kTilePixels * sizeof(uint32_t);
+constexpr size_t kMaxRun = 128;
+
+} // namespace
+
+void packBitsEncode(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+  size_t i = 0;
+  while (i < size) {
+    // A repeat of three or more is worth a run; anything else goes literal
+    size_t run = 1;
+    while (i + run < size && run < kMaxRun && data[i + run] == data[i]) {
+      ++run;
+    }
+    if (run >= 3) {
+      out.push_back(static_cast<uint8_t>(257 - run));
+      out.push_back(data[i]);
+      i += run;
+      continue;
+    }
+    
+    size_t literalEnd = i;
+    while (literalEnd < size && literalEnd - i < kMaxRun) {
+      if (literalEnd + 2 < size && data[literalEnd] == data[literalEnd + 1] &&
+          data[literalEnd] == data[literalEnd + 2]) {
+        break;
+      }
+      ++literalEnd;
+    }
+    out.push_back(static_cast<uint8_t>(literalEnd - i - 1));
+    out.insert(out.end(), data + i, data + literalEnd);
+    i = literalEnd;
+  }
+}
+
+bool packBitsDecode(const uint8_t* data, size_t size, uint8_t* out, size_t outSize) {
+  size_t i = 0;
+  size_t written = 0;
+  while (i < size) {
+    const uint8_t header = data[i++];
+    if (header < 128) {
+      const size_t count = header + 1;
+      if (i + count > size || written + count > outSize) {
+        return false;
+      }
+      std::copy_n(data + i, count, out + written);
+      i += count;
+      written += count;
+    } else if (header > 128) {
+      const size_t count = 257 - header;
+      if (i >= size || written + count > outSize) {
+        return false;
+      }
+      std::fill_n(out + written, count, data[i++]);
+      written += count;
+    }
+  }
+  return written == outSize;
+}
+
+void compressTile(const PixelTile& tile, std::vector<uint8_t>& out) {
+  std::array<uint8_t, kTileBytes> planes;
+  for (int channel = 0; channel < 4; ++channel) {
+    uint8_t* plane = planes.data() + channel * kTilePixels;
+    const int shift = channel * 8;
+    // Each row starts from the pixel above, so flat tiles become all zeros
+    uint8_t above = 0;
+    for (int y = 0; y < kTileSize; ++y) {
+      const uint32_t* row = tile.pixels.data() + y * kTileSize;
+      uint8_t previous = above;
+      for (int x = 0; x < kTileSize; ++x) {
+        const auto value = static_cast<uint8_t>(row[x] >> shift);
+        plane[y * kTileSize + x] = static_cast<uint8_t>(value - previous);
+        previous = value;
+      }
+      above = static_cast<uint8_t>(row[0] >> shift);
+    }
+  }
+  packBitsEncode(planes.data(), planes.size(), out);
+}
+
+bool decompressTile(const uint8_t* data, size_t size, PixelTile& tile) {
+  std::array<uint8_t, kTileBytes> planes;
+  if (!packBitsDecode(data, size, planes.data(), planes.size())) {
+    return false;
+  }
+  tile.pixels.fill(0);
+  for (int channel = 0; channel < 4; ++channel) {
+    const uint8_t* plane = planes.data() + channel * kTilePixels;
+    const int shift = channel * 8;
+    uint8_t above = 0;
+    for (int y = 0; y < kTileSize; ++y) {
+      uint32_t* row = tile.pixels.data() + y * kTileSize;
+      uint8_t value = above;
+      for (int x = 0; x < kTileSize; ++x) {
+        value = static_cast<uint8_t>(value + plane[y * kTileSize + x]);
+        row[x] |= static_cast<uint32_t>(value) << shift;
+      }
+      above = static_cast<uint8_t>(row[0] >> shift);
+    }
+  }
+  return true;
+}
+
+} // namespace facebook::react
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "TileGrid.h"
+
+namespace facebook::react {
+
+// Lossless compression for pixel tiles. Channels are split into planes and
+// delta coded along each row, then run-length coded with PackBits, so flat
+// and sparsely painted tiles shrink to a few hundred bytes while busy ones
+// stay close to raw size. Cheap enough to run on the render thread.
+void compressTile(const PixelTile& tile, std::vector<uint8_t>& out);
+bool decompressTile(const uint8_t* data, size_t size, PixelTile& tile);
+
+// PackBits run-length coding of a byte buffer. Decoding fails unless the
+// input produces exactly outSize bytes.
+void packBitsEncode(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+bool packBitsDecode(const uint8_t* data, size_t size, uint8_t* out, size_t outSize);
+
+} // namespace facebook::react
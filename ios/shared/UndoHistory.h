@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "TileGrid.h"
+
+namespace facebook::react {
+
+// Tile-level undo/redo for a TileGrid. A step keeps only the tiles it
+// changed, as they were before it, shared copy-on-write with the live grid.
+// Undoing swaps those tiles back in and keeps the swapped-out ones for redo,
+// so both cost the step's footprint rather than the canvas size. When the
+// history outgrows its byte budget the oldest steps are compressed first and
+// dropped after that.
+//
+// Each step also carries the marks its owner passed when it began and ended
+// (journal offsets for a canvas), so the owner can tell what an undo or redo
+// took away or brought back.
+class UndoHistory {
+public:
+  static constexpr size_t kDefaultBudgetBytes = size_t(64) << 20;
+
+  enum class StepKind : uint8_t {
+    Edit,
+    Physics, // Consecutive physics steps merge into one
+  };
+
+  // From the mark the step began at to the one it ended at
+  struct Marks {
+    uint64_t begin = 0;
+    uint64_t end = 0;
+  };
+
+  bool isRecording() const { return checkpoint_.has_value() && !physicsOpen_; }
+
+  // Starts a step at the current state of pixels; no-op while one is open.
+  // A physics step carries on from the last one's checkpoint if nothing
+  // else began since, so running physics every frame takes no checkpoints.
+  void begin(const TileGrid& pixels, StepKind kind, uint64_t mark);
+  // Ends the open step, recording the tiles changed since begin(). Physics
+  // steps are only recorded once something else begins or commits.
+  void commit(const TileGrid& pixels, StepKind kind, uint64_t mark);
+
+  // Swap the latest step's tiles into pixels and report which tiles changed
+  // and the step's marks. Return false when there is nothing to undo or redo.
+  bool undo(TileGrid& pixels, std::vector<int>& restoredTiles, Marks& applied);
+  bool redo(TileGrid& pixels, std::vector<int>& restoredTiles, Marks& applied);
+
+  void setBudget(size_t bytes);
+  size_t bytesUsed() const { return bytes_; }
+  void reset();
+
+private:
+  struct SavedTile {
+    int index;
+    std::shared_ptr<PixelTile> pixels; // Null while compressed
+    std::vector<uint8_t> packed;       // compressTile output when compressed
+  };
+
+  struct Step {
+    StepKind kind;
+    Marks marks;
+    std::vector<SavedTile> tiles; // Sorted by index
+    size_t bytes = 0;
+    bool compressed = false;
+  };
+
+  static size_t savedBytes(const SavedTile& tile);
+  static size_t stepBytes(const Step& step);
+  static void compress(SavedTile& tile);
+  static std::shared_ptr<PixelTile> decompress(const SavedTile& tile);
+
+  void record(const TileGrid& pixels, StepKind kind, uint64_t endMark);
+  void swapStep(Step& step, TileGrid& pixels, std::vector<int>& restoredTiles);
+  void mergeInto(Step& older, Step&& newer);
+  void enforceBudget();
+
+  std::optional<TileGrid> checkpoint_;
+  uint64_t checkpointMark_ = 0;
+  bool physicsOpen_ = false; // checkpoint_ is a committed physics step's
+  uint64_t physicsEndMark_ = 0; // Where the open physics step ended
+  std::deque<Step> undo_; // Oldest first
+  std::vector<Step> redo_; // Most recently undone last
+  size_t budget_ = kDefaultBudgetBytes;
+  size_t bytes_ = 0;
+};
+
+} // namespace facebook::react
@@ -0,0 +1,189 @@
+#include "WetPaint.h"
+#include <algorithm>
+#include <cstring>
+#include "BlendKernels.h"
+#include "PixelKernels.h"
+
+namespace facebook::react {
+
+namespace {
+
+// A drying pixel's color darkens by up to half its rim (out of 255)
+uint32_t darken(uint32_t pixel, uint32_t rim) {
+  const uint32_t keep = 255 - (rim >> 1);
+  uint32_t result = pixel & 0xFF000000;
+  for (int shift = 0; shift < 24; shift += 8) {
+    result |= div255(((pixel >> shift) & 0xFF) * keep) << shift;
+  }
+  return result;
+}
+
+} // namespace
+
+WetPaint::WetPaint(int width, int height) {
+  reset(width, height);
+}
+
+void WetPaint::reset(int width, int height) {
+  width_ = width;
+  height_ = height;
+  tilesX_ = (width + kTileSize - 1) / kTileSize;
+  tilesY_ = (height + kTileSize - 1) / kTileSize;
+  tiles_.clear();
+  tiles_.resize(static_cast<size_t>(tilesX_) * tilesY_);
+  wetTiles_.store(0, std::memory_order_relaxed);
+}
+
+uint8_t* WetPaint::mutableSpan(int x, int y) {
+  const int tile = (y >> kTileShift) * tilesX_ + (x >> kTileShift);
+  return wake(tile).water.data() + TileGrid::offsetInTile(x, y);
+}
+
+void WetPaint::dry(int tile) {
+  if (tiles_[tile]) {
+    tiles_[tile].reset();
+    wetTiles_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+WetPaint::WetTile& WetPaint::wake(int tile) {
+  if (!tiles_[tile]) {
+    tiles_[tile] = std::make_unique<WetTile>();
+    wetTiles_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return *tiles_[tile];
+}
+
+uint8_t WetPaint::waterAt(int x, int y) const {
+  if (x < 0 || y < 0 || x >= width_ || y >= height_) {
+    return 0;
+  }
+  const auto& tile = tiles_[(y >> kTileShift) * tilesX_ + (x >> kTileShift)];
+  return tile ? tile->water[TileGrid::offsetInTile(x, y)] : 0;
+}
+
+uint64_t WetPaint::step(TileGrid& pixels, int top) {
+  if (!isWet()) {
+    return 0;
+  }
+  active_.clear();
+  for (int tile = 0; tile < static_cast<int>(tiles_.size()); ++tile) {
+    if (tiles_[tile]) {
+      active_.push_back(tile);
+    }
+  }
+
+  // Every tile reads the water and pixels from before the step, so the
+  // borders of all of them are taken before any is written
+  padded_.resize(active_.size());
+  for (size_t i = 0; i < active_.size(); ++i) {
+    gatherTile(active_[i], pixels, top, padded_[i]);
+  }
+  uint64_t stepped = 0;
+  for (size_t i = 0; i < active_.size(); ++i) {
+    stepped += stepTile(active_[i], padded_[i], pixels, top);
+  }
+
+  // Dry tiles retire first, so a neighbour's wet border can wake them again
+  for (int tile : active_) {
+    const auto& water = tiles_[tile]->water;
+    if (std::all_of(water.begin(), water.end(), [](uint8_t amount) { return amount == 0; })) {
+      dry(tile);
+    }
+  }
+  for (int tile : active_) {
+    if (!tiles_[tile] || !wetBorder(tile)) {
+      continue;
+    }
+    const int tileX = tile % tilesX_;
+    const int tileY = tile / tilesX_;
+    if (tileX > 0) {
+      wake(tile - 1);
+    }
+    if (tileX + 1 < tilesX_) {
+      wake(tile + 1);
+    }
+    if (tileY > 0) {
+      wake(tile - tilesX_);
+    }
+    if (tileY + 1 < tilesY_) {
+      wake(tile + tilesX_);
+    }
+  }
+  return stepped;
+}
+
+bool WetPaint::wetBorder(int tile) const {
+  const auto& water = tiles_[tile]->water;
+  for (int i = 0; i < kTileSize; ++i) {
+    if (water[i] || water[kTilePixels - kTileSize + i] || water[i * kTileSize] ||
+        water[i * kTileSize + kTileSize - 1]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void WetPaint::gatherTile(int tile, const TileGrid& pixels, int top, PaddedTile& padded) const {
+  const WetTile& wet = *tiles_[tile];
+  const int x0 = (tile % tilesX_) * kTileSize;
+  const int y0 = (tile / tilesX_) * kTileSize;
+  const int columns = std::min(kTileSize, width_ - x0);
+  const int rows = std::min(kTileSize, height_ - y0);
+
+  // The tile with a one-pixel border taken from its neighbours: no water
+  // past the canvas edge, and the edge pixels repeated
+  const int left = std::max(x0 - 1, 0);
+  const int right = std::min(x0 + columns, width_ - 1);
+  for (int y = -1; y <= rows; ++y) {
+    uint8_t* water = padded.water.data() + (y + 1) * kPadded;
+    uint32_t* row = padded.pixels.data() + (y + 1) * kPadded;
+    const int canvasY = std::clamp(y0 + y, 0, height_ - 1);
+    if (y >= 0 && y < rows) {
+      std::memcpy(water + 1, wet.water.data() + y * kTileSize, columns);
+    } else {
+      for (int x = 0; x < columns; ++x) {
+        water[x + 1] = waterAt(x0 + x, y0 + y);
+      }
+    }
+    water[0] = waterAt(x0 - 1, y0 + y);
+    water[columns + 1] = waterAt(x0 + columns, y0 + y);
+    std::memcpy(row + 1, pixels.span(x0, top + canvasY), columns * sizeof(uint32_t));
+    row[0] = pixels.pixel(left, top + canvasY);
+    row[columns + 1] = pixels.pixel(right, top + canvasY);
+  }
+}
+
+uint64_t WetPaint::stepTile(int tile, const PaddedTile& padded, TileGrid& pixels, int top) {
+  WetTile& wet = *tiles_[tile];
+  const int x0 = (tile % tilesX_) * kTileSize;
+  const int y0 = (tile / tilesX_) * kTileSize;
+  const int columns = std::min(kTileSize, width_ - x0);
+  const int rows = std::min(kTileSize, height_ - y0);
+
+  // The water is read from the padded copy, so the tile's own is rewritten in place
+  wet.water.fill(0);
+  for (int y = 0; y < rows; ++y) {
+    const uint8_t* water = padded.water.data() + (y + 1) * kPadded + 1;
+    uint8_t* next = wet.water.data() + y * kTileSize;
+    uint8_t* rim = wet.rim.data() + y * kTileSize;
+    diffuseWater(water - kPadded, water, water + kPadded, next, rim, columns, kEvaporation);
+    if (std::all_of(water, water + columns, [](uint8_t amount) { return amount == 0; })) {
+      // Nothing wet in the row yet, so its pigment stays where it is
+      continue;
+    }
+
+    const uint32_t* row = padded.pixels.data() + (y + 1) * kPadded + 1;
+    uint32_t* out = pixels.mutableSpan(x0, top + y0 + y);
+    diffusePigment(row - kPadded, row, row + kPadded, water, kBleed, out, columns);
+    for (int x = 0; x < columns; ++x) {
+      if (water[x] && !next[x]) {
+        out[x] = darken(out[x], rim[x]);
+        rim[x] = 0;
+      }
+    }
+  }
+  return static_cast<uint64_t>(columns) * rows;
+}
+
+} // namespace facebook::react
@@ -0,0 +1,273 @@
+#include "BlendKernels.h"
+#include <cstring>
+#include <utility>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GESTURE_CANVAS_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GESTURE_CANVAS_SSE2 1
+#endif
+
+namespace facebook::react {
+
+namespace {
+
+// Every path works on channels widened to 16 bits: products of two channels
+// fit, and so does d * (255 - a) + b * a, which keeps div255 exact.
+
+#if defined(GESTURE_CANVAS_NEON)
+inline uint16x8_t div255x8(uint16x8_t value) {
+  const uint16x8_t rounded = vaddq_u16(value, vdupq_n_u16(128));
+  return vshrq_n_u16(vaddq_u16(rounded, vshrq_n_u16(rounded, 8)), 8);
+}
+
+template <BlendMode Mode>
+inline uint16x8_t blendChannels(uint16x8_t below, uint16x8_t above) {
+  if constexpr (Mode == BlendMode::Multiply) {
+    return div255x8(vmulq_u16(below, above));
+  } else if constexpr (Mode == BlendMode::Screen) {
+    return vsubq_u16(vaddq_u16(below, above), div255x8(vmulq_u16(below, above)));
+  } else if constexpr (Mode == BlendMode::Overlay) {
+    const uint16x8_t max = vdupq_n_u16(255);
+    const uint16x8_t dark = div255x8(vshlq_n_u16(vmulq_u16(below, above), 1));
+    const uint16x8_t light = vsubq_u16(max, div255x8(vshlq_n_u16(vmulq_u16(vsubq_u16(max, below), vsubq_u16(max, above)), 1)));
+    return vbslq_u16(vcltq_u16(below, vdupq_n_u16(128)), dark, light);
+  } else if constexpr (Mode == BlendMode::Darken) {
+    return vminq_u16(below, above);
+  } else if constexpr (Mode == BlendMode::Lighten) {
+    return vmaxq_u16(below, above);
+  } else if constexpr (Mode == BlendMode::Additive) {
+    return vminq_u16(vaddq_u16(below, above), vdupq_n_u16(255));
+  } else if constexpr (Mode == BlendMode::Erase) {
+    return below;
+  } else {
+    return above;
+  }
+}
+
+inline uint8x8_t mix(uint16x8_t below, uint16x8_t blended, uint16x8_t alpha) {
+  const uint16x8_t inverse = vsubq_u16(vdupq_n_u16(255), alpha);
+  return vmovn_u16(div255x8(vaddq_u16(vmulq_u16(below, inverse), vmulq_u16(blended, alpha))));
+}
+
+// 8 pixels, channels deinterleaved; above holds the source colors
+template <BlendMode Mode>
+inline void blend8(uint8x8x4_t& pixels, const uint16x8_t above[3], uint16x8_t alpha) {
+  for (int c = 0; c < 3; ++c) {
+    const uint16x8_t below = vmovl_u8(pixels.val[c]);
+    pixels.val[c] = mix(below, blendChannels<Mode>(below, above[c]), alpha);
+  }
+  const uint16x8_t targetAlpha = vdupq_n_u16(Mode == BlendMode::Erase ? 0 : 255);
+  pixels.val[3] = mix(vmovl_u8(pixels.val[3]), targetAlpha, alpha);
+}
+#elif defined(GESTURE_CANVAS_SSE2)
+inline __m128i div255x8(__m128i value) {
+  const __m128i rounded = _mm_add_epi16(value, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(rounded, _mm_srli_epi16(rounded, 8)), 8);
+}
+
+template <BlendMode Mode>
+inline __m128i blendChannels(__m128i below, __m128i above) {
+  if constexpr (Mode == BlendMode::Multiply) {
+    return div255x8(_mm_mullo_epi16(below, above));
+  } else if constexpr (Mode == BlendMode::Screen) {
+    return _mm_sub_epi16(_mm_add_epi16(below, above), div255x8(_mm_mullo_epi16(below, above)));
+  } else if constexpr (Mode == BlendMode::Overlay) {
+    const __m128i max = _mm_set1_epi16(255);
+    const __m128i dark = div255x8(_mm_slli_epi16(_mm_mullo_epi16(below, above), 1));
+    const __m128i light = _mm_sub_epi16(max, div255x8(_mm_slli_epi16(
+      _mm_mullo_epi16(_mm_sub_epi16(max, below), _mm_sub_epi16(max, above)), 1)));
+    const __m128i isDark = _mm_cmplt_epi16(below, _mm_set1_epi16(128));
+    return _mm_or_si128(_mm_and_si128(isDark, dark), _mm_andnot_si128(isDark, light));
+  } else if constexpr (Mode == BlendMode::Darken) {
+    return _mm_min_epi16(below, above);
+  } else if constexpr (Mode == BlendMode::Lighten) {
+    return _mm_max_epi16(below, above);
+  } else if constexpr (Mode == BlendMode::Additive) {
+    return _mm_min_epi16(_mm_add_epi16(below, above), _mm_set1_epi16(255));
+  } else if constexpr (Mode == BlendMode::Erase) {
+    return below;
+  } else {
+    return above;
+  }
+}
+
+// 2 pixels as 16-bit B, G, R, A lanes; alpha is repeated across each pixel's lanes
+template <BlendMode Mode>
+inline __m128i blend2(__m128i below, __m128i above, __m128i alpha) {
+  const __m128i alphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+  const __m128i targetAlpha = Mode == BlendMode::Erase ? _mm_setzero_si128() : _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+  const __m128i blended = _mm_or_si128(_mm_andnot_si128(alphaLanes, blendChannels<Mode>(below, above)), targetAlpha);
+  const __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+  return div255x8(_mm_add_epi16(_mm_mullo_epi16(below, inverse), _mm_mullo_epi16(blended, alpha)));
+}
+
+// 4 pixels' worth of alpha (16-bit lanes 0-3) spread over their channels
+inline void spreadAlpha(__m128i alpha, __m128i& low, __m128i& high) {
+  const __m128i pairs = _mm_unpacklo_epi16(alpha, alpha);
+  low = _mm_unpacklo_epi32(pairs, pairs);
+  high = _mm_unpackhi_epi32(pairs, pairs);
+}
+#endif
+
+} // namespace
+
+bool parseBlendMode(std::string_view name, BlendMode& mode) {
+  static constexpr std::pair<std::string_view, BlendMode> kModes[] = {
+    {"normal", BlendMode::Normal},
+    {"multiply", BlendMode::Multiply},
+    {"screen", BlendMode::Screen},
+    {"overlay", BlendMode::Overlay},
+    {"darken", BlendMode::Darken},
+    {"lighten", BlendMode::Lighten},
+    {"additive", BlendMode::Additive},
+    {"erase", BlendMode::Erase},
+  };
+  for (const auto& [modeName, value] : kModes) {
+    if (name == modeName) {
+      mode = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+template <BlendMode Mode>
+void blendColorSpan(uint32_t* dst, uint32_t color, const uint8_t* coverage, int count) {
+  int i = 0;
+
+#if defined(GESTURE_CANVAS_NEON)
+  uint16x8_t above[3];
+  for (int c = 0; c < 3; ++c) {
+    above[c] = vdupq_n_u16((color >> (c * 8)) & 0xFF);
+  }
+  for (; i + 8 <= count; i += 8) {
+    const uint8x8_t alpha = vld1_u8(coverage + i);
+    if (vget_lane_u64(vreinterpret_u64_u8(alpha), 0) == 0) {
+      continue;
+    }
+    uint8x8x4_t pixels = vld4_u8(reinterpret_cast<const uint8_t*>(dst + i));
+    blend8<Mode>(pixels, above, vmovl_u8(alpha));
+    vst4_u8(reinterpret_cast<uint8_t*>(dst + i), pixels);
+  }
+#elif defined(GESTURE_CANVAS_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i above = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(color)), zero);
+  for (; i + 4 <= count; i += 4) {
+    int32_t alpha;
+    std::memcpy(&alpha, coverage + i, sizeof(alpha));
+    if (alpha == 0) {
+      continue;
+    }
+    __m128i alphaLow, alphaHigh;
+    spreadAlpha(_mm_unpacklo_epi8(_mm_cvtsi32_si128(alpha), zero), alphaLow, alphaHigh);
+    const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+    const __m128i low = blend2<Mode>(_mm_unpacklo_epi8(pixels, zero), above, alphaLow);
+    const __m128i high = blend2<Mode>(_mm_unpackhi_epi8(pixels, zero), above, alphaHigh);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(low, high));
+  }
+#endif
+
+  for (; i < count; ++i) {
+    if (coverage[i] != 0) {
+      dst[i] = blendPixel<Mode>(dst[i], color, coverage[i]);
+    }
+  }
+}
+
+template <BlendMode Mode>
+void blendLayerSpan(uint32_t* dst, const uint32_t* src, int count, uint8_t opacity) {
+  int i = 0;
+
+#if defined(GESTURE_CANVAS_NEON)
+  const uint8x8_t layerOpacity = vdup_n_u8(opacity);
+  for (; i + 8 <= count; i += 8) {
+    const uint8x8x4_t source = vld4_u8(reinterpret_cast<const uint8_t*>(src + i));
+    if (vget_lane_u64(vreinterpret_u64_u8(source.val[3]), 0) == 0) {
+      continue;
+    }
+    const uint16x8_t above[3] = {vmovl_u8(source.val[0]), vmovl_u8(source.val[1]), vmovl_u8(source.val[2])};
+    uint8x8x4_t pixels = vld4_u8(reinterpret_cast<const uint8_t*>(dst + i));
+    blend8<Mode>(pixels, above, div255x8(vmull_u8(source.val[3], layerOpacity)));
+    vst4_u8(reinterpret_cast<uint8_t*>(dst + i), pixels);
+  }
+#elif defined(GESTURE_CANVAS_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i layerOpacity = _mm_set1_epi16(opacity);
+  const __m128i alphaBytes = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+  for (; i + 4 <= count; i += 4) {
+    const __m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(source, alphaBytes), zero)) == 0xFFFF) {
+      continue;
+    }
+    const __m128i sourceLow = _mm_unpacklo_epi8(source, zero);
+    const __m128i sourceHigh = _mm_unpackhi_epi8(source, zero);
+    // Each pixel's alpha lane copied over its channels, then scaled
+    const __m128i alphaLow = div255x8(_mm_mullo_epi16(
+      _mm_shufflehi_epi16(_mm_shufflelo_epi16(sourceLow, 0xFF), 0xFF), layerOpacity));
+    const __m128i alphaHigh = div255x8(_mm_mullo_epi16(
+      _mm_shufflehi_epi16(_mm_shufflelo_epi16(sourceHigh, 0xFF), 0xFF), layerOpacity));
+    const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+    const __m128i low = blend2<Mode>(_mm_unpacklo_epi8(pixels, zero), sourceLow, alphaLow);
+    const __m128i high = blend2<Mode>(_mm_unpackhi_epi8(pixels, zero), sourceHigh, alphaHigh);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(low, high));
+  }
+#endif
+
+  for (; i < count; ++i) {
+    const uint32_t alpha = div255((src[i] >> 24) * opacity);
+    if (alpha != 0) {
+      dst[i] = blendPixel<Mode>(dst[i], src[i], alpha);
+    }
+  }
+}
+
+template void blendColorSpan<BlendMode::Normal>(uint32_t*, uint32_t, const uint8_t*, int);
+template void blendColorSpan<BlendMode::Multiply>(uint32_t*, uint32_t, const uint8_t*, int);
+template void blendColorSpan<BlendMode::Screen>(uint32_t*, uint32_t, const uint8_t*, int);
+template void blendColorSpan<BlendMode::Overlay>(uint32_t*, uint32_t, const uint8_t*, int);
+template void blendColorSpan<BlendMode::Darken>(uint32_t*, uint32_t, const uint8_t*, int);
+template void blendColorSpan<BlendMode::Lighten>(uint32_t*, uint32_t, const uint8_t*, int);
+template void blendColorSpan<BlendMode::Additive>(uint32_t*, uint32_t, const uint8_t*, int);
+template void blendColorSpan<BlendMode::Erase>(uint32_t*, uint32_t, const uint8_t*, int);
+
+template void blendLayerSpan<BlendMode::Normal>(uint32_t*, const uint32_t*, int, uint8_t);
+template void blendLayerSpan<BlendMode::Multiply>(uint32_t*, const uint32_t*, int, uint8_t);
+template void blendLayerSpan<BlendMode::Screen>(uint32_t*, const uint32_t*, int, uint8_t);
+template void blendLayerSpan<BlendMode::Overlay>(uint32_t*, const uint32_t*, int, uint8_t);
+template void blendLayerSpan<BlendMode::Darken>(uint32_t*, const uint32_t*, int, uint8_t);
+template void blendLayerSpan<BlendMode::Lighten>(uint32_t*, const uint32_t*, int, uint8_t);
+template void blendLayerSpan<BlendMode::Additive>(uint32_t*, const uint32_t*, int, uint8_t);
+template void blendLayerSpan<BlendMode::Erase>(uint32_t*, const uint32_t*, int, uint8_t);
+
+ColorSpanKernel colorSpanKernel(BlendMode mode) {
+  switch (mode) {
+    case BlendMode::Normal: return &blendColorSpan<BlendMode::Normal>;
+    case BlendMode::Multiply: return &blendColorSpan<BlendMode::Multiply>;
+    case BlendMode::Screen: return &blendColorSpan<BlendMode::Screen>;
+    case BlendMode::Overlay: return &blendColorSpan<BlendMode::Overlay>;
+    case BlendMode::Darken: return &blendColorSpan<BlendMode::Darken>;
+    case BlendMode::Lighten: return &blendColorSpan<BlendMode::Lighten>;
+    case BlendMode::Additive: return &blendColorSpan<BlendMode::Additive>;
+    case BlendMode::Erase: return &blendColorSpan<BlendMode::Erase>;
+  }
+  return &blendColorSpan<BlendMode::Normal>;
+}
+
+LayerSpanKernel layerSpanKernel(BlendMode mode) {
+  switch (mode) {
+    case BlendMode::Normal: return &blendLayerSpan<BlendMode::Normal>;
+    case BlendMode::Multiply: return &blendLayerSpan<BlendMode::Multiply>;
+    case BlendMode::Screen: return &blendLayerSpan<BlendMode::Screen>;
+    case BlendMode::Overlay: return &blendLayerSpan<BlendMode::Overlay>;
+    case BlendMode::Darken: return &blendLayerSpan<BlendMode::Darken>;
+    case BlendMode::Lighten: return &blendLayerSpan<BlendMode::Lighten>;
+    case BlendMode::Additive: return &blendLayerSpan<BlendMode::Additive>;
+    case BlendMode::Erase: return &blendLayerSpan<BlendMode::Erase>;
+  }
+  return &blendLayerSpan<BlendMode::Normal>;
+}
+
+} // namespace facebook::react
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+
+namespace facebook::react {
+
+// How colors combine with what is below them. Alpha always composites
+// source-over, except for Erase, which takes alpha away and leaves color.
+enum class BlendMode : uint8_t {
+  Normal,
+  Multiply,
+  Screen,
+  Overlay,
+  Darken,
+  Lighten,
+  Additive,
+  Erase,
+};
+
+bool parseBlendMode(std::string_view name, BlendMode& mode);
+
+// value / 255, rounded; exact for value up to 255 * 255
+inline uint32_t div255(uint32_t value) {
+  value += 128;
+  return (value + (value >> 8)) >> 8;
+}
+
+template <BlendMode Mode>
+inline uint32_t blendChannel(uint32_t below, uint32_t above) {
+  if constexpr (Mode == BlendMode::Multiply) {
+    return div255(below * above);
+  } else if constexpr (Mode == BlendMode::Screen) {
+    return below + above - div255(below * above);
+  } else if constexpr (Mode == BlendMode::Overlay) {
+    return below < 128 ? div255(2 * below * above) : 255 - div255(2 * (255 - below) * (255 - above));
+  } else if constexpr (Mode == BlendMode::Darken) {
+    return std::min(below, above);
+  } else if constexpr (Mode == BlendMode::Lighten) {
+    return std::max(below, above);
+  } else if constexpr (Mode == BlendMode::Additive) {
+    return std::min(below + above, 255u);
+  } else if constexpr (Mode == BlendMode::Erase) {
+    return below;
+  } else {
+    return above;
+  }
+}
+
+// One ARGB pixel: each color channel moves from below towards the blended
+// color by alpha / 255, all in 8-bit fixed point. Every span kernel below
+// produces exactly this, whichever SIMD path it takes.
+template <BlendMode Mode>
+inline uint32_t blendPixel(uint32_t below, uint32_t above, uint32_t alpha) {
+  uint32_t result = 0;
+  for (int shift = 0; shift < 24; shift += 8) {
+    const uint32_t channel = (below >> shift) & 0xFF;
+    const uint32_t blended = blendChannel<Mode>(channel, (above >> shift) & 0xFF);
+    result |= div255(channel * (255 - alpha) + blended * alpha) << shift;
+  }
+  const uint32_t targetAlpha = Mode == BlendMode::Erase ? 0 : 255;
+  return result | (div255((below >> 24) * (255 - alpha) + targetAlpha * alpha) << 24);
+}
+
+// Brush kernel: color over dst, pixel i weighted by coverage[i] (0-255)
+template <BlendMode Mode>
+void blendColorSpan(uint32_t* dst, uint32_t color, const uint8_t* coverage, int count);
+
+// Layer kernel: src over dst, each pixel weighted by its alpha times opacity
+template <BlendMode Mode>
+void blendLayerSpan(uint32_t* dst, const uint32_t* src, int count, uint8_t opacity);
+
+// The instantiation for a mode only known at run time, looked up once per span
+using ColorSpanKernel = void (*)(uint32_t* dst, uint32_t color, const uint8_t* coverage, int count);
+using LayerSpanKernel = void (*)(uint32_t* dst, const uint32_t* src, int count, uint8_t opacity);
+ColorSpanKernel colorSpanKernel(BlendMode mode);
+LayerSpanKernel layerSpanKernel(BlendMode mode);
+
+} // namespace facebook::react
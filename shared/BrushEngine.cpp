@@ -5,17 +5,16 @@ namespace facebook::react {
 
 BrushEngine::BrushEngine() 
     : size_(10.0), opacity_(1.0), color_(0xFF000000), 
-      texture_("normal"), dampening_(0.9), fluidResponse_(0.5),
+      texture_(BrushTexture::Normal), dampening_(0.9), fluidResponse_(0.5),
       velocityX_(0.0), velocityY_(0.0) {}
 
-void BrushEngine::configureBrush(double size, double opacity, uint32_t color, 
-                               const std::string& texture, double dampening, double fluidResponse) {
-  size_ = size;
-  opacity_ = opacity;
-  color_ = color;
-  texture_ = texture;
-  dampening_ = dampening;
-  fluidResponse_ = fluidResponse;
+void BrushEngine::configureBrush(const BrushStyleData& style) {
+  size_ = style.size;
+  opacity_ = style.opacity;
+  color_ = style.color;
+  texture_ = style.texture;
+  dampening_ = style.dampening;
+  fluidResponse_ = style.fluidResponse;
 }
 
 void BrushEngine::simulatePhysics(double accelX, double accelY, double accelZ) {
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <memory>
+#include "BrushTextureAtlas.h"
+#include "Canvas.h"
+#include "CanvasTypes.h"
+
+namespace facebook::react {
+
+// A brush style resolved once: parsed color and texture plus the falloff
+// table and atlas images (see BrushTextureAtlas.h) its tip rasterizes with. Immutable, so every stroke drawn with it
+// (on any thread) shares one instance and starting a stroke costs the same
+// whatever the style.
+class BrushPreset {
+public:
+  // Images current in BrushTextureAtlas::shared()
+  explicit BrushPreset(const BrushStyleData& style);
+  // Images given (a journal replay's own), either may be null
+  BrushPreset(const BrushStyleData& style, std::shared_ptr<const BrushImage> tip,
+              std::shared_ptr<const BrushImage> grain);
+
+  const BrushStyleData& style() const { return style_; }
+  const FalloffTable& falloff() const { return *falloff_; }
+  // Null when the texture has none
+  const BrushImage* tip() const { return tip_.get(); }
+  const BrushImage* grain() const { return grain_.get(); }
+  const std::shared_ptr<const BrushImage>& image(BrushImageKind kind) const {
+    return kind == BrushImageKind::Tip ? tip_ : grain_;
+  }
+
+private:
+  BrushStyleData style_;
+  const FalloffTable* falloff_;
+  std::shared_ptr<const BrushImage> tip_;
+  std::shared_ptr<const BrushImage> grain_;
+};
+
+} // namespace facebook::react
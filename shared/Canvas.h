@@ -1,31 +1,201 @@
 #pragma once
 
+#include <array>
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <memory>
+#include "CanvasTypes.h"
+#include "TileGrid.h"
+#include "CanvasDocument.h"
+#include "FloodFill.h"
+#include "FrameSink.h"
+#include "LayerStack.h"
+#include "MipPyramid.h"
+#include "Resampler.h"
+#include "UndoHistory.h"
+#include "WetPaint.h"
 
 namespace facebook::react {
 
+class BrushImage;
+
+// Half-open pixel rectangle [x0, x1) x [y0, y1)
+struct PixelRect {
+  int x0;
+  int y0;
+  int x1;
+  int y1;
+};
+
+// (1 - d/r)^exponent sampled over d/r in [0, 1], so the rasterizer does a
+// table lookup per pixel instead of a pow(). Exponent 0 is a hard tip: the
+// rasterizer gives it a one-pixel antialiased rim and fills what is inside.
+struct FalloffTable {
+  static constexpr int kSamples = 256;
+  
+  explicit FalloffTable(double exponent);
+  
+  float sample(double t) const {
+    const double position = t * kSamples;
+    const int index = static_cast<int>(position);
+    const float fraction = static_cast<float>(position - index);
+    return values[index] + (values[index + 1] - values[index]) * fraction;
+  }
+  
+  std::array<float, kSamples + 2> values; // Padded so t == 1 reads in bounds
+  bool hard;
+};
+
+// One brush segment with its per-segment randomness already drawn, so it
+// rasterizes identically however it is split up
+struct StrokeSegment {
+  double x1, y1, x2, y2;
+  double pressure;
+  double size;
+  uint32_t color;
+  double opacity;
+  BrushTexture texture;
+  double textureEffect = 1.0;
+  bool textureNoise = true; // Optional per-pixel grain; shed when a frame runs over budget
+  const FalloffTable* falloff = nullptr;
+  const BrushImage* tip = nullptr; // Replaces the falloff when set
+  const BrushImage* grain = nullptr;
+};
+
 class Canvas {
 public:
   Canvas(int width, int height, uint32_t backgroundColor);
+  // Opens a saved document; pixel tiles are decoded as they are first touched
+  explicit Canvas(const std::shared_ptr<CanvasDocument>& document);
   ~Canvas();
   
   void clear();
+  // New dimensions; all three drop undo history and keep the frame sink.
+  // resize keeps the pixels and fluid that still fit (top-left anchored,
+  // padded with background), resample filters them to the new size (see
+  // Resampler.h); both keep the layers. reset starts blank with one layer.
+  void resize(int width, int height);
+  void resample(int width, int height, ResampleMode mode, WorkerPool& workers);
+  void reset(int width, int height);
+  // Takes over the layers and history of a canvas of the same size drawn
+  // elsewhere (a redraw), keeping this one's frame sink, fluid and water.
+  // Every tile counts as written, so consumers pick the new pixels up.
+  void adopt(Canvas& redrawn);
   void applyStrokeLine(double x1, double y1, double x2, double y2, 
                       double pressure, double size, uint32_t color, 
-                      double opacity, const std::string& texture);
-  void applyPhysics(double accelX, double accelY, double accelZ);
+                      double opacity, BrushTexture texture);
+  
+  // applyStrokeLine in two steps so a segment can be rasterized tile by tile.
+  // Rasterizing different clips concurrently is safe when they cover
+  // different tiles. random in [0, 1) drives the segment's texture jitter.
+  // Segments draw into the active layer.
+  StrokeSegment prepareStrokeLine(double x1, double y1, double x2, double y2,
+                                  double pressure, double size, uint32_t color,
+                                  double opacity, BrushTexture texture,
+                                  const FalloffTable& falloff, double random) const;
+  PixelRect strokeLineBounds(const StrokeSegment& segment) const;
+  // Returns the number of pixels written
+  uint64_t rasterizeStrokeLine(const StrokeSegment& segment, const PixelRect& clip);
+  
+  // Paint bucket on the active layer (see FloodFill.h): pixels within
+  // tolerance of the one at (x, y) and connected to it become color.
+  // Returns the number of pixels filled.
+  uint64_t floodFill(int x, int y, uint32_t color, uint8_t tolerance, WorkerPool& workers);
+  
+  // Shared falloff curve for a texture; built once per process
+  static const FalloffTable& falloffFor(BrushTexture texture);
+  
+  int width() const { return width_; }
+  int height() const { return height_; }
+  uint32_t backgroundColor() const { return backgroundColor_; }
+  // Write counter of the composite (see TileGrid), which catches up with
+  // the layers when a frame is published or the pixels are read; safe to
+  // read from any thread
+  uint64_t generation() const { return layers_.compositeGeneration(); }
+  // Fluid velocities, two bytes per pixel in row order
+  const std::vector<uint8_t>& fluidLayer() const { return fluidLayer_; }
+  
+  // Returns the number of pixels moved; only the wet layer flows
+  uint64_t applyPhysics(double accelX, double accelY, double accelZ);
+  
+  // Watercolor strokes leave water behind (see WetPaint.h); each step lets
+  // it spread and dry on the wet layer. Returns the number of pixels
+  // stepped. Water isn't part of history or saved documents.
+  bool hasWetPaint() const { return wetPaint_.isWet(); }
+  uint64_t stepWetPaint() { return wetPaint_.step(layers_.planes(), layers_.top(wetLayer_)); }
+  void dryWetPaint() { wetPaint_.reset(width_, height_); }
+  
+  // Layers (see LayerStack.h). Strokes draw into the active layer and
+  // motion moves the wet one; both start out as the base layer. Layer
+  // changes aren't undoable. The setters return false for a layer that
+  // doesn't exist.
+  int layerCount() const { return layers_.count(); }
+  // Returns the new layer's index, or -1 when the stack is full
+  int addLayer() { return layers_.add(); }
+  bool setLayerProperties(int layer, const LayerProperties& properties);
+  bool setActiveLayer(int layer);
+  bool setWetLayer(int layer);
+  // Down to a single layer holding the composite, as a saved document has
+  void flattenLayers();
+  
+  // Everything drawn between beginHistoryStep and commitHistoryStep undoes
+  // as one step. undo/redo close a step left open (ending it at mark) and
+  // return false when there is nothing to apply. Marks are the caller's
+  // positions (see UndoHistory); undo/redo report the applied step's.
+  void beginHistoryStep(uint64_t mark, UndoHistory::StepKind kind = UndoHistory::StepKind::Edit) {
+    history_.begin(layers_.planes(), kind, mark);
+  }
+  void commitHistoryStep(uint64_t mark, UndoHistory::StepKind kind = UndoHistory::StepKind::Edit) {
+    history_.commit(layers_.planes(), kind, mark);
+  }
+  bool isRecordingHistory() const { return history_.isRecording(); }
+  bool undo(uint64_t mark, UndoHistory::Marks& applied);
+  bool redo(uint64_t mark, UndoHistory::Marks& applied);
+  void setHistoryBudget(size_t bytes) { history_.setBudget(bytes); }
+  // Empties the history, keeping its budget
+  void forgetHistory() { history_.reset(); }
+  // Back to an empty history with the default budget
+  void resetHistory() {
+    history_.reset();
+    history_.setBudget(UndoHistory::kDefaultBudgetBytes);
+  }
   std::string getSnapshotAsBase64();
   
+  // Cheap copy-on-write capture of the composite for off-thread encoding
+  TileGrid captureSnapshot();
+  
+  // Downscaled snapshot served from the nearest mip level at least maxWidth wide
+  std::string getThumbnailAsBase64(int maxWidth);
+  
+  // Brings the composite up to date and hands it to the frame sink if a
+  // platform view is attached
+  void publishFrame();
+  std::shared_ptr<FrameSink> frameSink() const { return frameSink_; }
+  
 private:
   int width_;
   int height_;
   uint32_t backgroundColor_;
-  std::vector<uint32_t> pixelData_;
+  LayerStack layers_;
+  int activeLayer_ = 0;
+  int wetLayer_ = 0;
   std::vector<uint8_t> fluidLayer_; 
-  std::string base64_encode(const std::vector<uint8_t>& input);
+  WetPaint wetPaint_;
+  FloodFill floodFill_;
+  
+  // Brings mip levels up to date with tiles written since the last refresh
+  void refreshMips();
+  void resetFluid(const std::vector<int>& tiles);
+  // Everything but the layers for new dimensions
+  void reshape(int width, int height);
+  MipPyramid mips_;
+  uint64_t mipsGeneration_;
+  
+  std::shared_ptr<FrameSink> frameSink_;
+  UndoHistory history_;
+  std::vector<int> restoredTiles_;
 
 };
 
-} 
\ No newline at end of file
+} 
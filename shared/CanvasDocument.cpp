@@ -0,0 +1,272 @@
+#include "CanvasDocument.h"
+#include <algorithm>
+#include <cstring>
+#include "CanvasJournal.h"
+#include "TileCodec.h"
+#include "WorkerPool.h"
+
+namespace facebook::react {
+
+namespace {
+
+constexpr uint16_t kHasJournal = 1;
+
+// Native byte order; every platform we ship on is little-endian
+template <typename T>
+void putRaw(std::vector<uint8_t>& out, size_t offset, T value) {
+  std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+template <typename T>
+T getRaw(const uint8_t* data, size_t offset) {
+  T value;
+  std::memcpy(&value, data + offset, sizeof(T));
+  return value;
+}
+
+// Pixel rectangle of tile index, clipped to the canvas
+struct TileRect {
+  int x0;
+  int y0;
+  int x1;
+  int y1;
+};
+
+TileRect tileRect(int index, int tilesX, int width, int height) {
+  const int x0 = (index % tilesX) * kTileSize;
+  const int y0 = (index / tilesX) * kTileSize;
+  return {x0, y0, std::min(x0 + kTileSize, width), std::min(y0 + kTileSize, height)};
+}
+
+bool inFile(uint64_t offset, uint64_t size, size_t fileSize) {
+  return offset <= fileSize && size <= fileSize - offset;
+}
+
+} // namespace
+
+bool CanvasDocument::write(const std::string& path, const DocumentCapture& capture,
+                           WorkerPool& workers, std::string& error) {
+  const TileGrid& pixels = capture.pixels;
+  const int tileCount = pixels.tileCount();
+  
+  // Tiles that share storage (e.g. everything still blank) are stored once
+  std::vector<int> blobOfTile(tileCount);
+  std::vector<int> firstTileOfBlob;
+  std::unordered_map<const PixelTile*, int> blobs;
+  for (int index = 0; index < tileCount; ++index) {
+    auto [entry, inserted] = blobs.try_emplace(pixels.tileRef(index).get(),
+                                               static_cast<int>(firstTileOfBlob.size()));
+    if (inserted) {
+      firstTileOfBlob.push_back(index);
+    }
+    blobOfTile[index] = entry->second;
+  }
+  
+  std::vector<std::vector<uint8_t>> pixelBlobs(firstTileOfBlob.size());
+  workers.parallelFor(static_cast<int>(pixelBlobs.size()), [&](int blob) {
+    compressTile(*pixels.tileRef(firstTileOfBlob[blob]), pixelBlobs[blob]);
+  });
+  
+  // Still fluid is all zeros, so only moving tiles are stored
+  const bool hasFluid = capture.fluid.size() == static_cast<size_t>(pixels.width()) * pixels.height() * 2;
+  std::vector<std::vector<uint8_t>> fluidBlobs(hasFluid ? tileCount : 0);
+  workers.parallelFor(static_cast<int>(fluidBlobs.size()), [&](int index) {
+    const TileRect rect = tileRect(index, pixels.tilesX(), pixels.width(), pixels.height());
+    const size_t rowBytes = static_cast<size_t>(rect.x1 - rect.x0) * 2;
+    std::vector<uint8_t> packed;
+    packed.reserve(rowBytes * (rect.y1 - rect.y0));
+    bool moving = false;
+    for (int y = rect.y0; y < rect.y1; ++y) {
+      const uint8_t* row = capture.fluid.data() + (static_cast<size_t>(y) * pixels.width() + rect.x0) * 2;
+      moving = moving || std::any_of(row, row + rowBytes, [](uint8_t value) { return value != 0; });
+      packed.insert(packed.end(), row, row + rowBytes);
+    }
+    if (moving) {
+      packBitsEncode(packed.data(), packed.size(), fluidBlobs[index]);
+    }
+  });
+  
+  // Layout: header, index, pixel blobs, fluid blobs, journal
+  std::vector<uint64_t> blobOffsets(pixelBlobs.size());
+  uint64_t offset = kHeaderSize + static_cast<uint64_t>(tileCount) * kIndexEntrySize;
+  for (size_t blob = 0; blob < pixelBlobs.size(); ++blob) {
+    blobOffsets[blob] = offset;
+    offset += pixelBlobs[blob].size();
+  }
+  std::vector<uint64_t> fluidOffsets(fluidBlobs.size());
+  for (size_t index = 0; index < fluidBlobs.size(); ++index) {
+    fluidOffsets[index] = offset;
+    offset += fluidBlobs[index].size();
+  }
+  const uint64_t journalOffset = offset;
+  offset += capture.journal.size();
+  
+  std::vector<uint8_t> out(offset);
+  putRaw(out, 0, kMagic);
+  putRaw(out, 4, kVersion);
+  putRaw(out, 6, static_cast<uint16_t>(capture.journal.empty() ? 0 : kHasJournal));
+  putRaw(out, 8, static_cast<uint32_t>(pixels.width()));
+  putRaw(out, 12, static_cast<uint32_t>(pixels.height()));
+  putRaw(out, 16, capture.backgroundColor);
+  putRaw(out, 20, static_cast<uint32_t>(tileCount));
+  putRaw(out, 24, capture.nextStrokeSerial);
+  putRaw(out, 28, uint32_t{0});
+  putRaw(out, 32, journalOffset);
+  putRaw(out, 40, static_cast<uint64_t>(capture.journal.size()));
+  
+  for (int index = 0; index < tileCount; ++index) {
+    const size_t entry = kHeaderSize + static_cast<size_t>(index) * kIndexEntrySize;
+    const int blob = blobOfTile[index];
+    const bool moving = hasFluid && !fluidBlobs[index].empty();
+    putRaw(out, entry, blobOffsets[blob]);
+    putRaw(out, entry + 8, moving ? fluidOffsets[index] : uint64_t{0});
+    putRaw(out, entry + 16, static_cast<uint32_t>(pixelBlobs[blob].size()));
+    putRaw(out, entry + 20, static_cast<uint32_t>(moving ? fluidBlobs[index].size() : 0));
+  }
+  for (size_t blob = 0; blob < pixelBlobs.size(); ++blob) {
+    std::copy(pixelBlobs[blob].begin(), pixelBlobs[blob].end(), out.begin() + blobOffsets[blob]);
+  }
+  for (size_t index = 0; index < fluidBlobs.size(); ++index) {
+    std::copy(fluidBlobs[index].begin(), fluidBlobs[index].end(), out.begin() + fluidOffsets[index]);
+  }
+  std::copy(capture.journal.begin(), capture.journal.end(), out.begin() + journalOffset);
+  
+  return writeFileAtomically(path, out.data(), out.size(), error);
+}
+
+CanvasDocument::CanvasDocument(std::shared_ptr<MappedFile> file, int width, int height,
+                               uint32_t backgroundColor, std::vector<TileEntry> entries)
+    : file_(std::move(file)), width_(width), height_(height),
+      tilesX_((width + kTileSize - 1) / kTileSize), backgroundColor_(backgroundColor),
+      entries_(std::move(entries)) {}
+
+std::shared_ptr<CanvasDocument> CanvasDocument::open(const std::string& path, std::string& error) {
+  auto file = MappedFile::open(path, error);
+  if (!file) {
+    return nullptr;
+  }
+  
+  const uint8_t* data = file->data();
+  const size_t size = file->size();
+  if (size < kHeaderSize || getRaw<uint32_t>(data, 0) != kMagic) {
+    error = "Not a canvas document: " + path;
+    return nullptr;
+  }
+  if (getRaw<uint16_t>(data, 4) != kVersion) {
+    error = "Unsupported canvas document version in " + path;
+    return nullptr;
+  }
+  
+  const uint16_t flags = getRaw<uint16_t>(data, 6);
+  const uint32_t width = getRaw<uint32_t>(data, 8);
+  const uint32_t height = getRaw<uint32_t>(data, 12);
+  const uint32_t tileCount = getRaw<uint32_t>(data, 20);
+  const uint64_t journalOffset = getRaw<uint64_t>(data, 32);
+  uint64_t journalSize = (flags & kHasJournal) ? getRaw<uint64_t>(data, 40) : 0;
+  
+  // Bounds what a damaged header can make us allocate; the index must match the size
+  constexpr uint32_t kMaxDimension = 1 << 15;
+  const uint64_t tilesX = (width + kTileSize - 1) / kTileSize;
+  const uint64_t tilesY = (height + kTileSize - 1) / kTileSize;
+  if (width == 0 || height == 0 || width > kMaxDimension || height > kMaxDimension ||
+      tileCount != tilesX * tilesY ||
+      !inFile(kHeaderSize, static_cast<uint64_t>(tileCount) * kIndexEntrySize, size) ||
+      !inFile(journalOffset, journalSize, size)) {
+    error = "Corrupt canvas document: " + path;
+    return nullptr;
+  }
+  
+  std::vector<TileEntry> entries(tileCount);
+  for (uint32_t index = 0; index < tileCount; ++index) {
+    const size_t entryOffset = kHeaderSize + static_cast<size_t>(index) * kIndexEntrySize;
+    TileEntry& entry = entries[index];
+    entry.pixelOffset = getRaw<uint64_t>(data, entryOffset);
+    entry.fluidOffset = getRaw<uint64_t>(data, entryOffset + 8);
+    entry.pixelSize = getRaw<uint32_t>(data, entryOffset + 16);
+    entry.fluidSize = getRaw<uint32_t>(data, entryOffset + 20);
+    if (!inFile(entry.pixelOffset, entry.pixelSize, size) || !inFile(entry.fluidOffset, entry.fluidSize, size)) {
+      error = "Corrupt canvas document: " + path;
+      return nullptr;
+    }
+  }
+  
+  if (journalSize > 0) {
+    JournalReader reader(data + journalOffset, journalSize);
+    JournalHeader header;
+    if (!reader.readHeader(header) && reader.unsupportedVersion()) {
+      // Would replay into different pixels; the tiles are still good, so
+      // open without it, as if it had been saved without a journal
+      journalSize = 0;
+    } else if (reader.failed() || header.width != static_cast<int>(width) ||
+               header.height != static_cast<int>(height)) {
+      error = "Corrupt canvas journal in " + path;
+      return nullptr;
+    }
+  }
+  
+  auto document = std::make_shared<CanvasDocument>(std::move(file), static_cast<int>(width),
+                                                   static_cast<int>(height), getRaw<uint32_t>(data, 16),
+                                                   std::move(entries));
+  document->nextStrokeSerial_ = getRaw<uint32_t>(data, 24);
+  document->journalOffset_ = journalOffset;
+  document->journalSize_ = journalSize;
+  return document;
+}
+
+std::vector<uint8_t> CanvasDocument::journal() const {
+  const uint8_t* begin = file_->data() + journalOffset_;
+  return std::vector<uint8_t>(begin, begin + journalSize_);
+}
+
+std::shared_ptr<PixelTile> CanvasDocument::loadTile(int index) {
+  const TileEntry& entry = entries_[index];
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = decoded_.find(entry.pixelOffset);
+    if (found != decoded_.end()) {
+      if (auto tile = found->second.lock()) {
+        return tile;
+      }
+    }
+  }
+  
+  // Decoded outside the lock so workers touching different tiles don't wait
+  // on each other; a tile that fails to decode comes back as background
+  auto tile = std::make_shared<PixelTile>();
+  if (entry.pixelSize == 0 || !decompressTile(file_->data() + entry.pixelOffset, entry.pixelSize, *tile)) {
+    tile->pixels.fill(backgroundColor_);
+  }
+  tile->cached = true;
+  
+  // Another thread may have decoded the same tile meanwhile; keep one
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::weak_ptr<PixelTile>& slot = decoded_[entry.pixelOffset];
+  if (auto existing = slot.lock()) {
+    return existing;
+  }
+  slot = tile;
+  return tile;
+}
+
+void CanvasDocument::unpackFluid(std::vector<uint8_t>& fluid) const {
+  std::vector<uint8_t> packed(kTilePixels * 2);
+  for (size_t index = 0; index < entries_.size(); ++index) {
+    const TileEntry& entry = entries_[index];
+    if (entry.fluidSize == 0) {
+      continue;
+    }
+  
+    const TileRect rect = tileRect(static_cast<int>(index), tilesX_, width_, height_);
+    const size_t rowBytes = static_cast<size_t>(rect.x1 - rect.x0) * 2;
+    if (!packBitsDecode(file_->data() + entry.fluidOffset, entry.fluidSize,
+                        packed.data(), rowBytes * (rect.y1 - rect.y0))) {
+      continue;
+    }
+    for (int y = rect.y0; y < rect.y1; ++y) {
+      std::copy_n(packed.data() + (y - rect.y0) * rowBytes, rowBytes,
+                  fluid.begin() + (static_cast<size_t>(y) * width_ + rect.x0) * 2);
+    }
+  }
+}
+
+} // namespace facebook::react
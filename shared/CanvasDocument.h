@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "FileIO.h"
+#include "TileGrid.h"
+
+namespace facebook::react {
+
+class WorkerPool;
+
+// Everything a document holds, captured on the render thread and written
+// out on a worker
+struct DocumentCapture {
+  TileGrid pixels;
+  uint32_t backgroundColor = 0;
+  std::vector<uint8_t> fluid; // Two bytes per pixel in row order
+  std::vector<uint8_t> journal; // Empty to save without one
+  uint32_t nextStrokeSerial = 0;
+};
+
+// Native canvas document: a fixed header, an index with one entry per tile,
+// then each distinct tile compressed with TileCodec, the non-zero fluid
+// tiles PackBits coded, and optionally the canvas journal.
+//
+// Opening maps the file and only validates the index; a tile is decoded the
+// first time something touches it, so a document of any size is ready to
+// draw on straight away.
+class CanvasDocument {
+public:
+  static constexpr uint32_t kMagic = 0x31444347; // "GCD1"
+  static constexpr uint16_t kVersion = 1;
+  static constexpr size_t kHeaderSize = 48;
+  static constexpr size_t kIndexEntrySize = 24;
+
+  // Where a tile's compressed pixels and fluid sit in the file; a size of 0
+  // means background pixels or still fluid
+  struct TileEntry {
+    uint64_t pixelOffset;
+    uint64_t fluidOffset;
+    uint32_t pixelSize;
+    uint32_t fluidSize;
+  };
+
+  // Document over tiles laid out some other way (e.g. an autosave file).
+  // Entries must lie within the file.
+  CanvasDocument(std::shared_ptr<MappedFile> file, int width, int height,
+                 uint32_t backgroundColor, std::vector<TileEntry> entries);
+
+  // Compresses tiles on workers; tiles shared copy-on-write are stored once
+  static bool write(const std::string& path, const DocumentCapture& capture,
+                    WorkerPool& workers, std::string& error);
+  static std::shared_ptr<CanvasDocument> open(const std::string& path, std::string& error);
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  uint32_t backgroundColor() const { return backgroundColor_; }
+  uint32_t nextStrokeSerial() const { return nextStrokeSerial_; }
+  bool hasJournal() const { return journalSize_ > 0; }
+  std::vector<uint8_t> journal() const;
+
+  // Thread-safe. Decodes on first request; tiles stored once come back as
+  // one shared tile, which detaches on the first write like any other.
+  std::shared_ptr<PixelTile> loadTile(int index);
+
+  // Fluid is sparse, so it is unpacked up front into a zeroed layer
+  void unpackFluid(std::vector<uint8_t>& fluid) const;
+
+private:
+  std::shared_ptr<MappedFile> file_;
+  int width_ = 0;
+  int height_ = 0;
+  int tilesX_ = 0;
+  uint32_t backgroundColor_ = 0;
+  uint32_t nextStrokeSerial_ = 0;
+  uint64_t journalOffset_ = 0;
+  uint64_t journalSize_ = 0;
+  std::vector<TileEntry> entries_;
+
+  // Decoded tiles by file offset, held only while some grid still uses them;
+  // an expired tile is decoded again. They are marked cached, so grids copy
+  // them before writing and every grid still waiting on a tile gets the
+  // original, not an edited copy.
+  std::mutex mutex_;
+  std::unordered_map<uint64_t, std::weak_ptr<PixelTile>> decoded_;
+};
+
+} // namespace facebook::react
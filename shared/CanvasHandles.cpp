@@ -0,0 +1,203 @@
+#include "CanvasHandles.h"
+#include "NativeGestureCanvas.h"
+
+namespace facebook::react {
+
+namespace {
+
+// Functions are created on access and capture a strong reference to their
+// handle, so a method detached from its object stays valid.
+template <typename Body>
+jsi::Value makeMethod(jsi::Runtime& rt, const jsi::PropNameID& name, unsigned int argCount, Body body) {
+  return jsi::Function::createFromHostFunction(rt, name, argCount, std::move(body));
+}
+
+jsi::Object objectArg(jsi::Runtime& rt, const jsi::Value* args, size_t count, size_t index, const char* what) {
+  if (index >= count || !args[index].isObject()) {
+    throw jsi::JSError(rt, std::string("Expected ") + what + " as argument " + std::to_string(index + 1));
+  }
+  return args[index].getObject(rt);
+}
+
+double numberArg(const jsi::Value* args, size_t count, size_t index) {
+  return index < count && args[index].isNumber() ? args[index].getNumber() : 0.0;
+}
+
+std::vector<jsi::PropNameID> propNames(jsi::Runtime& rt, std::initializer_list<const char*> names) {
+  std::vector<jsi::PropNameID> result;
+  for (const char* name : names) {
+    result.push_back(jsi::PropNameID::forAscii(rt, name));
+  }
+  return result;
+}
+
+} // namespace
+
+CanvasHandle::CanvasHandle(std::weak_ptr<NativeGestureCanvas> module, std::shared_ptr<CanvasSession> session)
+    : module_(std::move(module)), session_(std::move(session)), canvasId_(session_->id()) {}
+
+jsi::Value CanvasHandle::get(jsi::Runtime& rt, const jsi::PropNameID& name) {
+  const std::string property = name.utf8(rt);
+  auto self = shared_from_this();
+  
+  if (property == "id") {
+    return jsi::Value(canvasId_);
+  }
+  
+  if (property == "beginStroke") {
+    return makeMethod(rt, name, 2, [self](jsi::Runtime& rt, const jsi::Value&, const jsi::Value* args, size_t count) -> jsi::Value {
+      auto module = self->module_.lock();
+      if (!module || !self->session_) {
+        return jsi::Value::null();
+      }
+      auto point = objectArg(rt, args, count, 0, "a point");
+      auto brushStyle = objectArg(rt, args, count, 1, "a brush style");
+      
+      int strokeId;
+      auto stroke = module->startStroke(rt, self->session_, strokeId, point, brushStyle);
+      auto handle = std::make_shared<StrokeHandle>(self->module_, self->session_, std::move(stroke), strokeId);
+      return jsi::Object::createFromHostObject(rt, std::move(handle));
+    });
+  }
+  
+  auto commandMethod = [&](RenderCommandType type) -> jsi::Value {
+    return makeMethod(rt, name, 0, [self, type](jsi::Runtime&, const jsi::Value&, const jsi::Value*, size_t) -> jsi::Value {
+      auto module = self->module_.lock();
+      if (module && self->session_) {
+        module->submit(self->session_, type, RenderCommand());
+      }
+      return jsi::Value::undefined();
+    });
+  };
+  
+  if (property == "clear") {
+    return commandMethod(RenderCommandType::Clear);
+  }
+  if (property == "undo") {
+    return commandMethod(RenderCommandType::Undo);
+  }
+  if (property == "redo") {
+    return commandMethod(RenderCommandType::Redo);
+  }
+  
+  if (property == "applyMotion") {
+    return makeMethod(rt, name, 3, [self](jsi::Runtime&, const jsi::Value&, const jsi::Value* args, size_t count) -> jsi::Value {
+      auto module = self->module_.lock();
+      if (module && self->session_) {
+        RenderCommand command;
+        for (size_t i = 0; i < 3; ++i) {
+          command.acceleration[i] = numberArg(args, count, i);
+        }
+        module->submit(self->session_, RenderCommandType::ApplyMotion, std::move(command));
+      }
+      return jsi::Value::undefined();
+    });
+  }
+  
+  if (property == "setSize") {
+    return makeMethod(rt, name, 3, [self](jsi::Runtime&, const jsi::Value&, const jsi::Value* args, size_t count) -> jsi::Value {
+      auto module = self->module_.lock();
+      if (module && self->session_) {
+        const double scale = count > 2 && args[2].isNumber() ? args[2].getNumber() : 1.0;
+        module->submit(self->session_, RenderCommandType::Resize,
+                       NativeGestureCanvas::makeResizeCommand(numberArg(args, count, 0), numberArg(args, count, 1), scale));
+      }
+      return jsi::Value::undefined();
+    });
+  }
+  
+  if (property == "getSnapshot") {
+    return makeMethod(rt, name, 0, [self](jsi::Runtime& rt, const jsi::Value&, const jsi::Value*, size_t) -> jsi::Value {
+      auto module = self->module_.lock();
+      if (!module || !self->session_) {
+        return jsi::String::createFromUtf8(rt, "");
+      }
+      module->flushRendering();
+      return jsi::String::createFromUtf8(rt, self->session_->snapshotAsBase64());
+    });
+  }
+  
+  if (property == "dispose") {
+    return makeMethod(rt, name, 0, [self](jsi::Runtime&, const jsi::Value&, const jsi::Value*, size_t) -> jsi::Value {
+      // Queued commands keep the session alive until they have run
+      self->session_.reset();
+      return jsi::Value::undefined();
+    });
+  }
+  
+  return jsi::Value::undefined();
+}
+
+std::vector<jsi::PropNameID> CanvasHandle::getPropertyNames(jsi::Runtime& rt) {
+  return propNames(rt, {"id", "beginStroke", "clear", "undo", "redo", "applyMotion", "setSize", "getSnapshot", "dispose"});
+}
+
+StrokeHandle::StrokeHandle(
+  std::weak_ptr<NativeGestureCanvas> module,
+  std::weak_ptr<CanvasSession> session,
+  std::shared_ptr<Stroke> stroke,
+  int strokeId
+) : module_(std::move(module)), session_(std::move(session)), stroke_(std::move(stroke)), strokeId_(strokeId) {}
+
+void StrokeHandle::submitPoint(jsi::Runtime& rt, RenderCommandType type, const jsi::Value* args, size_t count) {
+  auto module = module_.lock();
+  auto session = session_.lock();
+  if (!module || !session) {
+    return;
+  }
+  
+  RenderCommand command;
+  command.strokeId = strokeId_;
+  command.stroke = stroke_;
+  command.point = module->extractPointData(rt, objectArg(rt, args, count, 0, "a point"));
+  module->submit(std::move(session), type, std::move(command));
+}
+
+jsi::Value StrokeHandle::get(jsi::Runtime& rt, const jsi::PropNameID& name) {
+  const std::string property = name.utf8(rt);
+  auto self = shared_from_this();
+  
+  if (property == "id") {
+    return jsi::Value(strokeId_);
+  }
+  
+  if (property == "addPoint") {
+    return makeMethod(rt, name, 1, [self](jsi::Runtime& rt, const jsi::Value&, const jsi::Value* args, size_t count) -> jsi::Value {
+      self->submitPoint(rt, RenderCommandType::AddPoint, args, count);
+      return jsi::Value::undefined();
+    });
+  }
+  
+  if (property == "end") {
+    return makeMethod(rt, name, 1, [self](jsi::Runtime& rt, const jsi::Value&, const jsi::Value* args, size_t count) -> jsi::Value {
+      self->submitPoint(rt, RenderCommandType::EndStroke, args, count);
+      self->session_.reset();
+      return jsi::Value::undefined();
+    });
+  }
+  
+  if (property == "dispose") {
+    return makeMethod(rt, name, 0, [self](jsi::Runtime&, const jsi::Value&, const jsi::Value*, size_t) -> jsi::Value {
+      auto module = self->module_.lock();
+      auto session = self->session_.lock();
+      if (module && session) {
+        RenderCommand command;
+        command.strokeId = self->strokeId_;
+        command.stroke = self->stroke_;
+        module->submit(std::move(session), RenderCommandType::CancelStroke, std::move(command));
+      }
+      self->session_.reset();
+      return jsi::Value::undefined();
+    });
+  }
+  
+  return jsi::Value::undefined();
+}
+
+std::vector<jsi::PropNameID> StrokeHandle::getPropertyNames(jsi::Runtime& rt) {
+  return propNames(rt, {"id", "addPoint", "end", "dispose"});
+}
+
+BrushStyleHandle::BrushStyleHandle(std::shared_ptr<const BrushPreset> preset) : preset_(std::move(preset)) {}
+
+} // namespace facebook::react
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "BrushTextureAtlas.h"
+#include "CanvasTypes.h"
+#include "CommandQueue.h"
+#include "UndoHistory.h"
+
+namespace facebook::react {
+
+class BrushPreset;
+class Stroke;
+
+// Append-only binary log of everything that changed a canvas: strokes with
+// their brush, motion events, clears, fills, history moves and layer changes. Points are quantized
+// (1/16 px, 1/1024 pressure, 1 ms) and delta coded against the stroke's
+// previous point as varints, so a typical point takes 4-6 bytes. Brush tip
+// and grain images are written whole the first time a stroke uses them and
+// referenced by id after that.
+//
+// Quantization is applied to live input before it is drawn and stroke
+// randomness comes from a per-stroke seed, so replaying a journal through a
+// fresh session redraws the canvas bit for bit. The journal doubles as the
+// canvas's vector model: a resize redraws what of it is still on the canvas
+// (see JournalModelReader) at the new size and scale.
+class CanvasJournal {
+public:
+  static constexpr uint32_t kMagic = 0x314a4347; // "GCJ1"
+  // Bumped whenever the same records would replay into different pixels
+  // (new ops, changed brush output). Readers refuse other versions rather
+  // than redraw a canvas wrong. 2: blend kernels, atlas tips and grain with
+  // their images journaled, wet layers and wet steps. 3: undo and redo
+  // record the step they applied.
+  static constexpr uint16_t kVersion = 3;
+  static constexpr size_t kHeaderSize = 20;
+  static constexpr double kPositionScale = 16.0;
+  static constexpr double kPressureScale = 1024.0;
+
+  CanvasJournal(int width, int height, uint32_t backgroundColor);
+  // Continues a journal read back from a document; bytes must start with a valid header
+  explicit CanvasJournal(std::vector<uint8_t> bytes) : bytes_(std::move(bytes)) {}
+
+  static PointData quantize(const PointData& point);
+  static double quantizeAcceleration(double value) { return static_cast<float>(value); }
+
+  void beginStroke(uint32_t serial, const BrushPreset& brush, const PointData& point);
+  // Returns the record's offset so its texture flag can be set afterwards
+  size_t addPoint(uint32_t serial, const PointData& previous, const PointData& point);
+  void markTextureShed(size_t record);
+  void endStroke(uint32_t serial, const PointData& previous, const PointData& point);
+  void cancelStroke(uint32_t serial);
+  void motion(const double acceleration[3]);
+  void clear();
+  void fill(const PointData& point, uint32_t color, uint8_t tolerance);
+  // With the journal offsets the applied step began and ended at; empty
+  // marks when there was nothing to apply
+  void undo(const UndoHistory::Marks& applied);
+  void redo(const UndoHistory::Marks& applied);
+  void historyBudget(size_t bytes);
+  // The canvas was saved and reopened here
+  void documentOpened();
+  // Canvas resized; points after this are in pixels of the new scale
+  void resize(int width, int height, double scale);
+  // Pixels cropped or filtered to a new size. From here on the canvas is no
+  // longer just its strokes, which the header records (see resampled()).
+  void resample(int width, int height, ResampleMode mode);
+  bool resampled() const;
+  void addLayer();
+  void layerProperties(int layer, const LayerProperties& properties);
+  void activeLayer(int layer);
+  void wetLayer(int layer);
+  void wetStep();
+
+  const std::vector<uint8_t>& bytes() const { return bytes_; }
+
+private:
+  void writeVarint(uint64_t value);
+  void writeSigned(int64_t value);
+  void writePointDelta(const PointData& previous, const PointData& point);
+  template <typename T> void writeRaw(T value);
+  void writeStep(const UndoHistory::Marks& applied);
+  // Id of an image, writing it first if this journal has not yet; 0 for null
+  uint32_t imageId(const std::shared_ptr<const BrushImage>& image);
+
+  std::vector<uint8_t> bytes_;
+  // Images written so far, held so their addresses stay unique
+  std::unordered_map<const BrushImage*, uint32_t> imageIds_;
+  std::vector<std::shared_ptr<const BrushImage>> images_;
+};
+
+struct JournalHeader {
+  int width = 0;
+  int height = 0;
+  uint32_t backgroundColor = 0;
+};
+
+// Decodes a journal back into the render commands that produced it, ready
+// to be applied to a session created from the header.
+class JournalReader {
+public:
+  JournalReader(const uint8_t* data, size_t size);
+
+  bool readHeader(JournalHeader& header);
+  // False at the end of the journal or on a malformed record (see failed())
+  bool next(RenderCommand& command);
+  bool failed() const { return failed_; }
+  // readHeader failed on a journal written by another version
+  bool unsupportedVersion() const { return unsupportedVersion_; }
+  // Where the next record starts
+  size_t offset() const { return offset_; }
+  // Carries on over a longer copy of the same journal, from where it was
+  void extend(const uint8_t* data, size_t size);
+
+private:
+  bool readVarint(uint64_t& value);
+  bool readSigned(int64_t& value);
+  bool readPointDelta(const PointData& previous, PointData& point);
+  bool readImageRecord();
+  // An image id of a stroke record; null for 0, false if not yet defined
+  bool readImage(BrushImageKind kind, std::shared_ptr<const BrushImage>& image);
+  template <typename T> bool readRaw(T& value);
+
+  struct ReplayStroke {
+    std::shared_ptr<Stroke> stroke;
+    PointData last;
+  };
+
+  const uint8_t* data_;
+  size_t size_;
+  size_t offset_ = 0;
+  bool failed_ = false;
+  bool unsupportedVersion_ = false;
+  std::unordered_map<uint32_t, ReplayStroke> strokes_;
+  std::unordered_map<uint32_t, std::shared_ptr<const BrushImage>> images_;
+};
+
+// Reads a journal as the canvas it leaves: strokes, fills and clears that
+// undo took back (and redo didn't return) or that a later clear wiped are
+// skipped, and so are motion, wet steps and history moves, so a redraw
+// rasterizes only the strokes and fills still on the canvas. Layer changes,
+// reopens and resizes all stay. A stroke only counts as undone when all of
+// it was.
+class JournalModelReader {
+public:
+  // Scans the whole journal once up front
+  JournalModelReader(const uint8_t* data, size_t size);
+
+  bool readHeader(JournalHeader& header) { return reader_.readHeader(header); }
+  bool next(RenderCommand& command);
+  bool failed() const { return failed_ || reader_.failed(); }
+
+private:
+  // Whether the record at offset lies inside a step that stayed undone;
+  // end is where its stroke ended
+  bool undone(size_t offset, size_t end) const;
+
+  JournalReader reader_;
+  std::vector<UndoHistory::Marks> undone_; // Sorted by begin
+  std::unordered_map<size_t, size_t> strokeEnds_; // BeginStroke offset -> its end
+  std::unordered_map<int, bool> keptStrokes_; // Open strokes by serial
+  size_t lastClear_ = 0;
+  bool failed_ = false;
+};
+
+} // namespace facebook::react
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+namespace facebook::react {
+
+// Native mirrors of the Point / BrushStyle shapes in specs/NativeGestureCanvas.ts.
+// Filled once at the JSI boundary; everything past it works on these.
+
+struct PointData {
+  double x = 0.0;
+  double y = 0.0;
+  double pressure = 1.0;
+  double timestamp = 0.0;
+};
+
+enum class BrushTexture : uint8_t {
+  Normal,
+  Chalk,
+  Watercolor,
+  Eraser,
+};
+
+struct BrushStyleData {
+  double size = 10.0;
+  double opacity = 1.0;
+  uint32_t color = 0xFF000000;  // ARGB
+  BrushTexture texture = BrushTexture::Normal;
+  double dampening = 0.9;
+  double fluidResponse = 0.5;
+};
+
+} // namespace facebook::react
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "CanvasDocument.h"
+#include "CanvasTypes.h"
+#include "LayerStack.h"
+#include "Resampler.h"
+#include "TileGrid.h"
+
+namespace facebook::react {
+
+class CanvasSession;
+class Stroke;
+
+enum class RenderCommandType : uint8_t {
+  BeginStroke,
+  AddPoint,
+  EndStroke,
+  CancelStroke, // Drops a stroke without a final point
+  ApplyMotion,
+  Clear,
+  Fill, // Paint-bucket fill from point (see FloodFill.h)
+  Undo,
+  Redo,
+  SetHistoryBudget,
+  Resize, // Re-rasterizes the canvas at a new size and scale
+  Resample, // Crops or filters the pixels to a new size
+  AddLayer,
+  SetLayerProperties,
+  SetActiveLayer, // Layer strokes draw into
+  SetWetLayer, // Layer motion moves
+  WetStep, // Spreads and dries wet watercolor by one step (see WetPaint.h)
+  DocumentOpened, // Journal replay only: drops strokes in flight and history
+  Capture, // Hands a copy-on-write capture of the pixels to `onCapture`
+  CaptureJournal, // Hands a copy of the canvas journal to `onJournal`
+  CaptureDocument, // Hands pixels, fluid and journal to `onDocument`
+  Stop,
+};
+
+// Bounds for Resize and Resample commands, wherever they come from
+constexpr int kMaxCanvasDimension = 1 << 15;
+constexpr double kMaxCanvasScale = 64.0;
+
+struct RenderCommand {
+  RenderCommandType type = RenderCommandType::Capture;
+  std::shared_ptr<CanvasSession> session;
+  int strokeId = 0;
+  std::shared_ptr<Stroke> stroke; // Set when the producer already holds the stroke
+  PointData point;
+  double acceleration[3] = {0.0, 0.0, 0.0};
+  bool textureShed = false; // Draw this point without texture noise (journal replay)
+  size_t historyBudget = 0;
+  int width = 0; // Resize and Resample
+  int height = 0;
+  double scale = 1.0;
+  ResampleMode resampleMode = ResampleMode::Crop;
+  int layer = 0; // Layer commands
+  uint32_t color = 0; // Fill
+  uint8_t tolerance = 0;
+  LayerProperties layerProperties;
+  uint64_t stepBegin = 0; // Undo and Redo read back from a journal: the journal
+  uint64_t stepEnd = 0;   // offsets of the step they applied, empty if none
+  std::function<void(TileGrid)> onCapture;
+  std::function<void(std::vector<uint8_t>)> onJournal;
+  std::function<void(DocumentCapture)> onDocument;
+  uint64_t submittedAt = 0; // PerfStats::now() when queued
+};
+
+// Bounded single-producer/single-consumer ring. The producer only writes
+// head_ and the consumer only writes tail_, so neither side takes a lock.
+template <typename T, size_t Capacity>
+class SpscQueue {
+  static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+  bool tryPush(T&& item) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == Capacity) {
+      return false;
+    }
+    slots_[head & (Capacity - 1)] = std::move(item);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool tryPop(T& out) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    out = std::move(slots_[tail & (Capacity - 1)]);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  // Separate cache lines so producer and consumer don't false-share
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+  std::array<T, Capacity> slots_;
+};
+
+} // namespace facebook::react
@@ -0,0 +1,150 @@
+#include "FileIO.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace facebook::react {
+
+bool writeAll(int fd, const uint8_t* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = ::write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+bool syncToDisk(int fd) {
+#if defined(F_FULLFSYNC)
+  if (::fcntl(fd, F_FULLFSYNC) == 0) {
+    return true;
+  }
+  // Not supported by every file system; fall back to a plain fsync
+#endif
+  return ::fsync(fd) == 0;
+}
+
+namespace {
+
+// Makes a rename in path's directory durable
+bool syncParentDirectory(const std::string& path) {
+  const size_t slash = path.rfind('/');
+  const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+  int fd = ::open(directory.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  const bool ok = syncToDisk(fd);
+  ::close(fd);
+  return ok;
+}
+
+} // namespace
+
+bool writeFileAtomically(const std::string& path, const uint8_t* data, size_t size, std::string& error) {
+  const std::string tempPath = path + ".tmp";
+  int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    error = "Cannot open " + tempPath + ": " + std::strerror(errno);
+    return false;
+  }
+  
+  bool ok = writeAll(fd, data, size);
+  if (!ok) {
+    error = "Cannot write " + tempPath + ": " + std::strerror(errno);
+  }
+  // Otherwise the rename can reach the disk before the data does, and a
+  // crash leaves path empty or partial
+  if (ok && !syncToDisk(fd)) {
+    error = "Cannot sync " + tempPath + ": " + std::strerror(errno);
+    ok = false;
+  }
+  if (::close(fd) != 0 && ok) {
+    error = "Cannot close " + tempPath + ": " + std::strerror(errno);
+    ok = false;
+  }
+  if (ok && std::rename(tempPath.c_str(), path.c_str()) != 0) {
+    error = "Cannot rename " + tempPath + ": " + std::strerror(errno);
+    ok = false;
+  }
+  if (!ok) {
+    ::unlink(tempPath.c_str());
+    return false;
+  }
+  // The new file is in place either way; this makes the rename survive a crash
+  if (!syncParentDirectory(path)) {
+    error = "Cannot sync the directory of " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+bool readWholeFile(const std::string& path, std::vector<uint8_t>& data, std::string& error) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    error = "Cannot open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  
+  struct stat info;
+  bool ok = ::fstat(fd, &info) == 0;
+  if (ok) {
+    data.resize(static_cast<size_t>(info.st_size));
+    size_t offset = 0;
+    while (ok && offset < data.size()) {
+      ssize_t count = ::read(fd, data.data() + offset, data.size() - offset);
+      if (count < 0 && errno == EINTR) {
+        continue;
+      }
+      ok = count > 0;
+      offset += ok ? count : 0;
+    }
+  }
+  if (!ok) {
+    error = "Cannot read " + path + ": " + std::strerror(errno);
+  }
+  ::close(fd);
+  return ok;
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& path, std::string& error) {
+  errno = 0;
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    error = "Cannot open " + path + ": " + std::strerror(errno);
+    return nullptr;
+  }
+  
+  struct stat info;
+  if (::fstat(fd, &info) != 0 || info.st_size == 0) {
+    error = "Cannot map " + path + ": " + (errno != 0 ? std::strerror(errno) : "empty file");
+    ::close(fd);
+    return nullptr;
+  }
+  
+  // The mapping stays valid after the descriptor is closed
+  const size_t size = static_cast<size_t>(info.st_size);
+  void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    error = "Cannot map " + path + ": " + std::strerror(errno);
+    return nullptr;
+  }
+  return std::shared_ptr<MappedFile>(new MappedFile(static_cast<const uint8_t*>(data), size));
+}
+
+MappedFile::~MappedFile() {
+  ::munmap(const_cast<uint8_t*>(data_), size_);
+}
+
+} // namespace facebook::react
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "TileGrid.h"
+
+namespace facebook::react {
+
+class WorkerPool;
+
+// Paint-bucket fill of the 4-connected region around a seed pixel whose
+// pixels are all within tolerance of the seed's color (largest difference
+// of any channel, alpha included).
+//
+// Runs in three passes over one bit per pixel, one 64-bit word per tile
+// row: tiles are tested against the seed color in parallel, the region is
+// traced sequentially as horizontal spans over those bits, and the filled
+// tiles are written in parallel. Tiles the region covers whole share one
+// solid tile instead of being written. The bitmaps are kept between fills.
+class FloodFill {
+public:
+  // Fills rows [top, top + height) of the grid (a layer plane) with color
+  // from (x, y); returns the number of pixels filled
+  uint64_t fill(TileGrid& pixels, int top, int width, int height, int x, int y,
+                uint32_t color, uint8_t tolerance, WorkerPool& workers);
+
+private:
+  uint64_t open(int y, int word) const {
+    const size_t index = static_cast<size_t>(y) * stride_ + word;
+    return matches_[index] & ~filled_[index];
+  }
+  // First open pixel of the run through x, and one past its last
+  int runStart(int y, int x) const;
+  int runEnd(int y, int x) const;
+  // Queues the start of every open run of row y overlapping [x0, x1)
+  void queueRuns(int y, int x0, int x1);
+
+  int width_ = 0;
+  int stride_ = 0; // Words per row
+  std::vector<uint64_t> matches_; // Within tolerance of the seed color
+  std::vector<uint64_t> filled_;
+  std::vector<std::pair<int, int>> seeds_;
+};
+
+} // namespace facebook::react
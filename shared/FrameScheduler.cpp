@@ -0,0 +1,152 @@
+#include "FrameScheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include "PerfStats.h"
+
+namespace facebook::react {
+
+bool parseFrameClockMode(std::string_view name, FrameClockMode& mode) {
+  if (name == "immediate") {
+    mode = FrameClockMode::Immediate;
+  } else if (name == "native") {
+    mode = FrameClockMode::Native;
+  } else if (name == "manual") {
+    mode = FrameClockMode::Manual;
+  } else if (name == "display") {
+    mode = FrameClockMode::Display;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+FrameScheduler::FrameScheduler(RenderThread& renderThread) : renderThread_(renderThread) {}
+
+std::mutex FrameScheduler::displayMutex_;
+std::vector<FrameScheduler*> FrameScheduler::displaySchedulers_;
+
+FrameScheduler::~FrameScheduler() {
+  setDisplayClock(false);
+  stopClock();
+}
+
+void FrameScheduler::configure(FrameClockMode mode, double framesPerSecond) {
+  if (!(framesPerSecond > 0.0)) {
+    framesPerSecond = kDefaultFramesPerSecond;
+  }
+  const auto intervalNanos = static_cast<uint64_t>(1e9 / framesPerSecond);
+  
+  stopClock();
+  setDisplayClock(mode == FrameClockMode::Display);
+  mode_.store(mode, std::memory_order_relaxed);
+  frameNanos_.store(intervalNanos, std::memory_order_relaxed);
+  budgetNanos_.store(static_cast<uint64_t>(intervalNanos * kRasterBudgetFraction), std::memory_order_relaxed);
+  renderThread_.setPaced(mode != FrameClockMode::Immediate);
+  
+  if (mode == FrameClockMode::Native) {
+    {
+      std::lock_guard<std::mutex> lock(clockMutex_);
+      clockStopping_ = false;
+    }
+    clockThread_ = std::thread([this, intervalNanos] { runClock(intervalNanos); });
+  }
+}
+
+void FrameScheduler::tick() {
+  if (mode_.load(std::memory_order_relaxed) != FrameClockMode::Immediate) {
+    renderThread_.tick();
+  }
+}
+
+void FrameScheduler::wake() {
+  // Pairs with the fence in runClock: either the clock sees the submitted
+  // command before parking, or this sees it parked
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (parked_.exchange(false, std::memory_order_relaxed)) {
+    // Taking the lock means the clock is already waiting, so the notify lands
+    { std::lock_guard<std::mutex> lock(clockMutex_); }
+    clockCondition_.notify_all();
+  }
+  // No display link has fired lately, so no view is on screen to tick
+  if (mode_.load(std::memory_order_relaxed) == FrameClockMode::Display) {
+    const uint64_t sinceDisplayTick = PerfStats::now() - lastDisplayTick_.load(std::memory_order_relaxed);
+    if (sinceDisplayTick > kDisplayTimeoutFrames * frameNanos_.load(std::memory_order_relaxed)) {
+      renderThread_.tick();
+    }
+  }
+}
+
+void FrameScheduler::displayFrame(double frameTime) {
+  std::lock_guard<std::mutex> lock(displayMutex_);
+  for (FrameScheduler* scheduler : displaySchedulers_) {
+    if (frameTime > scheduler->lastDisplayFrame_) {
+      scheduler->lastDisplayFrame_ = frameTime;
+      scheduler->lastDisplayTick_.store(PerfStats::now(), std::memory_order_relaxed);
+      scheduler->renderThread_.tick();
+    }
+  }
+}
+
+void FrameScheduler::setDisplayClock(bool enabled) {
+  std::lock_guard<std::mutex> lock(displayMutex_);
+  std::erase(displaySchedulers_, this);
+  if (enabled) {
+    displaySchedulers_.push_back(this);
+  }
+}
+
+uint64_t FrameScheduler::rasterDeadline(uint64_t frameStart) const {
+  if (mode_.load(std::memory_order_relaxed) == FrameClockMode::Immediate) {
+    return UINT64_MAX;
+  }
+  return frameStart + budgetNanos_.load(std::memory_order_relaxed);
+}
+
+void FrameScheduler::stopClock() {
+  if (!clockThread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(clockMutex_);
+    clockStopping_ = true;
+  }
+  clockCondition_.notify_all();
+  clockThread_.join();
+}
+
+void FrameScheduler::runClock(uint64_t intervalNanos) {
+  const auto interval = std::chrono::nanoseconds(intervalNanos);
+  auto nextTick = std::chrono::steady_clock::now() + interval;
+  
+  std::unique_lock<std::mutex> lock(clockMutex_);
+  idleFrame_.store(false, std::memory_order_relaxed);
+  parked_.store(false, std::memory_order_relaxed);
+  for (;;) {
+    if (idleFrame_.exchange(false, std::memory_order_relaxed)) {
+      parked_.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!renderThread_.hasPending()) {
+        clockCondition_.wait(lock, [this] {
+          return clockStopping_ || !parked_.load(std::memory_order_relaxed);
+        });
+        // Work just arrived: its frame starts now
+        nextTick = std::chrono::steady_clock::now();
+      }
+      parked_.store(false, std::memory_order_relaxed);
+    }
+    if (clockCondition_.wait_until(lock, nextTick, [this] { return clockStopping_; })) {
+      return;
+    }
+    renderThread_.tick();
+    
+    // Stay on the original cadence; skip ticks rather than bunch them up
+    nextTick += interval;
+    const auto now = std::chrono::steady_clock::now();
+    if (nextTick <= now) {
+      nextTick = now + interval;
+    }
+  }
+}
+
+} // namespace facebook::react
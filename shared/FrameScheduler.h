@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "RenderThread.h"
+
+namespace facebook::react {
+
+enum class FrameClockMode : uint8_t {
+  Immediate, // Apply commands as soon as they arrive; no frame deadline
+  Native,    // Tick from a native clock thread at the configured rate
+  Manual,    // Tick only when tick() is called (e.g. from a display link)
+  Display,   // Tick on the display link of the platform views showing canvases
+};
+
+bool parseFrameClockMode(std::string_view name, FrameClockMode& mode);
+
+// Paces the render thread to display frames. Points that arrive within one
+// frame are queued and rasterized together on the tick, and each frame gets
+// a raster budget that optional work is shed against.
+//
+// The native clock parks after a frame with nothing to do and stays parked
+// until wake() reports new work, so an idle module costs no wake-ups.
+class FrameScheduler {
+public:
+  static constexpr double kDefaultFramesPerSecond = 60.0;
+
+  // Fraction of the frame interval raster work may use before shedding
+  static constexpr double kRasterBudgetFraction = 0.5;
+  
+  // In Display mode, frames without a display link tick before submits
+  // wake the render thread straight away, as with no view on screen
+  static constexpr uint64_t kDisplayTimeoutFrames = 2;
+
+  explicit FrameScheduler(RenderThread& renderThread);
+  ~FrameScheduler();
+
+  FrameScheduler(const FrameScheduler&) = delete;
+  FrameScheduler& operator=(const FrameScheduler&) = delete;
+
+  void configure(FrameClockMode mode, double framesPerSecond);
+  void tick();
+  // Called after submitting work; restarts a parked clock
+  void wake();
+  // Called by the batch handler for a frame that had nothing to apply
+  void reportIdleFrame() { idleFrame_.store(true, std::memory_order_relaxed); }
+  
+  // Called by platform views on every display link frame, with the link's
+  // timestamp. Ticks each scheduler in Display mode once per frame, however
+  // many views are on screen.
+  static void displayFrame(double frameTime);
+
+  // Deadline in PerfStats::now() nanoseconds for a frame starting at
+  // frameStart; UINT64_MAX when not pacing
+  uint64_t rasterDeadline(uint64_t frameStart) const;
+
+private:
+  void setDisplayClock(bool enabled);
+  void stopClock();
+  void runClock(uint64_t intervalNanos);
+
+  RenderThread& renderThread_;
+  std::atomic<FrameClockMode> mode_{FrameClockMode::Immediate};
+  std::atomic<uint64_t> frameNanos_{0};
+  std::atomic<uint64_t> budgetNanos_{0};
+  std::atomic<uint64_t> lastDisplayTick_{0}; // PerfStats::now() of the last display tick
+  std::atomic<bool> idleFrame_{false};
+  std::atomic<bool> parked_{false};
+
+  std::mutex clockMutex_;
+  std::condition_variable clockCondition_;
+  bool clockStopping_ = false; // Guarded by clockMutex_
+  std::thread clockThread_;
+  
+  static std::mutex displayMutex_;
+  static std::vector<FrameScheduler*> displaySchedulers_; // Guarded by displayMutex_
+  double lastDisplayFrame_ = 0.0;                         // Guarded by displayMutex_
+};
+
+} // namespace facebook::react
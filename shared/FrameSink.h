@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "TileGrid.h"
+
+namespace facebook::react {
+
+// One published canvas image: row-major ARGB, width * height pixels
+struct Frame {
+  int width = 0;
+  int height = 0;
+  std::vector<uint32_t> pixels;
+  uint64_t sequence = 0;
+  std::chrono::steady_clock::time_point publishedAt;
+  
+  // Grid generation the pixels reflect; lets the producer copy only newer tiles
+  uint64_t generation = 0;
+};
+
+// Lock-free triple buffer between the rasterizer and a platform view (or any
+// other consumer thread). The producer always has a back buffer to fill and
+// never waits; the consumer always gets the newest complete frame and keeps
+// it untouched until its next acquire. A fourth buffer lets a consumer that
+// hands the pixels on without copying keep the frame on screen while it
+// takes the next one.
+class FrameSink : public std::enable_shared_from_this<FrameSink> {
+public:
+  FrameSink();
+  
+  FrameSink(const FrameSink&) = delete;
+  FrameSink& operator=(const FrameSink&) = delete;
+  
+  // Producer side. Copies tiles changed since the back buffer was last
+  // filled, then swaps it into the middle slot.
+  void publish(const TileGrid& pixels);
+  
+  // Consumer side. Returns the newest published frame (nullptr before the
+  // first publish); the pointer stays valid until the next acquire.
+  const Frame* acquireLatest();
+  // Consumer side, for a consumer that wraps the pixels instead of copying
+  // them (a CGDataProvider, a texture upload). The frame stays untouched,
+  // across later acquires, until the returned pointer and its copies are
+  // gone, and may be released from any thread. Returns nullptr when nothing
+  // newer was published, or while the previous frame is still held too.
+  // The sink must be owned by a shared_ptr.
+  std::shared_ptr<const Frame> acquireHeld();
+  bool hasNewFrame() const;
+  
+  // Publishing is skipped entirely until a consumer attaches. The consumer
+  // side is single-threaded, so only one consumer may attach at a time;
+  // attachConsumer returns false while another is attached.
+  bool attachConsumer();
+  void detachConsumer() { consumerAttached_.store(false, std::memory_order_release); }
+  bool hasConsumer() const { return consumerAttached_.load(std::memory_order_relaxed); }
+  // Runs on the attaching thread whenever a consumer attaches, so the
+  // producer can publish the current image instead of waiting for an edit
+  void setFrameRequestHandler(std::function<void()> handler);
+  
+private:
+  // Swaps a fresh frame into the front, handing back a buffer nobody holds;
+  // false if there was none to take
+  bool takeFresh();
+  
+  static constexpr uint8_t kIndexMask = 0x3;
+  static constexpr uint8_t kFreshBit = 0x4;
+  
+  Frame frames_[4];
+  std::atomic<bool> held_[4] = {};    // set by acquireHeld, cleared on release
+  uint8_t backIndex_ = 0;             // producer-owned
+  uint8_t frontIndex_ = 1;            // consumer-owned
+  uint8_t spareIndex_ = 3;            // consumer-owned; the previous front
+  std::atomic<uint8_t> middle_{2};    // shared slot index | kFreshBit
+  uint64_t nextSequence_ = 1;
+  bool hasFront_ = false;
+  std::atomic<bool> consumerAttached_{false};
+  std::mutex requestMutex_;
+  std::function<void()> frameRequestHandler_; // Guarded by requestMutex_
+};
+
+// Canvas id -> sink lookup for platform views that only know the canvas id
+class FrameSinkRegistry {
+public:
+  static void add(int canvasId, std::shared_ptr<FrameSink> sink);
+  static void remove(int canvasId);
+  static std::shared_ptr<FrameSink> find(int canvasId);
+  
+private:
+  static std::mutex mutex_;
+  static std::unordered_map<int, std::shared_ptr<FrameSink>> sinks_;
+};
+
+} // namespace facebook::react
@@ -0,0 +1,219 @@
+#include "GestureInput.h"
+#include <algorithm>
+#include "CanvasHandles.h"
+#include "NativeGestureCanvas.h"
+
+namespace facebook::react {
+
+namespace {
+
+constexpr const char* kMethodNames[] = {"begin", "addPoint", "end", "setBrushStyle", "dispose"};
+
+PointData pointFromArgs(const jsi::Value* args, size_t count) {
+  auto number = [&](size_t index, double fallback) {
+    return index < count && args[index].isNumber() ? args[index].getNumber() : fallback;
+  };
+  
+  PointData point;
+  point.x = number(0, 0.0);
+  point.y = number(1, 0.0);
+  point.pressure = std::clamp(number(2, 1.0), 0.0, 1.0);
+  point.timestamp = number(3, 0.0);
+  return point;
+}
+
+} // namespace
+
+GestureInput::GestureInput(
+  std::weak_ptr<NativeGestureCanvas> module,
+  std::weak_ptr<CanvasSession> session,
+  std::shared_ptr<RenderThread::Lane> lane,
+  std::shared_ptr<const BrushPreset> brushPreset
+) : module_(std::move(module)), jsThread_(std::this_thread::get_id()), session_(std::move(session)),
+    lane_(std::move(lane)), brushPreset_(std::move(brushPreset)) {}
+
+void GestureInput::claimProducer(jsi::Runtime& rt) {
+  const auto current = std::this_thread::get_id();
+  auto expected = std::thread::id();
+  if (!producer_.compare_exchange_strong(expected, current) && expected != current) {
+    throw jsi::JSError(rt, "GestureInput must only be fed from one thread");
+  }
+}
+
+void GestureInput::dispose() {
+  disposed_.store(true, std::memory_order_release);
+  // Unclaimed, or claimed by this thread: nobody else touches the lane
+  const auto current = std::this_thread::get_id();
+  auto expected = std::thread::id();
+  if (producer_.compare_exchange_strong(expected, current) || expected == current) {
+    release();
+  }
+}
+
+void GestureInput::release() {
+  auto module = module_.lock();
+  auto session = session_.lock();
+  if (module && session && lane_) {
+    for (auto& pointer : pointers_) {
+      RenderCommand cancel;
+      cancel.strokeId = pointer.strokeId;
+      cancel.stroke = std::move(pointer.stroke);
+      module->submit(*lane_, session, RenderCommandType::CancelStroke, std::move(cancel));
+    }
+  }
+  pointers_.clear();
+  session_.reset();
+  lane_.reset();
+}
+
+void GestureInput::submitPoint(jsi::Runtime& rt, RenderCommandType type, const jsi::Value* args, size_t count) {
+  claimProducer(rt);
+  if (!lane_) {
+    return;
+  }
+  if (disposed_.load(std::memory_order_acquire)) {
+    release();
+    return;
+  }
+  auto module = module_.lock();
+  auto session = session_.lock();
+  if (!module || !session) {
+    // The canvas is gone, so nothing will ever be drawn again
+    release();
+    return;
+  }
+  
+  RenderCommand command;
+  command.point = pointFromArgs(args, count);
+  const double pointerId = count > 4 && args[4].isNumber() ? args[4].getNumber() : 0.0;
+  
+  auto pointer = std::find_if(pointers_.begin(), pointers_.end(),
+                              [pointerId](const PointerStroke& entry) { return entry.pointerId == pointerId; });
+  
+  if (type == RenderCommandType::BeginStroke) {
+    // A begin without an end drops the stroke that pointer had in progress
+    if (pointer != pointers_.end()) {
+      RenderCommand cancel;
+      cancel.strokeId = pointer->strokeId;
+      cancel.stroke = std::move(pointer->stroke);
+      module->submit(*lane_, session, RenderCommandType::CancelStroke, std::move(cancel));
+      pointers_.erase(pointer);
+    }
+    
+    std::shared_ptr<const BrushPreset> brushPreset;
+    {
+      std::lock_guard<std::mutex> lock(brushMutex_);
+      brushPreset = brushPreset_;
+    }
+    pointers_.push_back({pointerId, module->allocateStrokeId(), std::make_shared<Stroke>(std::move(brushPreset))});
+    pointer = pointers_.end() - 1;
+  } else if (pointer == pointers_.end()) {
+    return;
+  }
+  
+  command.strokeId = pointer->strokeId;
+  command.stroke = pointer->stroke;
+  module->submit(*lane_, session, type, std::move(command));
+  
+  if (type == RenderCommandType::EndStroke) {
+    pointers_.erase(pointer);
+  }
+}
+
+jsi::Value GestureInput::get(jsi::Runtime& rt, const jsi::PropNameID& name) {
+  for (const auto& [methodName, method] : methods(rt)) {
+    if (jsi::PropNameID::compare(rt, methodName, name)) {
+      return jsi::Value(rt, method);
+    }
+  }
+  return jsi::Value::undefined();
+}
+
+std::vector<jsi::PropNameID> GestureInput::getPropertyNames(jsi::Runtime& rt) {
+  std::vector<jsi::PropNameID> names;
+  for (const char* name : kMethodNames) {
+    names.push_back(jsi::PropNameID::forAscii(rt, name));
+  }
+  return names;
+}
+
+const std::vector<std::pair<jsi::PropNameID, jsi::Function>>& GestureInput::methods(jsi::Runtime& rt) {
+  RuntimeMethods* entry = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(methodsMutex_);
+    for (auto& candidate : runtimeMethods_) {
+      if (candidate->runtime == &rt) {
+        entry = candidate.get();
+      }
+    }
+    if (!entry) {
+      runtimeMethods_.push_back(std::make_unique<RuntimeMethods>(RuntimeMethods{&rt, {}}));
+      entry = runtimeMethods_.back().get();
+    }
+  }
+  if (entry->methods.empty()) {
+    for (const char* methodName : kMethodNames) {
+      auto name = jsi::PropNameID::forAscii(rt, methodName);
+      jsi::Function method = createMethod(rt, name);
+      entry->methods.emplace_back(std::move(name), std::move(method));
+    }
+  }
+  return entry->methods;
+}
+
+jsi::Function GestureInput::createMethod(jsi::Runtime& rt, const jsi::PropNameID& name) {
+  const std::string property = name.utf8(rt);
+  std::weak_ptr<GestureInput> weakSelf = weak_from_this();
+  
+  auto pointMethod = [&](RenderCommandType type) {
+    return jsi::Function::createFromHostFunction(rt, name, 5,
+      [weakSelf, type](jsi::Runtime& rt, const jsi::Value&, const jsi::Value* args, size_t count) -> jsi::Value {
+        if (auto self = weakSelf.lock()) {
+          self->submitPoint(rt, type, args, count);
+        }
+        return jsi::Value::undefined();
+      });
+  };
+  
+  if (property == "begin") {
+    return pointMethod(RenderCommandType::BeginStroke);
+  }
+  if (property == "addPoint") {
+    return pointMethod(RenderCommandType::AddPoint);
+  }
+  if (property == "end") {
+    return pointMethod(RenderCommandType::EndStroke);
+  }
+  
+  if (property == "dispose") {
+    return jsi::Function::createFromHostFunction(rt, name, 0,
+      [weakSelf](jsi::Runtime&, const jsi::Value&, const jsi::Value*, size_t) -> jsi::Value {
+        if (auto self = weakSelf.lock()) {
+          self->dispose();
+        }
+        return jsi::Value::undefined();
+      });
+  }
+  
+  // setBrushStyle
+  return jsi::Function::createFromHostFunction(rt, name, 1,
+    [weakSelf](jsi::Runtime& rt, const jsi::Value&, const jsi::Value* args, size_t count) -> jsi::Value {
+      auto self = weakSelf.lock();
+      auto module = self ? self->module_.lock() : nullptr;
+      if (!module || count < 1 || !args[0].isObject()) {
+        return jsi::Value::undefined();
+      }
+      const jsi::Object style = args[0].getObject(rt);
+      // Plain styles go through the module's property-name cache, which
+      // belongs to the JS thread
+      if (!style.isHostObject<BrushStyleHandle>(rt) && std::this_thread::get_id() != self->jsThread_) {
+        throw jsi::JSError(rt, "setBrushStyle off the JS thread takes a handle from registerBrushStyle");
+      }
+      auto brushPreset = module->resolveBrushPreset(rt, style);
+      std::lock_guard<std::mutex> lock(self->brushMutex_);
+      self->brushPreset_ = std::move(brushPreset);
+      return jsi::Value::undefined();
+    });
+}
+
+} // namespace facebook::react
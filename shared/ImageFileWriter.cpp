@@ -0,0 +1,98 @@
+#include "ImageFileWriter.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+#include "SnapshotEncoder.h"
+
+namespace facebook::react {
+
+bool parseImageFileFormat(const std::string& name, ImageFileFormat& format) {
+  if (name.empty() || name == "bmp") {
+    format = ImageFileFormat::Bmp;
+    return true;
+  }
+  if (name == "raw") {
+    format = ImageFileFormat::Raw;
+    return true;
+  }
+  return false;
+}
+
+static bool writeAll(int fd, const uint8_t* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = ::write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+bool writeImageFile(const TileGrid& pixels, const std::string& path,
+                    ImageFileFormat format, std::string& error) {
+  const int width = pixels.width();
+  const int height = pixels.height();
+  const std::string tempPath = path + ".tmp";
+  
+  int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    error = "Cannot open " + tempPath + ": " + std::strerror(errno);
+    return false;
+  }
+  
+  const size_t rowSize = format == ImageFileFormat::Bmp
+      ? static_cast<size_t>(bmpRowSize(width))
+      : static_cast<size_t>(width) * sizeof(uint32_t);
+  
+  // One band of encoded rows, matching the tile height
+  std::vector<uint8_t> band(rowSize * kTileSize);
+  std::vector<uint32_t> row(width);
+  bool ok = true;
+  
+  if (format == ImageFileFormat::Bmp) {
+    std::vector<uint8_t> header(bmpHeaderSize());
+    writeBmpHeader(header.data(), width, height);
+    ok = writeAll(fd, header.data(), header.size());
+  }
+  
+  for (int bandY = 0; ok && bandY < height; bandY += kTileSize) {
+    int rows = std::min(kTileSize, height - bandY);
+    for (int i = 0; i < rows; ++i) {
+      uint8_t* out = band.data() + i * rowSize;
+      if (format == ImageFileFormat::Bmp) {
+        pixels.copyRow(bandY + i, row.data());
+        packBmpRow(row.data(), width, out);
+      } else {
+        pixels.copyRow(bandY + i, reinterpret_cast<uint32_t*>(out));
+      }
+    }
+    ok = writeAll(fd, band.data(), rows * rowSize);
+  }
+  
+  if (!ok) {
+    error = "Write to " + tempPath + " failed: " + std::strerror(errno);
+  }
+  if (::close(fd) != 0 && ok) {
+    error = "Close of " + tempPath + " failed: " + std::strerror(errno);
+    ok = false;
+  }
+  if (ok && std::rename(tempPath.c_str(), path.c_str()) != 0) {
+    error = "Cannot move export to " + path + ": " + std::strerror(errno);
+    ok = false;
+  }
+  if (!ok) {
+    ::unlink(tempPath.c_str());
+  }
+  return ok;
+}
+
+} // namespace facebook::react
@@ -0,0 +1,97 @@
+#include "JsiConversions.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace facebook::react {
+
+PropNameCache::PropNameCache(jsi::Runtime& rt)
+    : x(jsi::PropNameID::forAscii(rt, "x")),
+      y(jsi::PropNameID::forAscii(rt, "y")),
+      pressure(jsi::PropNameID::forAscii(rt, "pressure")),
+      timestamp(jsi::PropNameID::forAscii(rt, "timestamp")),
+      size(jsi::PropNameID::forAscii(rt, "size")),
+      opacity(jsi::PropNameID::forAscii(rt, "opacity")),
+      color(jsi::PropNameID::forAscii(rt, "color")),
+      texture(jsi::PropNameID::forAscii(rt, "texture")),
+      dampening(jsi::PropNameID::forAscii(rt, "dampening")),
+      fluidResponse(jsi::PropNameID::forAscii(rt, "fluidResponse")) {}
+
+static double readNumber(jsi::Runtime& rt, const jsi::Object& object, const jsi::PropNameID& name) {
+  jsi::Value value = object.getProperty(rt, name);
+  if (!value.isNumber() || !std::isfinite(value.getNumber())) {
+    throw jsi::JSError(rt, "GestureCanvas: expected a finite number for '" + name.utf8(rt) + "'");
+  }
+  return value.getNumber();
+}
+
+static double clamp01(double value) {
+  return std::min(1.0, std::max(0.0, value));
+}
+
+PointData readPointData(jsi::Runtime& rt, const PropNameCache& names, const jsi::Object& point) {
+  PointData data;
+  data.x = readNumber(rt, point, names.x);
+  data.y = readNumber(rt, point, names.y);
+  data.pressure = clamp01(readNumber(rt, point, names.pressure));
+  data.timestamp = readNumber(rt, point, names.timestamp);
+  return data;
+}
+
+BrushStyleData readBrushStyleData(jsi::Runtime& rt, const PropNameCache& names, const jsi::Object& brushStyle) {
+  BrushStyleData data;
+  data.size = std::max(0.0, readNumber(rt, brushStyle, names.size));
+  data.opacity = clamp01(readNumber(rt, brushStyle, names.opacity));
+  data.dampening = readNumber(rt, brushStyle, names.dampening);
+  data.fluidResponse = readNumber(rt, brushStyle, names.fluidResponse);
+  
+  // Color and texture names fit the small-string buffer, so no heap traffic
+  std::string color = brushStyle.getProperty(rt, names.color).asString(rt).utf8(rt);
+  data.color = parseHexColor(color, 0xFF000000);
+  std::string texture = brushStyle.getProperty(rt, names.texture).asString(rt).utf8(rt);
+  data.texture = parseBrushTexture(texture);
+  return data;
+}
+
+uint32_t parseHexColor(std::string_view hex, uint32_t fallback) {
+  if (hex.empty() || hex[0] != '#') {
+    return fallback;
+  }
+  hex.remove_prefix(1);
+  if (hex.size() != 6 && hex.size() != 8) {
+    return fallback;
+  }
+  
+  uint32_t value = 0;
+  for (char c : hex) {
+    uint32_t digit;
+    if (c >= '0' && c <= '9') {
+      digit = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      digit = c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      digit = c - 'A' + 10;
+    } else {
+      return fallback;
+    }
+    value = (value << 4) | digit;
+  }
+  
+  // Six digits are opaque RGB; eight already carry alpha in front
+  return hex.size() == 6 ? (0xFF000000 | value) : value;
+}
+
+BrushTexture parseBrushTexture(std::string_view name) {
+  if (name == "chalk") {
+    return BrushTexture::Chalk;
+  }
+  if (name == "watercolor") {
+    return BrushTexture::Watercolor;
+  }
+  if (name == "eraser") {
+    return BrushTexture::Eraser;
+  }
+  return BrushTexture::Normal;
+}
+
+} // namespace facebook::react
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <jsi/jsi.h>
+#include <string_view>
+#include "CanvasTypes.h"
+
+namespace facebook::react {
+
+// Property names used on the per-event path, created once per runtime so
+// lookups skip the string -> PropNameID conversion on every call.
+struct PropNameCache {
+  explicit PropNameCache(jsi::Runtime& rt);
+  
+  jsi::PropNameID x;
+  jsi::PropNameID y;
+  jsi::PropNameID pressure;
+  jsi::PropNameID timestamp;
+  jsi::PropNameID size;
+  jsi::PropNameID opacity;
+  jsi::PropNameID color;
+  jsi::PropNameID texture;
+  jsi::PropNameID dampening;
+  jsi::PropNameID fluidResponse;
+};
+
+// Reads and validates a Point / BrushStyle object; throws jsi::JSError on bad input
+PointData readPointData(jsi::Runtime& rt, const PropNameCache& names, const jsi::Object& point);
+BrushStyleData readBrushStyleData(jsi::Runtime& rt, const PropNameCache& names, const jsi::Object& brushStyle);
+
+// "#RRGGBB" or "#AARRGGBB" to ARGB; returns fallback when the string is malformed
+uint32_t parseHexColor(std::string_view hex, uint32_t fallback);
+BrushTexture parseBrushTexture(std::string_view name);
+
+} // namespace facebook::react
@@ -0,0 +1,229 @@
+#include "LayerStack.h"
+#include <algorithm>
+#include <cstring>
+#include "WorkerPool.h"
+
+namespace facebook::react {
+
+LayerStack::LayerStack(int width, int height, uint32_t backgroundColor)
+    : width_(width), height_(height), backgroundColor_(backgroundColor),
+      transparent_(std::make_shared<PixelTile>()),
+      planes_(0, 0, backgroundColor), composite_(0, 0, backgroundColor) {
+  transparent_->pixels.fill(backgroundColor & 0x00FFFFFF);
+  allocate(width, height);
+}
+
+LayerStack::LayerStack(int width, int height, uint32_t backgroundColor, TileLoader baseLoader)
+    : width_(width), height_(height), backgroundColor_(backgroundColor),
+      tilesPerLayer_(((width + kTileSize - 1) / kTileSize) * ((height + kTileSize - 1) / kTileSize)),
+      planeHeight_((height + kTileSize - 1) / kTileSize * kTileSize),
+      transparent_(std::make_shared<PixelTile>()),
+      planes_(width, planeHeight_ * kMaxLayers,
+              [baseLoader, transparent = transparent_, tilesPerLayer = tilesPerLayer_](int index) {
+                return index < tilesPerLayer ? baseLoader(index) : transparent;
+              }),
+      composite_(width, height, baseLoader),
+      dirtyTiles_(tilesPerLayer_) {
+  transparent_->pixels.fill(backgroundColor & 0x00FFFFFF);
+  // Both grids load the same tiles, so the composite starts out current
+  composedGeneration_ = planes_.generation();
+  composeAll_ = false;
+}
+
+void LayerStack::setProperties(int layer, const LayerProperties& properties) {
+  if (properties_[layer] != properties) {
+    properties_[layer] = properties;
+    composeAll_ = true;
+  }
+}
+
+int LayerStack::add() {
+  if (count_ == kMaxLayers) {
+    return -1;
+  }
+  // The slot is still transparent: slots past count_ are never written
+  properties_[count_] = LayerProperties();
+  composeAll_ = true;
+  return count_++;
+}
+
+void LayerStack::clear() {
+  auto background = std::make_shared<PixelTile>();
+  background->pixels.fill(backgroundColor_);
+  fillLayer(0, background);
+  for (int layer = 1; layer < count_; ++layer) {
+    fillLayer(layer, transparent_);
+  }
+}
+
+void LayerStack::reset(int width, int height) {
+  count_ = 1;
+  properties_.fill(LayerProperties());
+  allocate(width, height);
+}
+
+void LayerStack::resize(int width, int height) {
+  const TileGrid previous = planes_;
+  const int previousWidth = width_;
+  const int previousHeight = height_;
+  const int previousPlaneHeight = planeHeight_;
+  allocate(width, height);
+
+  // Tiles stay aligned to each layer's origin, so a tile that was whole
+  // before is simply shared; the ones cut by the old edge are copied row by row
+  const int copyWidth = std::min(previousWidth, width_);
+  const int copyHeight = std::min(previousHeight, height_);
+  for (int layer = 0; layer < count_; ++layer) {
+    const int from = layer * previousPlaneHeight;
+    const int to = top(layer);
+    for (int y0 = 0; y0 < copyHeight; y0 += kTileSize) {
+      for (int x0 = 0; x0 < copyWidth; x0 += kTileSize) {
+        if (x0 + kTileSize <= previousWidth && y0 + kTileSize <= previousHeight) {
+          planes_.exchangeTile(planes_.tileIndexAt(x0, to + y0), previous.tileRef(previous.tileIndexAt(x0, from + y0)));
+          continue;
+        }
+        const int count = std::min(kTileSize, copyWidth - x0);
+        for (int y = y0; y < std::min(y0 + kTileSize, copyHeight); ++y) {
+          std::memcpy(planes_.mutableSpan(x0, to + y), previous.span(x0, from + y), count * sizeof(uint32_t));
+        }
+      }
+    }
+  }
+}
+
+void LayerStack::resample(int width, int height, ResampleMode mode, WorkerPool& workers) {
+  const TileGrid previous = planes_;
+  const int previousWidth = width_;
+  const int previousHeight = height_;
+  const int previousTilesPerLayer = tilesPerLayer_;
+  allocate(width, height);
+
+  // Each layer goes through the filter as a grid of its own, sharing tiles
+  // both ways; layers never drawn on stay transparent as they are
+  for (int layer = 0; layer < count_; ++layer) {
+    const int first = layer * previousTilesPerLayer;
+    bool drawn = false;
+    for (int index = first; index < first + previousTilesPerLayer && !drawn; ++index) {
+      drawn = previous.tile(index) != transparent_->pixels.data();
+    }
+    if (!drawn) {
+      continue;
+    }
+
+    TileGrid source(previousWidth, previousHeight, backgroundColor_);
+    for (int index = 0; index < previousTilesPerLayer; ++index) {
+      source.exchangeTile(index, previous.tileRef(first + index));
+    }
+    TileGrid target(width_, height_, backgroundColor_);
+    resampleGrid(source, target, mode, workers);
+    for (int index = 0; index < tilesPerLayer_; ++index) {
+      planes_.exchangeTile(layer * tilesPerLayer_ + index, target.tileRef(index));
+    }
+  }
+}
+
+void LayerStack::flatten() {
+  composite();
+  for (int index = 0; index < tilesPerLayer_; ++index) {
+    planes_.exchangeTile(index, composite_.tileRef(index));
+  }
+  for (int layer = 1; layer < count_; ++layer) {
+    fillLayer(layer, transparent_);
+  }
+  count_ = 1;
+  properties_.fill(LayerProperties());
+  composeAll_ = true;
+}
+
+void LayerStack::adopt(const LayerStack& other) {
+  count_ = other.count_;
+  properties_ = other.properties_;
+  // Its untouched slots share its transparent tile, which has to stay
+  // recognizable as untouched here
+  transparent_ = other.transparent_;
+  for (int index = 0; index < planes_.tileCount(); ++index) {
+    planes_.exchangeTile(index, other.planes_.tileRef(index));
+  }
+  composeAll_ = true;
+}
+
+const TileGrid& LayerStack::composite() {
+  const uint64_t generation = planes_.generation();
+  if (composeAll_) {
+    for (int tile = 0; tile < tilesPerLayer_; ++tile) {
+      composeTile(tile);
+    }
+  } else if (generation != composedGeneration_) {
+    // Untouched layers cost nothing: only tiles some layer wrote are rebuilt
+    std::fill(dirtyTiles_.begin(), dirtyTiles_.end(), 0);
+    for (int index : planes_.tilesChangedSince(composedGeneration_)) {
+      dirtyTiles_[canvasTile(index)] = 1;
+    }
+    for (int tile = 0; tile < tilesPerLayer_; ++tile) {
+      if (dirtyTiles_[tile]) {
+        composeTile(tile);
+      }
+    }
+  }
+  composedGeneration_ = generation;
+  composeAll_ = false;
+  return composite_;
+}
+
+void LayerStack::allocate(int width, int height) {
+  width_ = width;
+  height_ = height;
+  const int tilesY = (height + kTileSize - 1) / kTileSize;
+  tilesPerLayer_ = ((width + kTileSize - 1) / kTileSize) * tilesY;
+  planeHeight_ = tilesY * kTileSize;
+
+  planes_.resize(width, planeHeight_ * kMaxLayers, backgroundColor_);
+  auto background = std::make_shared<PixelTile>();
+  background->pixels.fill(backgroundColor_);
+  fillLayer(0, background);
+  for (int layer = 1; layer < kMaxLayers; ++layer) {
+    fillLayer(layer, transparent_);
+  }
+
+  composite_.resize(width, height, backgroundColor_);
+  dirtyTiles_.assign(tilesPerLayer_, 0);
+  composeAll_ = true;
+}
+
+void LayerStack::fillLayer(int layer, const std::shared_ptr<PixelTile>& tile) {
+  // One shared tile, detached wherever the layer is drawn on next
+  for (int index = layer * tilesPerLayer_; index < (layer + 1) * tilesPerLayer_; ++index) {
+    planes_.exchangeTile(index, tile);
+  }
+}
+
+void LayerStack::composeTile(int tile) {
+  if (sharesBase()) {
+    composite_.exchangeTile(tile, planes_.tileRef(tile));
+    return;
+  }
+
+  auto composed = std::make_shared<PixelTile>();
+  composed->pixels.fill(backgroundColor_);
+  for (int layer = 0; layer < count_; ++layer) {
+    const LayerProperties& properties = properties_[layer];
+    const uint32_t* source = planes_.tile(layer * tilesPerLayer_ + tile);
+    if (!properties.visible || properties.opacity == 0 || source == transparent_->pixels.data()) {
+      continue;
+    }
+    if (properties.blendMode == BlendMode::Erase) {
+      // The composite is opaque, so an erasing layer wipes what is below
+      // back to background, as far as its own alpha reaches
+      std::array<uint8_t, kTilePixels> coverage;
+      for (int i = 0; i < kTilePixels; ++i) {
+        coverage[i] = static_cast<uint8_t>(div255((source[i] >> 24) * properties.opacity));
+      }
+      blendColorSpan<BlendMode::Normal>(composed->pixels.data(), backgroundColor_, coverage.data(), kTilePixels);
+      continue;
+    }
+    layerSpanKernel(properties.blendMode)(composed->pixels.data(), source, kTilePixels, properties.opacity);
+  }
+  composite_.exchangeTile(tile, std::move(composed));
+}
+
+} // namespace facebook::react
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "BlendKernels.h"
+#include "Resampler.h"
+#include "TileGrid.h"
+
+namespace facebook::react {
+
+class WorkerPool;
+
+struct LayerProperties {
+  uint8_t opacity = 255;
+  bool visible = true;
+  BlendMode blendMode = BlendMode::Normal;
+
+  bool operator==(const LayerProperties& other) const = default;
+};
+
+// The layers of a canvas and their flattened composite, which is what
+// frames, snapshots, exports and saved documents see.
+//
+// Layer planes sit one under another in a single TileGrid, each padded to
+// whole tiles, so undo history and copy-on-write captures cover every layer
+// at once. All kMaxLayers slots exist from the start and share one
+// transparent tile until drawn on, so adding a layer never reshapes the
+// grid. The base layer starts as background, the others as transparent.
+//
+// A layer in Erase mode restores the background under it, by its alpha
+// times its opacity, rather than making the composite transparent.
+//
+// The composite is only rebuilt for tiles some layer wrote since the last
+// refresh. A lone base layer at full opacity is shared into it tile by
+// tile, without blending.
+class LayerStack {
+public:
+  static constexpr int kMaxLayers = 8;
+
+  LayerStack(int width, int height, uint32_t backgroundColor);
+  // Base layer backed by loader (e.g. a saved document's flattened pixels)
+  LayerStack(int width, int height, uint32_t backgroundColor, TileLoader baseLoader);
+
+  int count() const { return count_; }
+  const LayerProperties& properties(int layer) const { return properties_[layer]; }
+  void setProperties(int layer, const LayerProperties& properties);
+  // Adds a transparent layer on top; returns its index, or -1 when full
+  int add();
+
+  // Every layer slot, layer by layer from the top; row top(layer) + y is
+  // row y of the layer
+  TileGrid& planes() { return planes_; }
+  int top(int layer) const { return layer * planeHeight_; }
+  // Canvas tile a planes() tile belongs to
+  int canvasTile(int planeTile) const { return planeTile % tilesPerLayer_; }
+
+  // Base layer back to background, every other layer transparent
+  void clear();
+  // Single base layer of background at new dimensions
+  void reset(int width, int height);
+  // Keep the layers at new dimensions: resize crops and pads each one
+  // (top-left anchored), resample filters each one (see Resampler.h)
+  void resize(int width, int height);
+  void resample(int width, int height, ResampleMode mode, WorkerPool& workers);
+  // Collapses everything into a single base layer holding the composite
+  void flatten();
+  // Shares every tile and property of a stack of the same size. Generations
+  // keep counting up, so every tile counts as written.
+  void adopt(const LayerStack& other);
+
+  // Composite with every tile written since the last call rebuilt
+  const TileGrid& composite();
+  // Last composite's write counter; safe to read from any thread
+  uint64_t compositeGeneration() const { return composite_.generation(); }
+
+private:
+  // Fresh planes and composite at new dimensions; layers keep their slots
+  void allocate(int width, int height);
+  void fillLayer(int layer, const std::shared_ptr<PixelTile>& tile);
+  void composeTile(int tile);
+  bool sharesBase() const {
+    return count_ == 1 && properties_[0] == LayerProperties();
+  }
+
+  int width_;
+  int height_;
+  uint32_t backgroundColor_;
+  int tilesPerLayer_ = 0;
+  int planeHeight_ = 0;
+  int count_ = 1;
+  std::array<LayerProperties, kMaxLayers> properties_;
+  std::shared_ptr<PixelTile> transparent_; // Shared by every untouched slot tile
+  TileGrid planes_;
+
+  TileGrid composite_;
+  uint64_t composedGeneration_ = 0; // planes_ generation the composite reflects
+  bool composeAll_ = true; // Properties or layers changed since the last refresh
+  std::vector<uint8_t> dirtyTiles_; // Scratch, one flag per canvas tile
+};
+
+} // namespace facebook::react
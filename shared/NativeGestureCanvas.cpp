@@ -2,7 +2,14 @@
 #include <chrono>
 #include <cmath>
 #include <algorithm>
-#include <sstream>
+#include "BrushTextureAtlas.h"
+#include "SnapshotEncoder.h"
+#include "ImageFileWriter.h"
+#include "FileIO.h"
+#include "CanvasDocument.h"
+#include "CanvasJournal.h"
+#include "CanvasHandles.h"
+#include "GestureInput.h"
 
 // class Canvas {
 // public:
@@ -298,219 +305,728 @@
 namespace facebook::react {
 
 NativeGestureCanvas::NativeGestureCanvas(std::shared_ptr<CallInvoker> jsInvoker)
-    : NativeGestureCanvasCxxSpec(std::move(jsInvoker)) {}
+    : NativeGestureCanvasCxxSpec(std::move(jsInvoker)) {
+  renderThread_ = std::make_unique<RenderThread>(
+    [this](std::vector<RenderCommand>& batch) { applyBatch(batch); }
+  );
+  // Immediate until configured otherwise
+  frameScheduler_ = std::make_unique<FrameScheduler>(*renderThread_);
+  
+  // The lane is only ever written from the autosave thread
+  autosaver_ = std::make_unique<Autosaver>(
+    [this, lane = renderThread_->createLane()](std::shared_ptr<CanvasSession> session,
+                                               std::function<void(TileGrid)> onCapture) {
+      RenderCommand command;
+      command.onCapture = std::move(onCapture);
+      submit(*lane, std::move(session), RenderCommandType::Capture, std::move(command));
+    },
+    perfStats_
+  );
+}
 
 NativeGestureCanvas::~NativeGestureCanvas() {
-  canvases_.clear();
-  brushEngines_.clear();
-  activeStrokes_.clear();
+  // Stop the autosave thread (it submits captures) and the frame clock, then
+  // drain and stop the render thread before the state it touches goes away
+  autosaver_->stop();
+  frameScheduler_->configure(FrameClockMode::Immediate, FrameScheduler::kDefaultFramesPerSecond);
+  renderThread_.reset();
+  
+  ownedSessions_.clear();
+  sessions_.clear();
 }
 
 int NativeGestureCanvas::createCanvas(jsi::Runtime& rt, jsi::Object config) {
-  auto width = static_cast<int>(config.getProperty(rt, "width").asNumber());
-  auto height = static_cast<int>(config.getProperty(rt, "height").asNumber());
-  
-  std::string bgColorHex = config.getProperty(rt, "backgroundColor").asString(rt).utf8(rt);
-  uint32_t bgColor = 0xFFFFFFFF;
+  auto session = createSession(rt, config);
+  int canvasId = session->id();
+  ownedSessions_[canvasId] = std::move(session);
+  return canvasId;
+}
+
+jsi::Object NativeGestureCanvas::createCanvasHandle(jsi::Runtime& rt, jsi::Object config) {
+  auto handle = std::make_shared<CanvasHandle>(weak_from_this(), createSession(rt, config));
+  return jsi::Object::createFromHostObject(rt, std::move(handle));
+}
+
+jsi::Object NativeGestureCanvas::registerBrushStyle(jsi::Runtime& rt, jsi::Object brushStyle) {
+  auto handle = std::make_shared<BrushStyleHandle>(resolveBrushPreset(rt, brushStyle));
+  return jsi::Object::createFromHostObject(rt, std::move(handle));
+}
+
+void NativeGestureCanvas::registerBrushTexture(jsi::Runtime& rt, std::string texture, std::string kind,
+                                               int width, int height, jsi::Object pixels) {
+  BrushImageKind imageKind;
+  if (!parseBrushImageKind(kind, imageKind)) {
+    throw jsi::JSError(rt, "Unknown brush image kind " + kind);
+  }
+  if (width < 1 || height < 1 || width > BrushImage::kMaxSize || height > BrushImage::kMaxSize) {
+    throw jsi::JSError(rt, "Brush image must be 1 to " + std::to_string(BrushImage::kMaxSize) + " pixels a side");
+  }
   
-  if (bgColorHex.length() > 0 && bgColorHex[0] == '#') {
-    bgColorHex = bgColorHex.substr(1);
-    std::stringstream ss;
-    ss << std::hex << bgColorHex;
-    ss >> bgColor;
-    
-    if (bgColorHex.length() == 6) {
-      bgColor = (bgColor << 8) | 0xFF;
+  // Typed arrays are views, so read through to the buffer behind them
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+  if (pixels.isArrayBuffer(rt)) {
+    auto buffer = pixels.getArrayBuffer(rt);
+    data = buffer.data(rt);
+    size = buffer.size(rt);
+  } else {
+    jsi::Value view = pixels.getProperty(rt, "buffer");
+    if (!view.isObject() || !view.getObject(rt).isArrayBuffer(rt)) {
+      throw jsi::JSError(rt, "Brush image pixels must be an ArrayBuffer or typed array");
     }
+    auto buffer = view.getObject(rt).getArrayBuffer(rt);
+    data = buffer.data(rt) + static_cast<size_t>(pixels.getProperty(rt, "byteOffset").asNumber());
+    size = static_cast<size_t>(pixels.getProperty(rt, "byteLength").asNumber());
+  }
+  if (size < static_cast<size_t>(width) * height) {
+    throw jsi::JSError(rt, "Brush image needs " + std::to_string(width * height) + " bytes");
   }
   
-  int canvasId = nextCanvasId_++;
-  canvases_[canvasId] = std::make_shared<Canvas>(width, height, bgColor);
-  return canvasId;
+  BrushTextureAtlas::shared().set(parseBrushTexture(texture), imageKind,
+                                  std::make_shared<BrushImage>(width, height, data, imageKind));
+}
+
+jsi::Object NativeGestureCanvas::createGestureInput(jsi::Runtime& rt, int canvasId, jsi::Object brushStyle) {
+  auto session = findSession(canvasId);
+  if (!session) {
+    throw jsi::JSError(rt, "Unknown canvas " + std::to_string(canvasId));
+  }
+  
+  auto input = std::make_shared<GestureInput>(
+    weak_from_this(),
+    std::move(session),
+    renderThread_->createLane(),
+    resolveBrushPreset(rt, brushStyle)
+  );
+  return jsi::Object::createFromHostObject(rt, std::move(input));
 }
 
 void NativeGestureCanvas::destroyCanvas(jsi::Runtime& rt, int canvasId) {
-  if (canvases_.find(canvasId) != canvases_.end()) {
-    std::vector<int> strokesToRemove;
-    for (const auto& [strokeId, stroke] : activeStrokes_) {
-      strokesToRemove.push_back(strokeId);
-    }
-    
-    for (int strokeId : strokesToRemove) {
-      activeStrokes_.erase(strokeId);
-    }
-    
-    canvases_.erase(canvasId);
+  // Strokes in flight belong to the session, so only this canvas loses them.
+  // Handle canvases are released through their handle instead.
+  if (ownedSessions_.erase(canvasId) > 0) {
+    sessions_.erase(canvasId);
   }
 }
 
 void NativeGestureCanvas::clearCanvas(jsi::Runtime& rt, int canvasId) {
-  if (canvases_.find(canvasId) != canvases_.end()) {
-    canvases_[canvasId]->clear();
-  }
+  submit(RenderCommandType::Clear, canvasId, RenderCommand());
+}
+
+void NativeGestureCanvas::floodFill(jsi::Runtime& rt, int canvasId, double x, double y, std::string color, double tolerance) {
+  RenderCommand command;
+  command.point.x = x;
+  command.point.y = y;
+  command.color = parseHexColor(color, 0xFF000000);
+  command.tolerance = static_cast<uint8_t>(std::lround(std::clamp(tolerance, 0.0, 1.0) * 255));
+  submit(RenderCommandType::Fill, canvasId, std::move(command));
 }
 
 int NativeGestureCanvas::beginStroke(jsi::Runtime& rt, int canvasId, jsi::Object point, jsi::Object brushStyle) {
-  if (canvases_.find(canvasId) == canvases_.end()) {
+  auto session = findSession(canvasId);
+  if (!session) {
     return -1;
   }
   
-  auto pointData = extractPointData(rt, point);
-  auto brushStyleData = extractBrushStyleData(rt, brushStyle);
+  int strokeId;
+  startStroke(rt, session, strokeId, point, brushStyle);
+  return strokeId;
+}
+
+void NativeGestureCanvas::addPointToStroke(jsi::Runtime& rt, int canvasId, int strokeId, jsi::Object point) {
+  RenderCommand command;
+  command.strokeId = strokeId;
+  command.point = extractPointData(rt, point);
+  submit(RenderCommandType::AddPoint, canvasId, std::move(command));
+}
+
+void NativeGestureCanvas::endStroke(jsi::Runtime& rt, int canvasId, int strokeId, jsi::Object point) {
+  RenderCommand command;
+  command.strokeId = strokeId;
+  command.point = extractPointData(rt, point);
+  submit(RenderCommandType::EndStroke, canvasId, std::move(command));
+}
+
+void NativeGestureCanvas::undo(jsi::Runtime& rt, int canvasId) {
+  submit(RenderCommandType::Undo, canvasId, RenderCommand());
+}
+
+void NativeGestureCanvas::redo(jsi::Runtime& rt, int canvasId) {
+  submit(RenderCommandType::Redo, canvasId, RenderCommand());
+}
+
+void NativeGestureCanvas::setUndoBudget(jsi::Runtime& rt, int canvasId, double bytes) {
+  RenderCommand command;
+  command.historyBudget = static_cast<size_t>(std::max(bytes, 0.0));
+  submit(RenderCommandType::SetHistoryBudget, canvasId, std::move(command));
+}
+
+void NativeGestureCanvas::setCanvasSize(jsi::Runtime& rt, int canvasId, double width, double height, double scale) {
+  submit(RenderCommandType::Resize, canvasId, makeResizeCommand(width, height, scale));
+}
+
+void NativeGestureCanvas::resizeCanvas(jsi::Runtime& rt, int canvasId, double width, double height, std::string mode) {
+  ResampleMode resampleMode;
+  if (!parseResampleMode(mode, resampleMode)) {
+    throw jsi::JSError(rt, "Unknown resize mode " + mode);
+  }
+  RenderCommand command = makeResizeCommand(width, height, 1.0);
+  command.resampleMode = resampleMode;
+  submit(RenderCommandType::Resample, canvasId, std::move(command));
+}
+
+void NativeGestureCanvas::addLayer(jsi::Runtime& rt, int canvasId) {
+  submit(RenderCommandType::AddLayer, canvasId, RenderCommand());
+}
+
+void NativeGestureCanvas::setLayerProperties(jsi::Runtime& rt, int canvasId, int layer, double opacity,
+                                             bool visible, std::string blendMode) {
+  RenderCommand command;
+  if (!parseBlendMode(blendMode, command.layerProperties.blendMode)) {
+    throw jsi::JSError(rt, "Unknown blend mode " + blendMode);
+  }
+  command.layer = layer;
+  // Written so NaN lands on fully transparent
+  command.layerProperties.opacity = static_cast<uint8_t>(std::lround(opacity > 0.0 ? std::min(opacity, 1.0) * 255 : 0.0));
+  command.layerProperties.visible = visible;
+  submit(RenderCommandType::SetLayerProperties, canvasId, std::move(command));
+}
+
+void NativeGestureCanvas::setActiveLayer(jsi::Runtime& rt, int canvasId, int layer) {
+  RenderCommand command;
+  command.layer = layer;
+  submit(RenderCommandType::SetActiveLayer, canvasId, std::move(command));
+}
+
+void NativeGestureCanvas::setWetLayer(jsi::Runtime& rt, int canvasId, int layer) {
+  RenderCommand command;
+  command.layer = layer;
+  submit(RenderCommandType::SetWetLayer, canvasId, std::move(command));
+}
+
+RenderCommand NativeGestureCanvas::makeResizeCommand(double width, double height, double scale) {
+  // Written so NaN lands on the lower bound
+  auto bound = [](double value, double low, double high) { return value >= low ? std::min(value, high) : low; };
+  RenderCommand command;
+  command.width = static_cast<int>(bound(width, 1.0, kMaxCanvasDimension));
+  command.height = static_cast<int>(bound(height, 1.0, kMaxCanvasDimension));
+  command.scale = scale > 0.0 ? std::min(scale, kMaxCanvasScale) : 1.0;
+  return command;
+}
+
+void NativeGestureCanvas::applyMotionToCanvas(
+  jsi::Runtime& rt, 
+  int canvasId, 
+  double accelerationX, 
+  double accelerationY, 
+  double accelerationZ
+) {
+  RenderCommand command;
+  command.acceleration[0] = accelerationX;
+  command.acceleration[1] = accelerationY;
+  command.acceleration[2] = accelerationZ;
+  submit(RenderCommandType::ApplyMotion, canvasId, std::move(command));
+}
+
+std::string NativeGestureCanvas::getCanvasSnapshot(jsi::Runtime& rt, int canvasId) {
+  auto session = findSession(canvasId);
+  if (!session) {
+    return "";
+  }
+  
+  // Synchronous reads see everything JS has submitted before them
+  renderThread_->flush();
+  return session->snapshotAsBase64();
+}
+
+AsyncPromise<std::string> NativeGestureCanvas::getCanvasSnapshotAsync(jsi::Runtime& rt, int canvasId) {
+  AsyncPromise<std::string> promise(rt, jsInvoker_);
   
-  auto brushEngine = std::make_shared<BrushEngine>();
+  if (!findSession(canvasId)) {
+    promise.resolve("");
+    return promise;
+  }
   
-  std::string colorHex = brushStyleData["color"].asString(rt).utf8(rt);
-  uint32_t color = 0xFF000000;
+  // Captured on the render thread in queue order, encoded on the worker
+  RenderCommand command;
+  command.onCapture = [this, promise](TileGrid pixels) mutable {
+    snapshotWorker_.post([this, promise, pixels = std::move(pixels)]() mutable {
+      std::string dataUrl;
+      {
+        PerfStats::Scope timing(*perfStats_, PerfOperation::SnapshotEncode);
+        timing.setPixels(static_cast<uint64_t>(pixels.width()) * pixels.height());
+        dataUrl = encodeBmpDataUrl(pixels);
+      }
+      promise.resolve(dataUrl);
+    });
+  };
+  submit(RenderCommandType::Capture, canvasId, std::move(command));
   
-  if (colorHex.length() > 0 && colorHex[0] == '#') {
-    colorHex = colorHex.substr(1);
-    std::stringstream ss;
-    ss << std::hex << colorHex;
-    ss >> color;
-    
-    if (colorHex.length() == 6) {
-      color = (color << 8) | 0xFF;
-    }
+  return promise;
+}
+
+std::string NativeGestureCanvas::getCanvasThumbnail(jsi::Runtime& rt, int canvasId, int maxWidth) {
+  auto session = findSession(canvasId);
+  if (!session) {
+    return "";
   }
   
-brushEngine->configureBrush(
-  brushStyleData["size"].asNumber(),
-  brushStyleData["opacity"].asNumber(),
-  color, 
-  brushStyleData["texture"].asString(rt).utf8(rt),
-  brushStyleData["dampening"].asNumber(),
-  brushStyleData["fluidResponse"].asNumber()
-);
+  renderThread_->flush();
+  return session->thumbnailAsBase64(maxWidth);
+}
+
+AsyncPromise<std::string> NativeGestureCanvas::exportCanvasToFile(
+  jsi::Runtime& rt,
+  int canvasId,
+  std::string path,
+  std::string format
+) {
+  AsyncPromise<std::string> promise(rt, jsInvoker_);
   
-  int strokeId = nextStrokeId_++;
-  auto stroke = std::make_shared<Stroke>(brushEngine);
+  if (!findSession(canvasId)) {
+    promise.reject(Error("Unknown canvas " + std::to_string(canvasId)));
+    return promise;
+  }
   
-  stroke->addPoint(
-    pointData["x"],
-    pointData["y"],
-    pointData["pressure"],
-    pointData["timestamp"]
-  );
+  ImageFileFormat fileFormat;
+  if (!parseImageFileFormat(format, fileFormat)) {
+    promise.reject(Error("Unsupported export format: " + format));
+    return promise;
+  }
   
-  activeStrokes_[strokeId] = stroke;
-  brushEngines_[strokeId] = brushEngine;
+  RenderCommand command;
+  command.onCapture = [this, promise, path = std::move(path), fileFormat](TileGrid pixels) mutable {
+    snapshotWorker_.post([this, promise, path = std::move(path), fileFormat,
+                          pixels = std::move(pixels)]() mutable {
+      std::string error;
+      bool written;
+      {
+        PerfStats::Scope timing(*perfStats_, PerfOperation::SnapshotEncode);
+        timing.setPixels(static_cast<uint64_t>(pixels.width()) * pixels.height());
+        written = writeImageFile(pixels, path, fileFormat, error);
+      }
+      if (written) {
+        promise.resolve(path);
+      } else {
+        promise.reject(Error(error));
+      }
+    });
+  };
+  submit(RenderCommandType::Capture, canvasId, std::move(command));
   
-  return strokeId;
+  return promise;
 }
 
-void NativeGestureCanvas::addPointToStroke(jsi::Runtime& rt, int canvasId, int strokeId, jsi::Object point) {
-  if (canvases_.find(canvasId) == canvases_.end() || activeStrokes_.find(strokeId) == activeStrokes_.end()) {
-    return;
+AsyncPromise<std::string> NativeGestureCanvas::exportCanvasJournal(jsi::Runtime& rt, int canvasId, std::string path) {
+  AsyncPromise<std::string> promise(rt, jsInvoker_);
+  if (!findSession(canvasId)) {
+    promise.reject(Error("Unknown canvas " + std::to_string(canvasId)));
+    return promise;
   }
   
-  auto pointData = extractPointData(rt, point);
-  
-  auto stroke = activeStrokes_[strokeId];
-  auto prevPoints = stroke->points_;
+  RenderCommand command;
+  command.onJournal = [this, promise, path = std::move(path)](std::vector<uint8_t> journal) mutable {
+    if (journal.empty()) {
+      promise.reject(Error("Canvas was opened from a document saved without its journal"));
+      return;
+    }
+    snapshotWorker_.post([promise, path = std::move(path), journal = std::move(journal)]() mutable {
+      std::string error;
+      if (writeFileAtomically(path, journal.data(), journal.size(), error)) {
+        promise.resolve(path);
+      } else {
+        promise.reject(Error(error));
+      }
+    });
+  };
+  submit(RenderCommandType::CaptureJournal, canvasId, std::move(command));
+  return promise;
+}
+
+AsyncPromise<int> NativeGestureCanvas::replayCanvasJournal(jsi::Runtime& rt, std::string path) {
+  AsyncPromise<int> promise(rt, jsInvoker_);
+  const int canvasId = nextCanvasId_++;
   
-  if (!prevPoints.empty()) {
-    auto [prevX, prevY, prevPressure, prevTimestamp] = prevPoints.back();
-    
-    stroke->addPoint(
-      pointData["x"],
-      pointData["y"],
-      pointData["pressure"],
-      pointData["timestamp"]
-    );
-    
-    auto startTime = std::chrono::high_resolution_clock::now();
+  snapshotWorker_.post([this, promise, canvasId, path = std::move(path)]() mutable {
+    std::vector<uint8_t> journal;
+    std::string error;
+    if (!readWholeFile(path, journal, error)) {
+      promise.reject(Error(error));
+      return;
+    }
     
-    canvases_[canvasId]->applyStrokeLine(
-      prevX, prevY,
-      pointData["x"], pointData["y"],
-      pointData["pressure"],
-      stroke->brushEngine_->size_,
-      stroke->brushEngine_->color_,
-      stroke->brushEngine_->opacity_,
-      stroke->brushEngine_->texture_
-    );
+    JournalReader reader(journal.data(), journal.size());
+    JournalHeader header;
+    if (!reader.readHeader(header)) {
+      promise.reject(Error((reader.unsupportedVersion() ? "Unsupported canvas journal version: "
+                                                        : "Not a canvas journal: ") + path));
+      return;
+    }
     
-    auto endTime = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::milli> renderTime = endTime - startTime;
+    // Applied straight to a session nobody else can reach yet, in chunks
+    // that go through the same (tile-parallel) path as live input
+    auto session = std::make_shared<CanvasSession>(canvasId, header.width, header.height,
+                                                   header.backgroundColor, perfStats_);
+    constexpr size_t kChunkSize = 4096;
+    std::vector<RenderCommand> chunk(kChunkSize);
+    std::vector<RenderCommand*> commands;
+    for (bool more = true; more;) {
+      commands.clear();
+      while (commands.size() < kChunkSize && (more = reader.next(chunk[commands.size()]))) {
+        commands.push_back(&chunk[commands.size()]);
+      }
+      session->apply(commands, rasterWorkers_, UINT64_MAX);
+    }
+    if (reader.failed()) {
+      promise.reject(Error("Corrupt canvas journal: " + path));
+      return;
+    }
     
-    renderTimes_.push_back(renderTime.count());
-    if (renderTimes_.size() > renderTimeHistorySize_) {
-      renderTimes_.erase(renderTimes_.begin());
+    registerOpenedSession(std::move(session), std::move(promise));
+  });
+  return promise;
+}
+
+AsyncPromise<std::string> NativeGestureCanvas::saveCanvasToFile(
+  jsi::Runtime& rt,
+  int canvasId,
+  std::string path,
+  bool includeJournal
+) {
+  AsyncPromise<std::string> promise(rt, jsInvoker_);
+  if (!findSession(canvasId)) {
+    promise.reject(Error("Unknown canvas " + std::to_string(canvasId)));
+    return promise;
+  }
+  
+  RenderCommand command;
+  command.onDocument = [this, promise, path = std::move(path), includeJournal](DocumentCapture capture) mutable {
+    if (!includeJournal) {
+      capture.journal.clear();
     }
+    snapshotWorker_.post([this, promise, path = std::move(path), capture = std::move(capture)]() mutable {
+      std::string error;
+      bool written;
+      {
+        PerfStats::Scope timing(*perfStats_, PerfOperation::SnapshotEncode);
+        timing.setPixels(static_cast<uint64_t>(capture.pixels.width()) * capture.pixels.height());
+        written = CanvasDocument::write(path, capture, rasterWorkers_, error);
+      }
+      if (written) {
+        promise.resolve(path);
+      } else {
+        promise.reject(Error(error));
+      }
+    });
+  };
+  submit(RenderCommandType::CaptureDocument, canvasId, std::move(command));
+  return promise;
+}
+
+AsyncPromise<int> NativeGestureCanvas::openCanvasFromFile(jsi::Runtime& rt, std::string path) {
+  AsyncPromise<int> promise(rt, jsInvoker_);
+  const int canvasId = nextCanvasId_++;
+  
+  snapshotWorker_.post([this, promise, canvasId, path = std::move(path)]() mutable {
+    // Only the header and tile index are read here; tiles decode on first use
+    std::string error;
+    auto document = CanvasDocument::open(path, error);
+    if (!document) {
+      promise.reject(Error(error));
+      return;
+    }
+    registerOpenedSession(std::make_shared<CanvasSession>(canvasId, document, perfStats_), std::move(promise));
+  });
+  return promise;
+}
+
+AsyncPromise<std::string> NativeGestureCanvas::enableAutosave(
+  jsi::Runtime& rt,
+  int canvasId,
+  std::string path,
+  double intervalMs
+) {
+  AsyncPromise<std::string> promise(rt, jsInvoker_);
+  auto session = findSession(canvasId);
+  if (!session) {
+    promise.reject(Error("Unknown canvas " + std::to_string(canvasId)));
+    return promise;
   }
+  
+  autosaver_->enable(std::move(session), path, static_cast<uint64_t>(std::max(intervalMs, 0.0)),
+                     [promise, path](bool ok, const std::string& error) mutable {
+    if (ok) {
+      promise.resolve(path);
+    } else {
+      promise.reject(Error(error));
+    }
+  });
+  return promise;
 }
 
-void NativeGestureCanvas::endStroke(jsi::Runtime& rt, int canvasId, int strokeId, jsi::Object point) {
-  if (activeStrokes_.find(strokeId) != activeStrokes_.end()) {
-    auto pointData = extractPointData(rt, point);
-    
-    activeStrokes_[strokeId]->end(
-      pointData["x"],
-      pointData["y"],
-      pointData["pressure"],
-      pointData["timestamp"]
-    );
+void NativeGestureCanvas::disableAutosave(jsi::Runtime& rt, int canvasId) {
+  autosaver_->disable(canvasId);
+}
+
+AsyncPromise<int> NativeGestureCanvas::recoverCanvasFromAutosave(jsi::Runtime& rt, std::string path) {
+  AsyncPromise<int> promise(rt, jsInvoker_);
+  const int canvasId = nextCanvasId_++;
+  
+  snapshotWorker_.post([this, promise, canvasId, path = std::move(path)]() mutable {
+    std::string error;
+    auto document = Autosaver::recover(path, error);
+    if (!document) {
+      promise.reject(Error(error));
+      return;
+    }
+    registerOpenedSession(std::make_shared<CanvasSession>(canvasId, document, perfStats_), std::move(promise));
+  });
+  return promise;
+}
+
+double NativeGestureCanvas::getAverageRenderTime(jsi::Runtime& rt) {
+  return perfStats_->recentMeanMs(PerfOperation::StrokeRaster);
+}
+
+jsi::Object NativeGestureCanvas::getPerformanceReport(jsi::Runtime& rt) {
+  jsi::Object report(rt);
+  for (int i = 0; i < kPerfOperationCount; ++i) {
+    auto operation = static_cast<PerfOperation>(i);
+    PerfSummary summary = perfStats_->summarize(operation);
     
-    activeStrokes_.erase(strokeId);
-    brushEngines_.erase(strokeId);
+    jsi::Object entry(rt);
+    entry.setProperty(rt, "count", static_cast<double>(summary.count));
+    entry.setProperty(rt, "p50", summary.p50Ms);
+    entry.setProperty(rt, "p95", summary.p95Ms);
+    entry.setProperty(rt, "p99", summary.p99Ms);
+    entry.setProperty(rt, "max", summary.maxMs);
+    entry.setProperty(rt, "mean", summary.meanMs);
+    entry.setProperty(rt, "pixels", static_cast<double>(summary.pixels));
+    entry.setProperty(rt, "pixelsPerOp",
+                      summary.count > 0 ? static_cast<double>(summary.pixels) / summary.count : 0.0);
+    report.setProperty(rt, perfOperationName(operation), std::move(entry));
   }
+  report.setProperty(rt, "shedSegments", static_cast<double>(perfStats_->shedSegments()));
+  return report;
 }
 
-void NativeGestureCanvas::applyMotionToCanvas(
-  jsi::Runtime& rt, 
-  int canvasId, 
-  double accelerationX, 
-  double accelerationY, 
-  double accelerationZ
-) {
-  if (canvases_.find(canvasId) != canvases_.end()) {
-    canvases_[canvasId]->applyPhysics(accelerationX, accelerationY, accelerationZ);
-    
-    for (const auto& [strokeId, brushEngine] : brushEngines_) {
-      brushEngine->simulatePhysics(accelerationX, accelerationY, accelerationZ);
+void NativeGestureCanvas::configureFrameScheduler(jsi::Runtime& rt, std::string mode, double framesPerSecond) {
+  FrameClockMode clockMode;
+  if (!parseFrameClockMode(mode, clockMode)) {
+    throw jsi::JSError(rt, "Unknown frame clock mode " + mode);
+  }
+  frameScheduler_->configure(clockMode, framesPerSecond);
+}
+
+void NativeGestureCanvas::tick(jsi::Runtime& rt) {
+  frameScheduler_->tick();
+}
+
+void NativeGestureCanvas::setRenderListener(jsi::Runtime& rt, AsyncCallback<double, double> listener) {
+  std::lock_guard<std::mutex> lock(listenerMutex_);
+  renderListener_ = std::move(listener);
+}
+
+std::shared_ptr<CanvasSession> NativeGestureCanvas::createSession(jsi::Runtime& rt, const jsi::Object& config) {
+  auto width = static_cast<int>(config.getProperty(rt, "width").asNumber());
+  auto height = static_cast<int>(config.getProperty(rt, "height").asNumber());
+  
+  std::string bgColorHex = config.getProperty(rt, "backgroundColor").asString(rt).utf8(rt);
+  uint32_t bgColor = parseHexColor(bgColorHex, 0xFFFFFFFF);
+  
+  // Ids are never reused, so a stale id can't reach a newer canvas
+  int canvasId = nextCanvasId_++;
+  auto session = std::make_shared<CanvasSession>(canvasId, width, height, bgColor, perfStats_);
+  watchFrameRequests(session);
+  sessions_[canvasId] = session;
+  return session;
+}
+
+void NativeGestureCanvas::watchFrameRequests(const std::shared_ptr<CanvasSession>& session) {
+  session->frameSink()->setFrameRequestHandler(
+    [weakModule = weak_from_this(), weakSession = std::weak_ptr<CanvasSession>(session)] {
+      auto module = weakModule.lock();
+      if (!module) {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(module->frameRequestsMutex_);
+        module->frameRequests_.push_back(weakSession);
+      }
+      // Straight away, paced or not
+      module->renderThread_->tick();
     }
+  );
+}
+
+std::shared_ptr<CanvasSession> NativeGestureCanvas::findSession(int canvasId) {
+  auto it = sessions_.find(canvasId);
+  if (it == sessions_.end()) {
+    return nullptr;
+  }
+  auto session = it->second.lock();
+  if (!session) {
+    // Its handle was disposed or collected
+    sessions_.erase(it);
   }
+  return session;
 }
 
-std::string NativeGestureCanvas::getCanvasSnapshot(jsi::Runtime& rt, int canvasId) {
-  if (canvases_.find(canvasId) != canvases_.end()) {
-    return canvases_[canvasId]->getSnapshotAsBase64();
+std::shared_ptr<Stroke> NativeGestureCanvas::startStroke(
+  jsi::Runtime& rt,
+  const std::shared_ptr<CanvasSession>& session,
+  int& strokeId,
+  const jsi::Object& point,
+  const jsi::Object& brushStyle
+) {
+  RenderCommand command;
+  command.strokeId = strokeId = allocateStrokeId();
+  command.stroke = std::make_shared<Stroke>(resolveBrushPreset(rt, brushStyle));
+  command.point = extractPointData(rt, point);
+  
+  auto stroke = command.stroke;
+  submit(session, RenderCommandType::BeginStroke, std::move(command));
+  return stroke;
+}
+
+void NativeGestureCanvas::registerOpenedSession(std::shared_ptr<CanvasSession> session, AsyncPromise<int> promise) {
+  // Sessions are only registered on the JS thread
+  jsInvoker_->invokeAsync([weakModule = weak_from_this(), session = std::move(session),
+                           promise = std::move(promise)](jsi::Runtime&) mutable {
+    if (auto module = weakModule.lock()) {
+      const int canvasId = session->id();
+      module->watchFrameRequests(session);
+      module->sessions_[canvasId] = session;
+      module->ownedSessions_[canvasId] = std::move(session);
+      promise.resolve(canvasId);
+    }
+  });
+}
+
+void NativeGestureCanvas::submit(RenderCommandType type, int canvasId, RenderCommand&& command) {
+  if (auto session = findSession(canvasId)) {
+    submit(std::move(session), type, std::move(command));
   }
-  return "";
 }
 
-double NativeGestureCanvas::getAverageRenderTime(jsi::Runtime& rt) {
-  if (renderTimes_.empty()) {
-    return 0.0;
+void NativeGestureCanvas::submit(std::shared_ptr<CanvasSession> session, RenderCommandType type, RenderCommand&& command) {
+  command.type = type;
+  command.session = std::move(session);
+  renderThread_->submit(std::move(command));
+  frameScheduler_->wake();
+}
+
+void NativeGestureCanvas::submit(
+  RenderThread::Lane& lane,
+  std::shared_ptr<CanvasSession> session,
+  RenderCommandType type,
+  RenderCommand&& command
+) {
+  command.type = type;
+  command.session = std::move(session);
+  renderThread_->submit(lane, std::move(command));
+  frameScheduler_->wake();
+}
+
+void NativeGestureCanvas::flushRendering() {
+  renderThread_->flush();
+}
+
+void NativeGestureCanvas::applyBatch(std::vector<RenderCommand>& batch) {
+  // Views that just attached get the current image without waiting for an edit
+  std::vector<std::weak_ptr<CanvasSession>> frameRequests;
+  {
+    std::lock_guard<std::mutex> lock(frameRequestsMutex_);
+    frameRequests.swap(frameRequests_);
+  }
+  for (const auto& request : frameRequests) {
+    if (auto session = request.lock()) {
+      session->publishFrame();
+    }
+  }
+  
+  if (batch.empty() && wetSessions_.empty()) {
+    frameScheduler_->reportIdleFrame();
+    return;
+  }
+  auto startTime = std::chrono::high_resolution_clock::now();
+  const uint64_t rasterDeadline = frameScheduler_->rasterDeadline(PerfStats::now());
+  
+  // Canvases with wet paint dry one step per frame, after this frame's
+  // commands for them; sessions destroyed since are dropped
+  wetSteps_.clear();
+  wetSteps_.reserve(wetSessions_.size());
+  for (const auto& wet : wetSessions_) {
+    if (auto session = wet.lock()) {
+      RenderCommand& step = wetSteps_.emplace_back();
+      step.type = RenderCommandType::WetStep;
+      step.session = std::move(session);
+    }
+  }
+  wetSessions_.clear();
+  
+  // Group by session, keeping submission order within each session
+  auto addToGroup = [this](RenderCommand& command) {
+    CanvasSession* session = command.session.get();
+    auto group = std::find_if(batchGroups_.begin(), batchGroups_.end(),
+                              [session](const auto& entry) { return entry.first == session; });
+    if (group == batchGroups_.end()) {
+      batchGroups_.emplace_back(session, std::vector<RenderCommand*>());
+      group = batchGroups_.end() - 1;
+    }
+    group->second.push_back(&command);
+  };
+  for (auto& command : batch) {
+    addToGroup(command);
+  }
+  for (auto& step : wetSteps_) {
+    addToGroup(step);
   }
   
-  double sum = 0.0;
-  for (double time : renderTimes_) {
-    sum += time;
+  renderWorkers_.parallelFor(static_cast<int>(batchGroups_.size()), [this, rasterDeadline](int index) {
+    auto& [session, commands] = batchGroups_[index];
+    session->apply(commands, rasterWorkers_, rasterDeadline);
+  });
+  for (auto& [session, commands] : batchGroups_) {
+    if (session->hasWetPaint()) {
+      wetSessions_.push_back(commands.front()->session);
+    }
   }
+  batchGroups_.clear();
+  wetSteps_.clear();
+  
+  std::chrono::duration<double, std::milli> batchTime =
+    std::chrono::high_resolution_clock::now() - startTime;
   
-  return sum / renderTimes_.size();
+  std::lock_guard<std::mutex> lock(listenerMutex_);
+  if (renderListener_) {
+    renderListener_->call(static_cast<double>(batch.size()), batchTime.count());
+  }
 }
 
-std::unordered_map<std::string, double> NativeGestureCanvas::extractPointData(jsi::Runtime& rt, const jsi::Object& point) {
-  std::unordered_map<std::string, double> data;
-  data["x"] = point.getProperty(rt, "x").asNumber();
-  data["y"] = point.getProperty(rt, "y").asNumber();
-  data["pressure"] = point.getProperty(rt, "pressure").asNumber();
-  data["timestamp"] = point.getProperty(rt, "timestamp").asNumber();
-  return data;
+const PropNameCache& NativeGestureCanvas::propNames(jsi::Runtime& rt) {
+  if (!propNames_ || propNamesRuntime_ != &rt) {
+    propNames_ = std::make_unique<PropNameCache>(rt);
+    propNamesRuntime_ = &rt;
+  }
+  return *propNames_;
+}
+
+PointData NativeGestureCanvas::extractPointData(jsi::Runtime& rt, const jsi::Object& point) {
+  PerfStats::Scope timing(*perfStats_, PerfOperation::JsiMarshal);
+  return readPointData(rt, propNames(rt), point);
 }
 
-std::unordered_map<std::string, jsi::Value> NativeGestureCanvas::extractBrushStyleData(jsi::Runtime& rt, const jsi::Object& brushStyle) {
-  std::unordered_map<std::string, jsi::Value> data;
-  data["size"] = brushStyle.getProperty(rt, "size");
-  data["opacity"] = brushStyle.getProperty(rt, "opacity");
-  data["color"] = brushStyle.getProperty(rt, "color");
-  data["texture"] = brushStyle.getProperty(rt, "texture");
-  data["dampening"] = brushStyle.getProperty(rt, "dampening");
-  data["fluidResponse"] = brushStyle.getProperty(rt, "fluidResponse");
-  return data;
+BrushStyleData NativeGestureCanvas::extractBrushStyleData(jsi::Runtime& rt, const jsi::Object& brushStyle) {
+  PerfStats::Scope timing(*perfStats_, PerfOperation::JsiMarshal);
+  return readBrushStyleData(rt, propNames(rt), brushStyle);
+}
+
+std::shared_ptr<const BrushPreset> NativeGestureCanvas::resolveBrushPreset(jsi::Runtime& rt, const jsi::Object& brushStyle) {
+  if (brushStyle.isHostObject<BrushStyleHandle>(rt)) {
+    return brushStyle.getHostObject<BrushStyleHandle>(rt)->preset();
+  }
+  return std::make_shared<BrushPreset>(extractBrushStyleData(rt, brushStyle));
 }
 
 } // namespace facebook::react
\ No newline at end of file
@@ -1,17 +1,25 @@
 #pragma once
 
 #include <AppSpecsJSI.h>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 #include <unordered_map>
-#include "Canvas.h"
-#include "BrushEngine.h"
-#include "Stroke.h"
+#include "Autosaver.h"
+#include "CanvasSession.h"
+#include "CanvasTypes.h"
+#include "FrameScheduler.h"
+#include "JsiConversions.h"
+#include "RenderThread.h"
+#include "WorkerPool.h"
 
 namespace facebook::react {
 
-class NativeGestureCanvas : public NativeGestureCanvasCxxSpec<NativeGestureCanvas> {
+class NativeGestureCanvas : public NativeGestureCanvasCxxSpec<NativeGestureCanvas>,
+                            public std::enable_shared_from_this<NativeGestureCanvas> {
 public:
   NativeGestureCanvas(std::shared_ptr<CallInvoker> jsInvoker);
   ~NativeGestureCanvas();
@@ -19,14 +27,51 @@ public:
   // Canvas management
   int createCanvas(jsi::Runtime& rt, jsi::Object config);
   void destroyCanvas(jsi::Runtime& rt, int canvasId);
+  
+  // Same as createCanvas but returns a CanvasHandle host object that holds
+  // the session directly; released by dispose() or garbage collection
+  jsi::Object createCanvasHandle(jsi::Runtime& rt, jsi::Object config);
+  
+  // GestureInput host object for feeding strokes from the UI worklet runtime
+  jsi::Object createGestureInput(jsi::Runtime& rt, int canvasId, jsi::Object brushStyle);
   void clearCanvas(jsi::Runtime& rt, int canvasId);
+  // Paint bucket on the active layer from (x, y), in the same pixels as
+  // stroke points. tolerance (0-1) is the largest channel difference from
+  // the seed pixel still filled.
+  void floodFill(jsi::Runtime& rt, int canvasId, double x, double y, std::string color, double tolerance);
   
-  // Stroke handling
+  // Stroke handling. brushStyle may be a style object or a handle from
+  // registerBrushStyle, which resolves the style once up front.
+  jsi::Object registerBrushStyle(jsi::Runtime& rt, jsi::Object brushStyle);
+  // Grayscale tip or grain for a texture (see BrushTextureAtlas.h); pixels
+  // is an ArrayBuffer or typed array of width * height bytes
+  void registerBrushTexture(jsi::Runtime& rt, std::string texture, std::string kind, int width, int height, jsi::Object pixels);
   int beginStroke(jsi::Runtime& rt, int canvasId, jsi::Object point, jsi::Object brushStyle);
   void addPointToStroke(jsi::Runtime& rt, int canvasId, int strokeId, jsi::Object point);
   void endStroke(jsi::Runtime& rt, int canvasId, int strokeId, jsi::Object point);
   
   // Motion impact
+  // Undo/redo the last stroke group, clear or run of physics steps. Queued
+  // behind the strokes already submitted.
+  void undo(jsi::Runtime& rt, int canvasId);
+  void redo(jsi::Runtime& rt, int canvasId);
+  void setUndoBudget(jsi::Runtime& rt, int canvasId, double bytes);
+  
+  // Redraws the canvas from its strokes at a new size, off the render
+  // thread; until then the pixels are filtered to the size. Points and
+  // brush sizes that follow are in pixels at scale. Strokes still down end here.
+  void setCanvasSize(jsi::Runtime& rt, int canvasId, double width, double height, double scale);
+  // Crops/pads ("crop") or filters ("bilinear", "area") the pixels and fluid
+  // to a new size. Drawing carries on unscaled.
+  void resizeCanvas(jsi::Runtime& rt, int canvasId, double width, double height, std::string mode);
+  
+  // Layers (see LayerStack.h): 0 is the base and each new one goes on top.
+  // Commands naming a layer that doesn't exist are ignored.
+  void addLayer(jsi::Runtime& rt, int canvasId);
+  void setLayerProperties(jsi::Runtime& rt, int canvasId, int layer, double opacity, bool visible, std::string blendMode);
+  void setActiveLayer(jsi::Runtime& rt, int canvasId, int layer);
+  void setWetLayer(jsi::Runtime& rt, int canvasId, int layer);
+  
   void applyMotionToCanvas(
     jsi::Runtime& rt, 
     int canvasId, 
@@ -37,25 +82,128 @@ public:
   
   // Canvas rendering
   std::string getCanvasSnapshot(jsi::Runtime& rt, int canvasId);
+  AsyncPromise<std::string> getCanvasSnapshotAsync(jsi::Runtime& rt, int canvasId);
+  std::string getCanvasThumbnail(jsi::Runtime& rt, int canvasId, int maxWidth);
+  
+  // Streams the canvas to a file off the JS thread; resolves with the path
+  AsyncPromise<std::string> exportCanvasToFile(jsi::Runtime& rt, int canvasId, std::string path, std::string format);
+  
+  // Binary stroke journal (see CanvasJournal.h). Replaying one rebuilds the
+  // canvas bit for bit as a new canvas owned by the module.
+  AsyncPromise<std::string> exportCanvasJournal(jsi::Runtime& rt, int canvasId, std::string path);
+  AsyncPromise<int> replayCanvasJournal(jsi::Runtime& rt, std::string path);
+  
+  // Native document (see CanvasDocument.h). Opening maps the file and
+  // resolves with a new canvas before any tile is decoded.
+  AsyncPromise<std::string> saveCanvasToFile(jsi::Runtime& rt, int canvasId, std::string path, bool includeJournal);
+  AsyncPromise<int> openCanvasFromFile(jsi::Runtime& rt, std::string path);
+  
+  // Autosave (see Autosaver.h). Enabling resolves once the first checkpoint
+  // is on disk; recovering opens the latest checkpoint as a new canvas.
+  AsyncPromise<std::string> enableAutosave(jsi::Runtime& rt, int canvasId, std::string path, double intervalMs);
+  void disableAutosave(jsi::Runtime& rt, int canvasId);
+  AsyncPromise<int> recoverCanvasFromAutosave(jsi::Runtime& rt, std::string path);
   
   // Performance metrics
   double getAverageRenderTime(jsi::Runtime& rt);
+  
+  // { [operation]: { count, p50, p95, p99, max, mean, pixels, pixelsPerOp } }, times in ms
+  jsi::Object getPerformanceReport(jsi::Runtime& rt);
+  
+  // Paces rendering to display frames: mode is "immediate" (the default),
+  // "native" (own clock at framesPerSecond), "manual" (driven by tick()) or
+  // "display" (driven by the display link of the views showing canvases)
+  void configureFrameScheduler(jsi::Runtime& rt, std::string mode, double framesPerSecond);
+  void tick(jsi::Runtime& rt);
+  
+  // Called on the JS thread after each batch the render thread applies
+  void setRenderListener(jsi::Runtime& rt, AsyncCallback<double, double> listener);
+  
+  // Shared by the id-based methods above and the JSI handles
+  PointData extractPointData(jsi::Runtime& rt, const jsi::Object& point);
+  BrushStyleData extractBrushStyleData(jsi::Runtime& rt, const jsi::Object& brushStyle);
+  // A registered handle's preset as is, or a new one read from a style object
+  std::shared_ptr<const BrushPreset> resolveBrushPreset(jsi::Runtime& rt, const jsi::Object& brushStyle);
+  std::shared_ptr<Stroke> startStroke(
+    jsi::Runtime& rt,
+    const std::shared_ptr<CanvasSession>& session,
+    int& strokeId,
+    const jsi::Object& point,
+    const jsi::Object& brushStyle
+  );
+  void submit(std::shared_ptr<CanvasSession> session, RenderCommandType type, RenderCommand&& command);
+  void flushRendering();
+  // Resize command with out-of-range arguments clamped
+  static RenderCommand makeResizeCommand(double width, double height, double scale);
+  
+  // Safe from any thread
+  int allocateStrokeId() { return nextStrokeId_.fetch_add(1, std::memory_order_relaxed); }
+  void submit(RenderThread::Lane& lane, std::shared_ptr<CanvasSession> session, RenderCommandType type, RenderCommand&& command);
 
 private:
   // Utility methods for converting between JSI and C++ types
-  std::unordered_map<std::string, double> extractPointData(jsi::Runtime& rt, const jsi::Object& point);
-  std::unordered_map<std::string, jsi::Value> extractBrushStyleData(jsi::Runtime& rt, const jsi::Object& brushStyle);
+  const PropNameCache& propNames(jsi::Runtime& rt);
+  
+  std::shared_ptr<CanvasSession> createSession(jsi::Runtime& rt, const jsi::Object& config);
+  std::shared_ptr<CanvasSession> findSession(int canvasId);
+  // Registers a session built off the JS thread and resolves with its id
+  void registerOpenedSession(std::shared_ptr<CanvasSession> session, AsyncPromise<int> promise);
+  void submit(RenderCommandType type, int canvasId, RenderCommand&& command);
+  // Has the render thread publish a session's image once a view attaches to it
+  void watchFrameRequests(const std::shared_ptr<CanvasSession>& session);
+  
+  // Render thread side: splits a batch by session and applies each in parallel
+  void applyBatch(std::vector<RenderCommand>& batch);
+  
+  // JS thread only, unsynchronized. Created on first use; rebuilt if the
+  // module is ever called from another runtime.
+  std::unique_ptr<PropNameCache> propNames_;
+  jsi::Runtime* propNamesRuntime_ = nullptr;
   
-  // Internal state
-  std::unordered_map<int, std::shared_ptr<Canvas>> canvases_;
-  std::unordered_map<int, std::shared_ptr<BrushEngine>> brushEngines_;
-  std::unordered_map<int, std::shared_ptr<Stroke>> activeStrokes_;
+  // Only touched on the JS thread. Every canvas is reachable by id, but only
+  // those made by createCanvas are owned here; handle canvases live as long
+  // as their handle. Queued commands hold their own reference, so destroying
+  // a canvas never pulls a session out from under a worker.
+  std::unordered_map<int, std::weak_ptr<CanvasSession>> sessions_;
+  std::unordered_map<int, std::shared_ptr<CanvasSession>> ownedSessions_;
   
   int nextCanvasId_ = 1;
-  int nextStrokeId_ = 1;
+  std::atomic<int> nextStrokeId_{1}; // Also drawn from on the UI thread
+  
+  // Shared with every session; recording is lock-free
+  std::shared_ptr<PerfStats> perfStats_ = std::make_shared<PerfStats>();
+  
+  std::mutex listenerMutex_;
+  std::optional<AsyncCallback<double, double>> renderListener_;
+  
+  // Rasterizes independent canvases from the same batch side by side
+  WorkerPool renderWorkers_{2};
+  
+  // Tile-parallel raster for concurrent strokes on one canvas
+  WorkerPool rasterWorkers_{3};
+  std::vector<std::pair<CanvasSession*, std::vector<RenderCommand*>>> batchGroups_;
+  
+  // Render thread only: canvases left wet by the last batch, and the
+  // WetStep commands made for them
+  std::vector<std::weak_ptr<CanvasSession>> wetSessions_;
+  std::vector<RenderCommand> wetSteps_;
+  
+  // Canvases whose frame sink just got a consumer; filled from the view's thread
+  std::mutex frameRequestsMutex_;
+  std::vector<std::weak_ptr<CanvasSession>> frameRequests_; // Guarded by frameRequestsMutex_
+  
+  // Background encoding, file IO and journal replay; drains before the
+  // pools and stats it uses are torn down
+  WorkerPool snapshotWorker_{1};
+  
+  // Stroke and physics commands are applied here, off the JS thread
+  std::unique_ptr<RenderThread> renderThread_;
+  
+  // Wakes renderThread_ once per frame and sets the raster budget
+  std::unique_ptr<FrameScheduler> frameScheduler_;
   
-  std::vector<double> renderTimes_;
-  int renderTimeHistorySize_ = 60; // Keep last 60 render times for averaging
+  // Periodic dirty-tile checkpoints; captures go through its own lane
+  std::unique_ptr<Autosaver> autosaver_;
 };
 
-} // namespace facebook::react
\ No newline at end of file
+} // namespace facebook::react
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CommandQueue.h"
+
+namespace facebook::react {
+
+// Dedicated thread that drains render commands. Every producer thread gets
+// its own lock-free lane; each wake-up empties all lanes into a batch (in
+// submission order per lane) and hands it to the batch handler, which
+// applies it and publishes frames. It wakes on every submit, or once per
+// frame tick when paced; the handler gets every tick, empty batch or not,
+// so per-frame work keeps going between inputs.
+class RenderThread {
+public:
+  static constexpr size_t kQueueCapacity = 4096;
+  using Lane = SpscQueue<RenderCommand, kQueueCapacity>;
+  using BatchHandler = std::function<void(std::vector<RenderCommand>& batch)>;
+
+  explicit RenderThread(BatchHandler onBatch);
+  ~RenderThread();
+
+  RenderThread(const RenderThread&) = delete;
+  RenderThread& operator=(const RenderThread&) = delete;
+
+  // Submits on the default lane, which belongs to the JS thread
+  void submit(RenderCommand&& command);
+
+  // Extra lanes for other producer threads (e.g. the UI thread). A lane must
+  // only ever be written from one thread; it is dropped once its owner
+  // releases it and it has been drained.
+  std::shared_ptr<Lane> createLane();
+  void submit(Lane& lane, RenderCommand&& command);
+
+  // Blocks until every command submitted so far has been applied
+  void flush();
+  // Commands submitted but not yet handed to the batch handler
+  bool hasPending() const {
+    return processed_.load(std::memory_order_acquire) < submitted_.load(std::memory_order_relaxed);
+  }
+
+  // When paced, submitting no longer wakes the thread; queued commands are
+  // applied together on the next tick() (or flush()), one batch per frame
+  void setPaced(bool paced);
+  void tick();
+
+private:
+  void run();
+  size_t drain(Lane& lane, std::vector<RenderCommand>& batch, bool& stopping);
+  void wake();
+
+  BatchHandler onBatch_;
+  std::shared_ptr<Lane> defaultLane_;
+
+  std::mutex lanesMutex_;
+  std::vector<std::shared_ptr<Lane>> lanes_; // Guarded by lanesMutex_
+  std::atomic<bool> lanesChanged_{false};
+
+  std::atomic<uint64_t> submitted_{0};
+  std::atomic<uint64_t> processed_{0};
+  std::atomic<uint64_t> wakeups_{0};
+  std::atomic<bool> paced_{false};
+  std::thread thread_;
+};
+
+} // namespace facebook::react
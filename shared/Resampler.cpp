@@ -0,0 +1,190 @@
+#include "Resampler.h"
+#include <algorithm>
+#include <cstring>
+#include "PixelKernels.h"
+#include "WorkerPool.h"
+
+namespace facebook::react {
+
+bool parseResampleMode(std::string_view name, ResampleMode& mode) {
+  if (name == "crop") {
+    mode = ResampleMode::Crop;
+  } else if (name == "bilinear") {
+    mode = ResampleMode::Bilinear;
+  } else if (name == "area") {
+    mode = ResampleMode::Area;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+FilterTaps FilterTaps::build(int sourceSize, int targetSize, ResampleMode mode) {
+  FilterTaps filter;
+  filter.starts.resize(targetSize);
+  
+  // Positions are measured in 1/(sourceSize * targetSize) of the canvas so
+  // every boundary is an integer: source pixel j spans [j * T, (j + 1) * T)
+  // and output pixel i spans [i * S, (i + 1) * S)
+  const int64_t S = sourceSize;
+  const int64_t T = targetSize;
+  
+  if (mode == ResampleMode::Bilinear) {
+    filter.taps = std::min(sourceSize, 2);
+    filter.weights.resize(static_cast<size_t>(targetSize) * filter.taps);
+    for (int i = 0; i < targetSize; ++i) {
+      int16_t* w = filter.weights.data() + static_cast<size_t>(i) * filter.taps;
+      if (filter.taps == 1) {
+        filter.starts[i] = 0;
+        w[0] = kFilterOne;
+        continue;
+      }
+      // Output centre in source pixels, fixed point, measured from the
+      // first source centre
+      const int64_t position = ((2 * i + 1) * S * kFilterOne) / (2 * T) - kFilterOne / 2;
+      int64_t start = position >> kFilterShift;
+      int64_t fraction = position - (start << kFilterShift);
+      if (start < 0) {
+        start = 0;
+        fraction = 0;
+      } else if (start >= S - 1) {
+        start = S - 2;
+        fraction = kFilterOne;
+      }
+      filter.starts[i] = static_cast<int>(start);
+      w[0] = static_cast<int16_t>(kFilterOne - fraction);
+      w[1] = static_cast<int16_t>(fraction);
+    }
+    return filter;
+  }
+  
+  // Area: each output weighs the source pixels under its footprint by
+  // coverage. Weights come from rounding the running coverage, so they add
+  // up to exactly kFilterOne with no one weight off by more than 1.
+  int taps = 1;
+  for (int i = 0; i < targetSize; ++i) {
+    const int64_t first = (i * S) / T;
+    const int64_t last = ((i + 1) * S - 1) / T;
+    taps = std::max(taps, static_cast<int>(last - first + 1));
+  }
+  filter.taps = std::min(taps, sourceSize);
+  filter.weights.assign(static_cast<size_t>(targetSize) * filter.taps, 0);
+  for (int i = 0; i < targetSize; ++i) {
+    const int64_t begin = i * S;
+    const int64_t end = (i + 1) * S;
+    const int64_t first = begin / T;
+    const int64_t last = (end - 1) / T;
+    const int start = std::min(static_cast<int>(first), sourceSize - filter.taps);
+    filter.starts[i] = start;
+    int16_t* w = filter.weights.data() + static_cast<size_t>(i) * filter.taps;
+    int64_t covered = 0;
+    int64_t previous = 0;
+    for (int64_t j = first; j <= last; ++j) {
+      covered += std::min((j + 1) * T, end) - std::max(j * T, begin);
+      const int64_t rounded = (covered * kFilterOne + S / 2) / S;
+      w[j - start] = static_cast<int16_t>(rounded - previous);
+      previous = rounded;
+    }
+  }
+  return filter;
+}
+
+void resamplePlane(int sourceWidth, int sourceHeight, int targetWidth, int targetHeight,
+                   ResampleMode mode, WorkerPool& workers,
+                   const std::function<void(int y, uint32_t* row)>& readRow,
+                   const std::function<void(int y, const uint32_t* row)>& writeRow) {
+  const FilterTaps horizontal = FilterTaps::build(sourceWidth, targetWidth, mode);
+  const FilterTaps vertical = FilterTaps::build(sourceHeight, targetHeight, mode);
+  
+  // Whichever pass shrinks its axis goes first, so the second pass works on
+  // fewer pixels; the order only depends on the sizes, so the result is
+  // still fixed for a given pair of sizes
+  const bool verticalFirst = static_cast<int64_t>(targetHeight) * sourceWidth <
+                             static_cast<int64_t>(sourceHeight) * targetWidth;
+  
+  const int bands = (targetHeight + kTileSize - 1) / kTileSize;
+  workers.parallelFor(bands, [&](int band) {
+    const int y0 = band * kTileSize;
+    const int y1 = std::min(y0 + kTileSize, targetHeight);
+    
+    // Starts only move forward, so the band reads one contiguous run of
+    // source rows; neighbouring bands read the rows they share twice
+    const int firstRow = vertical.starts[y0];
+    const int endRow = vertical.starts[y1 - 1] + vertical.taps;
+    const int rowWidth = verticalFirst ? sourceWidth : targetWidth;
+    std::vector<uint32_t> rowBuffer(sourceWidth);
+    std::vector<uint32_t> bandRows(static_cast<size_t>(endRow - firstRow) * rowWidth);
+    for (int y = firstRow; y < endRow; ++y) {
+      uint32_t* row = bandRows.data() + static_cast<size_t>(y - firstRow) * rowWidth;
+      if (verticalFirst) {
+        readRow(y, row);
+      } else {
+        readRow(y, rowBuffer.data());
+        filterRow(rowBuffer.data(), row, targetWidth,
+                  horizontal.starts.data(), horizontal.weights.data(), horizontal.taps);
+      }
+    }
+    
+    std::vector<const uint32_t*> rows(vertical.taps);
+    std::vector<uint32_t> out(targetWidth);
+    for (int y = y0; y < y1; ++y) {
+      for (int k = 0; k < vertical.taps; ++k) {
+        rows[k] = bandRows.data() + static_cast<size_t>(vertical.starts[y] + k - firstRow) * rowWidth;
+      }
+      const int16_t* weights = vertical.weights.data() + static_cast<size_t>(y) * vertical.taps;
+      if (verticalFirst) {
+        filterColumns(rows.data(), weights, vertical.taps, rowBuffer.data(), sourceWidth);
+        filterRow(rowBuffer.data(), out.data(), targetWidth,
+                  horizontal.starts.data(), horizontal.weights.data(), horizontal.taps);
+      } else {
+        filterColumns(rows.data(), weights, vertical.taps, out.data(), targetWidth);
+      }
+      writeRow(y, out.data());
+    }
+  });
+}
+
+void resampleGrid(const TileGrid& source, TileGrid& target, ResampleMode mode, WorkerPool& workers) {
+  // The first touch of a document-backed tile loads it, which must not
+  // happen on two threads at once; one tile per task keeps that true
+  workers.parallelFor(source.tileCount(), [&](int index) { source.tile(index); });
+  
+  resamplePlane(
+    source.width(), source.height(), target.width(), target.height(), mode, workers,
+    [&](int y, uint32_t* row) { source.copyRow(y, row); },
+    [&](int y, const uint32_t* row) {
+      for (int x = 0; x < target.width(); x += kTileSize) {
+        const int count = std::min(kTileSize, target.width() - x);
+        std::memcpy(target.mutableSpan(x, y), row + x, count * sizeof(uint32_t));
+      }
+    });
+}
+
+void resampleFluid(const std::vector<uint8_t>& source, int sourceWidth, int sourceHeight,
+                   std::vector<uint8_t>& target, int targetWidth, int targetHeight,
+                   ResampleMode mode, WorkerPool& workers) {
+  target.assign(static_cast<size_t>(targetWidth) * targetHeight * 2, 0);
+  // Usually nothing is moving
+  if (std::all_of(source.begin(), source.end(), [](uint8_t value) { return value == 0; })) {
+    return;
+  }
+  
+  // Widened to one pixel per velocity pair so the pixel kernels apply
+  resamplePlane(
+    sourceWidth, sourceHeight, targetWidth, targetHeight, mode, workers,
+    [&](int y, uint32_t* row) {
+      const uint8_t* in = source.data() + static_cast<size_t>(y) * sourceWidth * 2;
+      for (int x = 0; x < sourceWidth; ++x) {
+        row[x] = in[x * 2] | (in[x * 2 + 1] << 8);
+      }
+    },
+    [&](int y, const uint32_t* row) {
+      uint8_t* out = target.data() + static_cast<size_t>(y) * targetWidth * 2;
+      for (int x = 0; x < targetWidth; ++x) {
+        out[x * 2] = row[x] & 0xFF;
+        out[x * 2 + 1] = (row[x] >> 8) & 0xFF;
+      }
+    });
+}
+
+} // namespace facebook::react
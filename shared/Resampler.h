@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+#include "TileGrid.h"
+
+namespace facebook::react {
+
+class WorkerPool;
+
+enum class ResampleMode : uint8_t {
+  Crop, // Keeps pixels where they are, padding with background
+  Bilinear,
+  Area, // Box filter over each output pixel's footprint; best for shrinking
+};
+
+bool parseResampleMode(std::string_view name, ResampleMode& mode);
+
+// Fixed-point filter for one axis: output i weighs `taps` source samples
+// from starts[i]. Starts are clamped so every tap lies inside the source.
+struct FilterTaps {
+  int taps = 0;
+  std::vector<int> starts;
+  std::vector<int16_t> weights; // taps per output, summing to kFilterOne
+
+  static FilterTaps build(int sourceSize, int targetSize, ResampleMode mode);
+};
+
+// Separable resample of a whole plane: a horizontal and a vertical pass,
+// in whichever order touches fewer pixels, with bands of kTileSize output
+// rows spread over workers. Filter positions are integer, so the
+// result is the same on every device.
+//
+// Rows are read and written through callbacks; bands never share an
+// output row, and reads must be safe from several workers at once.
+void resamplePlane(int sourceWidth, int sourceHeight, int targetWidth, int targetHeight,
+                   ResampleMode mode, WorkerPool& workers,
+                   const std::function<void(int y, uint32_t* row)>& readRow,
+                   const std::function<void(int y, const uint32_t* row)>& writeRow);
+
+// target must already have the output size. Filters Bilinear or Area.
+void resampleGrid(const TileGrid& source, TileGrid& target, ResampleMode mode, WorkerPool& workers);
+
+// Fluid velocities (two bytes per pixel in row order), filtered like pixels
+void resampleFluid(const std::vector<uint8_t>& source, int sourceWidth, int sourceHeight,
+                   std::vector<uint8_t>& target, int targetWidth, int targetHeight,
+                   ResampleMode mode, WorkerPool& workers);
+
+} // namespace facebook::react
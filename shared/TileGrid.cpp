@@ -0,0 +1,113 @@
+#include "TileGrid.h"
+#include <algorithm>
+#include <cstring>
+
+namespace facebook::react {
+
+TileGrid::TileGrid(int width, int height, uint32_t fillColor)
+    : width_(std::max(width, 0)), height_(std::max(height, 0)) {
+  tilesX_ = (width_ + kTileSize - 1) / kTileSize;
+  tilesY_ = (height_ + kTileSize - 1) / kTileSize;
+  tiles_.resize(tilesX_ * tilesY_);
+  tileGenerations_.resize(tiles_.size(), 0);
+  fill(fillColor);
+}
+
+TileGrid::TileGrid(int width, int height, TileLoader loader)
+    : width_(std::max(width, 0)), height_(std::max(height, 0)), loader_(std::move(loader)) {
+  tilesX_ = (width_ + kTileSize - 1) / kTileSize;
+  tilesY_ = (height_ + kTileSize - 1) / kTileSize;
+  tiles_.resize(tilesX_ * tilesY_);
+  // Loaded content counts as written, so generation-based consumers pick it up
+  tileGenerations_.resize(tiles_.size(), 1);
+  generation_ = 1;
+}
+
+TileGrid::TileGrid(const TileGrid& other)
+    : width_(other.width_), height_(other.height_),
+      tilesX_(other.tilesX_), tilesY_(other.tilesY_),
+      tiles_(other.tiles_), loader_(other.loader_), tileGenerations_(other.tileGenerations_),
+      generation_(other.generation()) {}
+
+TileGrid::TileGrid(TileGrid&& other) noexcept
+    : width_(other.width_), height_(other.height_),
+      tilesX_(other.tilesX_), tilesY_(other.tilesY_),
+      tiles_(std::move(other.tiles_)), loader_(std::move(other.loader_)), tileGenerations_(std::move(other.tileGenerations_)),
+      generation_(other.generation()) {}
+
+TileGrid& TileGrid::operator=(const TileGrid& other) {
+  if (this != &other) {
+    *this = TileGrid(other);
+  }
+  return *this;
+}
+
+TileGrid& TileGrid::operator=(TileGrid&& other) noexcept {
+  width_ = other.width_;
+  height_ = other.height_;
+  tilesX_ = other.tilesX_;
+  tilesY_ = other.tilesY_;
+  tiles_ = std::move(other.tiles_);
+  loader_ = std::move(other.loader_);
+  tileGenerations_ = std::move(other.tileGenerations_);
+  generation_.store(other.generation(), std::memory_order_relaxed);
+  return *this;
+}
+
+void TileGrid::fill(uint32_t color) {
+  // Every tile points at the same solid tile until it is first written to
+  auto solid = std::make_shared<PixelTile>();
+  solid->pixels.fill(color);
+  std::fill(tiles_.begin(), tiles_.end(), solid);
+  loader_ = nullptr;
+  std::fill(tileGenerations_.begin(), tileGenerations_.end(), generation_.fetch_add(1) + 1);
+}
+
+void TileGrid::resize(int width, int height, uint32_t color) {
+  width_ = std::max(width, 0);
+  height_ = std::max(height, 0);
+  tilesX_ = (width_ + kTileSize - 1) / kTileSize;
+  tilesY_ = (height_ + kTileSize - 1) / kTileSize;
+  tiles_.assign(tilesX_ * tilesY_, nullptr);
+  tileGenerations_.assign(tiles_.size(), 0);
+  fill(color);
+}
+
+uint32_t* TileGrid::mutableTile(int index) {
+  auto& tile = tiles_[index];
+  if (!tile) {
+    tile = loader_(index);
+  }
+  if (tile.use_count() > 1 || tile->cached) {
+    tile = std::make_shared<PixelTile>(*tile);
+    tile->cached = false;
+  }
+  tileGenerations_[index] = generation_.fetch_add(1, std::memory_order_relaxed) + 1;
+  return tile->pixels.data();
+}
+
+std::shared_ptr<PixelTile> TileGrid::exchangeTile(int index, std::shared_ptr<PixelTile> tile) {
+  tileGenerations_[index] = generation_.fetch_add(1, std::memory_order_relaxed) + 1;
+  slot(index);
+  tiles_[index].swap(tile);
+  return tile;
+}
+
+void TileGrid::copyRow(int y, uint32_t* out) const {
+  for (int x = 0; x < width_; x += kTileSize) {
+    int count = std::min(kTileSize, width_ - x);
+    std::memcpy(out + x, span(x, y), count * sizeof(uint32_t));
+  }
+}
+
+std::vector<int> TileGrid::tilesChangedSince(uint64_t generation) const {
+  std::vector<int> changed;
+  for (int i = 0; i < tileCount(); ++i) {
+    if (tileGenerations_[i] > generation) {
+      changed.push_back(i);
+    }
+  }
+  return changed;
+}
+
+} // namespace facebook::react
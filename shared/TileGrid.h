@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace facebook::react {
+
+constexpr int kTileSize = 64;
+constexpr int kTileShift = 6;
+constexpr int kTilePixels = kTileSize * kTileSize;
+
+struct PixelTile {
+  std::array<uint32_t, kTilePixels> pixels;
+  // Also reachable from a cache that must keep handing out the original
+  // (e.g. a document's decoded tiles), so it is copied on the first write
+  // even when only one grid holds it
+  bool cached = false;
+};
+
+// Supplies the content of a tile that has not been loaded yet. Must be safe
+// to call from any thread and return the same content every time.
+using TileLoader = std::function<std::shared_ptr<PixelTile>(int index)>;
+
+// Pixel plane split into fixed-size tiles that are shared copy-on-write.
+// Copying a TileGrid only copies tile pointers, so a capture of the whole
+// canvas is cheap; the first write to a shared tile detaches it.
+//
+// A grid can also start out backed by a loader (e.g. a saved document), in
+// which case each tile is fetched the first time it is touched. Fetching
+// fills the slot, so the threading rule for writes applies to first reads
+// too: concurrent threads must stick to different tiles.
+class TileGrid {
+public:
+  TileGrid(int width, int height, uint32_t fillColor);
+  TileGrid(int width, int height, TileLoader loader);
+  TileGrid(const TileGrid& other);
+  TileGrid(TileGrid&& other) noexcept;
+  TileGrid& operator=(const TileGrid& other);
+  TileGrid& operator=(TileGrid&& other) noexcept;
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  int tilesX() const { return tilesX_; }
+  int tilesY() const { return tilesY_; }
+  int tileCount() const { return static_cast<int>(tiles_.size()); }
+
+  void fill(uint32_t color);
+  // Changes the dimensions and fills with color. Generations keep counting
+  // up, so consumers still see every tile as changed.
+  void resize(int width, int height, uint32_t color);
+
+  uint32_t pixel(int x, int y) const {
+    return slot(tileIndexAt(x, y))->pixels[offsetInTile(x, y)];
+  }
+  void setPixel(int x, int y, uint32_t color) {
+    mutableTile(tileIndexAt(x, y))[offsetInTile(x, y)] = color;
+  }
+
+  // Pointer to (x, y); valid for pixels up to the right edge of its tile.
+  const uint32_t* span(int x, int y) const {
+    return slot(tileIndexAt(x, y))->pixels.data() + offsetInTile(x, y);
+  }
+  uint32_t* mutableSpan(int x, int y) {
+    return mutableTile(tileIndexAt(x, y)) + offsetInTile(x, y);
+  }
+  static int spanEnd(int x) { return (x | (kTileSize - 1)) + 1; }
+
+  const uint32_t* tile(int index) const { return slot(index)->pixels.data(); }
+  std::shared_ptr<PixelTile> tileRef(int index) const { return slot(index); }
+
+  // Puts tile in place of the one at index and returns the old one
+  std::shared_ptr<PixelTile> exchangeTile(int index, std::shared_ptr<PixelTile> tile);
+
+  // Safe to call concurrently as long as each thread writes different tiles
+  uint32_t* mutableTile(int index);
+
+  // Copies one row of pixels into a contiguous buffer of width() entries.
+  void copyRow(int y, uint32_t* out) const;
+
+  // Every write bumps a grid-wide counter and stamps the tile with it, so
+  // consumers can find tiles changed since a generation they last saw.
+  uint64_t generation() const { return generation_.load(std::memory_order_relaxed); }
+  uint64_t tileGeneration(int index) const { return tileGenerations_[index]; }
+  std::vector<int> tilesChangedSince(uint64_t generation) const;
+
+  int tileIndexAt(int x, int y) const {
+    return (y >> kTileShift) * tilesX_ + (x >> kTileShift);
+  }
+  static int offsetInTile(int x, int y) {
+    return ((y & (kTileSize - 1)) << kTileShift) | (x & (kTileSize - 1));
+  }
+
+private:
+  const std::shared_ptr<PixelTile>& slot(int index) const {
+    auto& tile = tiles_[index];
+    if (!tile) [[unlikely]] {
+      tile = loader_(index);
+    }
+    return tile;
+  }
+
+  int width_;
+  int height_;
+  int tilesX_;
+  int tilesY_;
+  mutable std::vector<std::shared_ptr<PixelTile>> tiles_; // Null until loaded
+  TileLoader loader_; // Dropped by fill(), which replaces every tile
+  std::vector<uint64_t> tileGenerations_;
+  std::atomic<uint64_t> generation_{0};
+};
+
+} // namespace facebook::react
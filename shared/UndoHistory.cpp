@@ -0,0 +1,210 @@
+#include "UndoHistory.h"
+#include <algorithm>
+#include "TileCodec.h"
+
+namespace facebook::react {
+
+void UndoHistory::begin(const TileGrid& pixels, StepKind kind, uint64_t mark) {
+  if (physicsOpen_) {
+    physicsOpen_ = false;
+    if (kind == StepKind::Physics) {
+      return;
+    }
+    record(pixels, StepKind::Physics, physicsEndMark_);
+  }
+  if (!checkpoint_) {
+    // Holding the tiles makes the next write to each one detach a copy, which
+    // leaves the checkpoint with the before image
+    checkpoint_.emplace(pixels);
+    checkpointMark_ = mark;
+  }
+}
+
+void UndoHistory::commit(const TileGrid& pixels, StepKind kind, uint64_t mark) {
+  if (!checkpoint_) {
+    return;
+  }
+  if (kind == StepKind::Physics) {
+    physicsOpen_ = true;
+    physicsEndMark_ = mark;
+    return;
+  }
+  record(pixels, physicsOpen_ ? StepKind::Physics : kind, physicsOpen_ ? physicsEndMark_ : mark);
+  physicsOpen_ = false;
+}
+
+void UndoHistory::record(const TileGrid& pixels, StepKind kind, uint64_t endMark) {
+  Step step;
+  step.kind = kind;
+  step.marks = {checkpointMark_, endMark};
+  if (pixels.tileCount() == checkpoint_->tileCount()) {
+    for (int index : pixels.tilesChangedSince(checkpoint_->generation())) {
+      if (pixels.tile(index) != checkpoint_->tile(index)) {
+        step.tiles.push_back({index, checkpoint_->tileRef(index), {}});
+      }
+    }
+  }
+  checkpoint_.reset();
+  if (step.tiles.empty()) {
+    return;
+  }
+  
+  // A new step makes the undone ones unreachable
+  for (const auto& undone : redo_) {
+    bytes_ -= undone.bytes;
+  }
+  redo_.clear();
+  
+  step.bytes = stepBytes(step);
+  bytes_ += step.bytes;
+  if (kind == StepKind::Physics && !undo_.empty() && undo_.back().kind == StepKind::Physics) {
+    mergeInto(undo_.back(), std::move(step));
+  } else {
+    undo_.push_back(std::move(step));
+  }
+  enforceBudget();
+}
+
+bool UndoHistory::undo(TileGrid& pixels, std::vector<int>& restoredTiles, Marks& applied) {
+  if (undo_.empty()) {
+    return false;
+  }
+  Step step = std::move(undo_.back());
+  undo_.pop_back();
+  swapStep(step, pixels, restoredTiles);
+  applied = step.marks;
+  redo_.push_back(std::move(step));
+  enforceBudget();
+  return true;
+}
+
+bool UndoHistory::redo(TileGrid& pixels, std::vector<int>& restoredTiles, Marks& applied) {
+  if (redo_.empty()) {
+    return false;
+  }
+  Step step = std::move(redo_.back());
+  redo_.pop_back();
+  swapStep(step, pixels, restoredTiles);
+  applied = step.marks;
+  undo_.push_back(std::move(step));
+  enforceBudget();
+  return true;
+}
+
+void UndoHistory::setBudget(size_t bytes) {
+  budget_ = bytes;
+  enforceBudget();
+}
+
+void UndoHistory::reset() {
+  checkpoint_.reset();
+  physicsOpen_ = false;
+  undo_.clear();
+  redo_.clear();
+  bytes_ = 0;
+}
+
+size_t UndoHistory::savedBytes(const SavedTile& tile) {
+  return tile.pixels ? sizeof(PixelTile) : tile.packed.size();
+}
+
+size_t UndoHistory::stepBytes(const Step& step) {
+  size_t bytes = 0;
+  for (const auto& tile : step.tiles) {
+    bytes += savedBytes(tile);
+  }
+  return bytes;
+}
+
+void UndoHistory::compress(SavedTile& tile) {
+  if (!tile.pixels) {
+    return;
+  }
+  std::vector<uint8_t> packed;
+  compressTile(*tile.pixels, packed);
+  if (packed.size() >= sizeof(PixelTile)) {
+    return;
+  }
+  packed.shrink_to_fit();
+  tile.packed = std::move(packed);
+  tile.pixels.reset();
+}
+
+std::shared_ptr<PixelTile> UndoHistory::decompress(const SavedTile& tile) {
+  if (tile.pixels) {
+    return tile.pixels;
+  }
+  // Only ever fed compressTile output, so this cannot fail
+  auto pixels = std::make_shared<PixelTile>();
+  decompressTile(tile.packed.data(), tile.packed.size(), *pixels);
+  return pixels;
+}
+
+void UndoHistory::swapStep(Step& step, TileGrid& pixels, std::vector<int>& restoredTiles) {
+  bytes_ -= step.bytes;
+  for (auto& saved : step.tiles) {
+    saved.pixels = pixels.exchangeTile(saved.index, decompress(saved));
+    saved.packed = {};
+    restoredTiles.push_back(saved.index);
+  }
+  step.bytes = stepBytes(step);
+  step.compressed = false;
+  bytes_ += step.bytes;
+}
+
+void UndoHistory::mergeInto(Step& older, Step&& newer) {
+  // Where both touched a tile the older before image is the one to keep
+  std::vector<SavedTile> merged;
+  merged.reserve(older.tiles.size() + newer.tiles.size());
+  auto a = older.tiles.begin();
+  auto b = newer.tiles.begin();
+  while (a != older.tiles.end() || b != newer.tiles.end()) {
+    if (b == newer.tiles.end() || (a != older.tiles.end() && a->index <= b->index)) {
+      if (b != newer.tiles.end() && a->index == b->index) {
+        ++b;
+      }
+      merged.push_back(std::move(*a++));
+    } else {
+      merged.push_back(std::move(*b++));
+    }
+  }
+  older.tiles = std::move(merged);
+  older.marks.end = newer.marks.end;
+  older.compressed = false;
+  bytes_ -= older.bytes + newer.bytes;
+  older.bytes = stepBytes(older);
+  bytes_ += older.bytes;
+}
+
+void UndoHistory::enforceBudget() {
+  // Compress from the oldest undo step forward and then from the furthest
+  // redo step back; drop steps in the same order if that is not enough
+  auto compressStep = [this](Step& step) {
+    if (step.compressed) {
+      return;
+    }
+    for (auto& tile : step.tiles) {
+      compress(tile);
+    }
+    step.compressed = true;
+    bytes_ -= step.bytes;
+    step.bytes = stepBytes(step);
+    bytes_ += step.bytes;
+  };
+  for (auto step = undo_.begin(); bytes_ > budget_ && step != undo_.end(); ++step) {
+    compressStep(*step);
+  }
+  for (auto step = redo_.begin(); bytes_ > budget_ && step != redo_.end(); ++step) {
+    compressStep(*step);
+  }
+  while (bytes_ > budget_ && !undo_.empty()) {
+    bytes_ -= undo_.front().bytes;
+    undo_.pop_front();
+  }
+  while (bytes_ > budget_ && !redo_.empty()) {
+    bytes_ -= redo_.front().bytes;
+    redo_.erase(redo_.begin());
+  }
+}
+
+} // namespace facebook::react
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "TileGrid.h"
+
+namespace facebook::react {
+
+// Water left on the canvas by watercolor strokes, kept only for tiles that
+// are still wet. Each step spreads the water, lets pigment bleed wherever
+// it stands, and darkens a pixel's wet edge at the moment it dries, so
+// washes grow soft, spreading blooms with darker rims. Water reaching a
+// tile border wakes the tile next to it; a tile whose water has all
+// evaporated is dropped, so a step costs in proportion to the wet area.
+class WetPaint {
+public:
+  static constexpr uint8_t kEvaporation = 1; // Water lost per step; full water lasts 255 steps
+  static constexpr int kBleed = 64;          // Pigment pull at full water, out of 128
+
+  WetPaint(int width, int height);
+
+  // Everything dry, at new dimensions
+  void reset(int width, int height);
+  // Any tile still wet; safe to read from any thread
+  bool isWet() const { return wetTiles_.load(std::memory_order_relaxed) > 0; }
+
+  // Water for pixels x .. spanEnd(x) of row y, for strokes to raise.
+  // Rasterizing different tiles concurrently is safe.
+  uint8_t* mutableSpan(int x, int y);
+  // Dries a tile at once, without darkening (e.g. pixels restored by undo)
+  void dry(int tile);
+
+  // One step on the pixels of rows [top, top + height) of the grid (a
+  // layer plane); returns the number of pixels stepped
+  uint64_t step(TileGrid& pixels, int top);
+
+private:
+  static constexpr int kPadded = kTileSize + 2; // A tile with a one-pixel border
+
+  struct WetTile {
+    std::array<uint8_t, kTilePixels> water{};
+    std::array<uint8_t, kTilePixels> rim{}; // Sharpest wet edge so far (see diffuseWater)
+  };
+
+  // A tile's water and pixels with a one-pixel border, as they were before the step
+  struct PaddedTile {
+    std::array<uint8_t, kPadded * kPadded> water;
+    std::array<uint32_t, kPadded * kPadded> pixels;
+  };
+
+  WetTile& wake(int tile);
+  uint8_t waterAt(int x, int y) const;
+  void gatherTile(int tile, const TileGrid& pixels, int top, PaddedTile& padded) const;
+  uint64_t stepTile(int tile, const PaddedTile& padded, TileGrid& pixels, int top);
+  bool wetBorder(int tile) const;
+
+  int width_;
+  int height_;
+  int tilesX_;
+  int tilesY_;
+  std::vector<std::unique_ptr<WetTile>> tiles_; // Null where dry
+  std::atomic<int> wetTiles_{0};
+
+  // Scratch, reused between steps
+  std::vector<int> active_;
+  std::vector<PaddedTile> padded_; // One per active tile
+};
+
+} // namespace facebook::react
@@ -0,0 +1,83 @@
+#include "WorkerPool.h"
+#include <algorithm>
+
+namespace facebook::react {
+
+WorkerPool::WorkerPool(int threadCount) {
+  threadCount = std::max(threadCount, 1);
+  for (int i = 0; i < threadCount; ++i) {
+    threads_.emplace_back([this] { run(); });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void WorkerPool::post(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  condition_.notify_one();
+}
+
+void WorkerPool::parallelFor(int count, const std::function<void(int)>& body) {
+  if (count <= 1) {
+    if (count == 1) {
+      body(0);
+    }
+    return;
+  }
+  
+  struct Progress {
+    std::atomic<int> next{0};
+    std::atomic<int> done{0};
+  };
+  auto progress = std::make_shared<Progress>();
+  
+  // Helpers that start after all indices are claimed exit without touching body
+  auto work = [progress, &body, count] {
+    for (int i; (i = progress->next.fetch_add(1)) < count;) {
+      body(i);
+      if (progress->done.fetch_add(1, std::memory_order_acq_rel) + 1 == count) {
+        progress->done.notify_all();
+      }
+    }
+  };
+  
+  const int helpers = std::min(count - 1, static_cast<int>(threads_.size()));
+  for (int i = 0; i < helpers; ++i) {
+    post(work);
+  }
+  work();
+  
+  for (int done; (done = progress->done.load(std::memory_order_acquire)) < count;) {
+    progress->done.wait(done, std::memory_order_acquire);
+  }
+}
+
+void WorkerPool::run() {
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+} // namespace facebook::react
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace facebook::react {
+
+// Small fixed-size pool of background threads for work that must stay off
+// the JS thread (snapshot encoding, file IO). Pending tasks are drained
+// before the pool is destroyed.
+class WorkerPool {
+public:
+  explicit WorkerPool(int threadCount = 1);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  void post(std::function<void()> task);
+
+  // Runs body(0..count-1) across the pool and the calling thread, returning
+  // once every index has finished.
+  void parallelFor(int count, const std::function<void(int)>& body);
+  // Indices parallelFor can run at once: the pool plus the caller
+  int parallelism() const { return static_cast<int>(threads_.size()) + 1; }
+
+private:
+  void run();
+
+  std::vector<std::thread> threads_;
+  std::deque<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stopping_ = false;
+};
+
+} // namespace facebook::react
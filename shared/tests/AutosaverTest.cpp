@@ -0,0 +1,214 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Autosaver.h"
+#include "CanvasSession.h"
+#include "TestSupport.h"
+
+// Checkpoints land in the autosave file as the pixels change, and recovery
+// returns the newest complete one: a tail torn anywhere inside the last
+// record, or garbage after it, falls back to the checkpoint before. Enough
+// rewrites of the same tiles make the autosaver compact the file through an
+// atomic replace, and the compacted file recovers the same pixels.
+
+using namespace facebook::react;
+using namespace facebook::react::test;
+
+namespace {
+
+constexpr int kWidth = 500; // Edge tiles are partial
+constexpr int kHeight = 300;
+constexpr uint32_t kBackground = 0xFFFFFFFF;
+// Far more rewrites than compaction needs, so a missing one fails instead of hanging
+constexpr int kMaxRewrites = 40;
+constexpr auto kTimeout = std::chrono::seconds(10);
+
+uint64_t fileSize(const std::string& path) {
+  struct stat info;
+  return ::stat(path.c_str(), &info) == 0 ? static_cast<uint64_t>(info.st_size) : 0;
+}
+
+std::vector<uint8_t> readFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::vector<uint8_t>& bytes) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+// Pixels the autosaver captures; the session only stands in for the canvas.
+// They start as a copy of the session's, so their generation only moves
+// ahead of the session's and every interval captures.
+class Source {
+public:
+  explicit Source(const TileGrid& pixels) : pixels_(pixels) {}
+
+  // Noise barely compresses, so rewrites pile up garbage quickly
+  void scribble(Random& random, int tiles) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < tiles; ++i) {
+      uint32_t* tile = pixels_.mutableTile(random.range(0, pixels_.tileCount() - 1));
+      for (int p = 0; p < kTilePixels; ++p) {
+        tile[p] = random.next();
+      }
+    }
+  }
+
+  void rewriteAll(Random& random) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int index = 0; index < pixels_.tileCount(); ++index) {
+      uint32_t* tile = pixels_.mutableTile(index);
+      for (int p = 0; p < kTilePixels; ++p) {
+        tile[p] = random.next();
+      }
+    }
+  }
+
+  TileGrid capture() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pixels_;
+  }
+
+private:
+  std::mutex mutex_;
+  TileGrid pixels_;
+};
+
+bool recoversTo(const std::string& path, const TileGrid& expected) {
+  std::string error;
+  auto document = Autosaver::recover(path, error);
+  if (!document || document->width() != expected.width() || document->height() != expected.height()) {
+    return false;
+  }
+  TileGrid recovered(document->width(), document->height(),
+                     [document](int index) { return document->loadTile(index); });
+  for (int y = 0; y < expected.height(); ++y) {
+    for (int x = 0; x < expected.width(); ++x) {
+      if (recovered.pixel(x, y) != expected.pixel(x, y)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Until the file changes size, which it does once per checkpoint
+uint64_t waitForCheckpoint(const std::string& path, uint64_t previousSize) {
+  const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  while (std::chrono::steady_clock::now() < deadline) {
+    const uint64_t size = fileSize(path);
+    if (size != previousSize && size != 0) {
+      return size;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return previousSize;
+}
+
+void testTornTail(const std::string& path, const std::vector<uint8_t>& file, uint64_t previousSize,
+                  const TileGrid& previous, const TileGrid& latest) {
+  const std::string copy = path + ".torn";
+  Random random(11);
+  bool fallsBack = true;
+  for (int round = 0; round < 16; ++round) {
+    const uint64_t cut = previousSize + random.range(1, static_cast<int>(file.size() - previousSize) - 1);
+    writeFile(copy, std::vector<uint8_t>(file.begin(), file.begin() + static_cast<ptrdiff_t>(cut)));
+    fallsBack = fallsBack && recoversTo(copy, previous);
+  }
+  expect(fallsBack, "a torn last record recovers the checkpoint before it");
+
+  std::vector<uint8_t> flipped = file;
+  flipped[previousSize + (file.size() - previousSize) / 2] ^= 0x40;
+  writeFile(copy, flipped);
+  expect(recoversTo(copy, previous), "a corrupted last record recovers the checkpoint before it");
+
+  std::vector<uint8_t> extended = file;
+  for (int i = 0; i < 100; ++i) {
+    extended.push_back(static_cast<uint8_t>(random.next()));
+  }
+  writeFile(copy, extended);
+  expect(recoversTo(copy, latest), "garbage after the last record is ignored");
+
+  writeFile(copy, std::vector<uint8_t>(file.begin(), file.begin() + 10));
+  std::string error;
+  expect(!Autosaver::recover(copy, error), "a torn header recovers nothing");
+  ::unlink(copy.c_str());
+}
+
+} // namespace
+
+int main() {
+  const std::string path = "/tmp/AutosaverTest-" + std::to_string(::getpid()) + ".gca";
+  auto stats = std::make_shared<PerfStats>();
+  auto session = std::make_shared<CanvasSession>(1, kWidth, kHeight, kBackground, stats);
+  Source source(session->captureSnapshot());
+  Random random(5);
+  source.rewriteAll(random);
+
+  Autosaver autosaver(
+      [&source](std::shared_ptr<CanvasSession>, std::function<void(TileGrid)> onCapture) {
+        onCapture(source.capture());
+      },
+      stats);
+  std::mutex enabledMutex;
+  std::condition_variable enabledCondition;
+  bool enabled = false;
+  bool enabledOk = false;
+  autosaver.enable(session, path, Autosaver::kMinIntervalMs, [&](bool ok, const std::string&) {
+    std::lock_guard<std::mutex> lock(enabledMutex);
+    enabled = true;
+    enabledOk = ok;
+    enabledCondition.notify_one();
+  });
+  {
+    std::unique_lock<std::mutex> lock(enabledMutex);
+    enabledCondition.wait_for(lock, kTimeout, [&] { return enabled; });
+  }
+  expect(enabledOk, "the first checkpoint is written");
+  uint64_t size = fileSize(path);
+  TileGrid saved = source.capture();
+  expect(recoversTo(path, saved), "the first checkpoint recovers");
+
+  // Small checkpoints appended after the full one
+  for (int round = 0; round < 3; ++round) {
+    source.scribble(random, random.range(1, 5));
+    const uint64_t previousSize = size;
+    const TileGrid previous = saved;
+    size = waitForCheckpoint(path, size);
+    saved = source.capture();
+    expect(size > previousSize, "a change appends a checkpoint");
+    expect(recoversTo(path, saved), "the newest checkpoint recovers");
+    testTornTail(path, readFile(path), previousSize, previous, saved);
+  }
+
+  bool compacted = false;
+  for (int round = 0; round < kMaxRewrites && !compacted; ++round) {
+    source.rewriteAll(random);
+    const uint64_t previousSize = size;
+    size = waitForCheckpoint(path, size);
+    compacted = size < previousSize;
+  }
+  expect(compacted, "rewriting the same tiles compacts the file");
+  expect(recoversTo(path, source.capture()), "the compacted file recovers");
+  expect(fileSize(path + ".tmp") == 0, "compaction leaves no temporary file");
+
+  source.scribble(random, 3);
+  size = waitForCheckpoint(path, size);
+  expect(recoversTo(path, source.capture()), "checkpoints append to the compacted file");
+
+  autosaver.stop();
+  ::unlink(path.c_str());
+  return failures();
+}
@@ -0,0 +1,106 @@
+#include <cmath>
+#include <cstdlib>
+#include <queue>
+#include <vector>
+#include "Canvas.h"
+#include "TestSupport.h"
+#include "WorkerPool.h"
+
+// Canvas::floodFill against a plain 4-connected breadth-first fill, on
+// canvases whose sizes do not divide into tiles, with tolerances from none
+// to everything.
+
+using namespace facebook::react;
+using namespace facebook::react::test;
+
+namespace {
+
+constexpr uint32_t kFillColor = 0xFF12AB34;
+
+bool within(uint32_t a, uint32_t b, int tolerance) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    if (std::abs(static_cast<int>((a >> shift) & 0xFF) - static_cast<int>((b >> shift) & 0xFF)) > tolerance) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The pixels a fill from (x, y) has to reach
+std::vector<uint8_t> referenceFill(const TileGrid& pixels, int width, int height, int x, int y, int tolerance) {
+  const uint32_t seed = pixels.pixel(x, y);
+  std::vector<uint8_t> inside(static_cast<size_t>(width) * height, 0);
+  std::queue<int> open;
+  inside[y * width + x] = 1;
+  open.push(y * width + x);
+  while (!open.empty()) {
+    const int index = open.front();
+    open.pop();
+    const int px = index % width;
+    const int py = index / width;
+    const int neighbours[4][2] = {{px - 1, py}, {px + 1, py}, {px, py - 1}, {px, py + 1}};
+    for (const auto& [nx, ny] : neighbours) {
+      if (nx < 0 || ny < 0 || nx >= width || ny >= height) {
+        continue;
+      }
+      const int next = ny * width + nx;
+      if (!inside[next] && within(pixels.pixel(nx, ny), seed, tolerance)) {
+        inside[next] = 1;
+        open.push(next);
+      }
+    }
+  }
+  return inside;
+}
+
+// Random strokes, some of them watercolor for soft edges
+void scribble(Canvas& canvas, Random& random, int strokes) {
+  for (int i = 0; i < strokes; ++i) {
+    const BrushTexture texture = random.next() % 3 == 0 ? BrushTexture::Watercolor : BrushTexture::Normal;
+    canvas.applyStrokeLine(random.range(0, canvas.width()), random.range(0, canvas.height()),
+                           random.range(0, canvas.width()), random.range(0, canvas.height()),
+                           random.range(40, 100) / 100.0, random.range(3, 24), 0xFF000000u | random.next(), 0.9,
+                           texture);
+  }
+}
+
+void testFill(int width, int height, int tolerance, Random& random, WorkerPool& workers) {
+  Canvas canvas(width, height, 0xFFFFFFFF);
+  scribble(canvas, random, random.range(5, 60));
+  const TileGrid before = canvas.captureSnapshot();
+  const int x = random.range(0, width - 1);
+  const int y = random.range(0, height - 1);
+  const std::vector<uint8_t> inside = referenceFill(before, width, height, x, y, tolerance);
+
+  const uint64_t filled = canvas.floodFill(x, y, kFillColor, static_cast<uint8_t>(tolerance), workers);
+  const TileGrid after = canvas.captureSnapshot();
+  uint64_t expected = 0;
+  bool same = true;
+  for (int py = 0; py < height; ++py) {
+    for (int px = 0; px < width; ++px) {
+      const bool in = inside[py * width + px];
+      expected += in;
+      same = same && after.pixel(px, py) == (in ? kFillColor : before.pixel(px, py));
+    }
+  }
+  // A zero-tolerance fill with the color already there leaves everything
+  const bool noOp = tolerance == 0 && before.pixel(x, y) == kFillColor;
+  expect(same || noOp, "flood fill covers exactly the breadth-first region");
+  expect(filled == (noOp ? 0 : expected), "flood fill reports the pixels it filled");
+}
+
+} // namespace
+
+int main() {
+  WorkerPool workers(3);
+  Random random(7);
+  const int sizes[][2] = {{1, 1}, {63, 65}, {130, 70}, {200, 129}, {517, 301}};
+  for (const auto& [width, height] : sizes) {
+    for (int tolerance : {0, 1, 40, 128, 255}) {
+      for (int round = 0; round < 4; ++round) {
+        testFill(width, height, tolerance, random, workers);
+      }
+    }
+  }
+  return failures();
+}
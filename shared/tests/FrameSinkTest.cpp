@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "FrameSink.h"
+#include "TestSupport.h"
+
+// A producer publishes as fast as it can while a consumer thread acquires
+// frames the way a platform view does. Every tile of every frame is one
+// color recorded per sequence number, so a frame the consumer holds must
+// match its record exactly: a torn or half-copied frame shows up as a tile
+// of another frame's color. Also reports publish-to-acquire latency, and
+// checks that only one consumer attaches at a time and that attaching asks
+// for a frame.
+
+using namespace facebook::react;
+using namespace facebook::react::test;
+
+namespace {
+
+constexpr int kWidth = 300; // Edge tiles are partial
+constexpr int kHeight = 200;
+constexpr int kFrames = 3000;
+// Generous, since the test may share one core with everything else
+constexpr auto kMaxMedianLatency = std::chrono::milliseconds(50);
+
+// A consumer that shows frames without copying holds the previous one while
+// it takes the next, and the producer must not write into either
+void testHeldFrames() {
+  auto sink = std::make_shared<FrameSink>();
+  TileGrid pixels(kTileSize, kTileSize, 0);
+  auto publish = [&](uint32_t color) {
+    std::fill_n(pixels.mutableTile(0), kTilePixels, color);
+    sink->publish(pixels);
+  };
+  publish(1);
+  std::shared_ptr<const Frame> first = sink->acquireHeld();
+  publish(2);
+  std::shared_ptr<const Frame> second = sink->acquireHeld();
+  expect(first && second, "a held frame doesn't block taking the next one");
+  for (uint32_t color = 3; color <= 9; ++color) {
+    publish(color);
+  }
+  expect(!sink->acquireHeld(), "nothing newer is taken while two frames are held");
+  expect(first->pixels[0] == 1 && second->pixels[0] == 2, "held frames stay as published");
+  first.reset();
+  std::shared_ptr<const Frame> newest = sink->acquireHeld();
+  expect(newest && newest->pixels[0] == 9, "releasing a frame lets the newest one through");
+  expect(second->pixels[0] == 2, "the frame still held is untouched");
+}
+
+} // namespace
+
+int main() {
+  FrameSink sink;
+  int frameRequests = 0;
+  sink.setFrameRequestHandler([&frameRequests] { ++frameRequests; });
+  expect(sink.attachConsumer(), "the first consumer attaches");
+  expect(!sink.attachConsumer(), "a second consumer is turned away");
+  expect(frameRequests == 1, "attaching asks the producer for a frame");
+  TileGrid pixels(kWidth, kHeight, 0);
+  const int tiles = pixels.tileCount();
+  const int tilesX = pixels.tilesX();
+  // expected[sequence * tiles + tile]; written before the frame is published
+  std::vector<uint32_t> expected(static_cast<size_t>(kFrames + 1) * tiles, 0);
+  std::atomic<bool> producing{true};
+
+  std::thread producer([&] {
+    Random random(3);
+    std::vector<uint32_t> colors(tiles, 0);
+    for (uint64_t sequence = 1; sequence <= kFrames; ++sequence) {
+      // A few tiles per frame, so most publishes copy only part of the back buffer
+      const int changes = random.range(1, 4);
+      for (int change = 0; change < changes; ++change) {
+        const int tile = random.range(0, tiles - 1);
+        colors[tile] = static_cast<uint32_t>(sequence << 8 | tile);
+        std::fill_n(pixels.mutableTile(tile), kTilePixels, colors[tile]);
+      }
+      std::copy(colors.begin(), colors.end(), expected.begin() + sequence * tiles);
+      sink.publish(pixels);
+      if (sequence % 64 == 0) {
+        std::this_thread::yield();
+      }
+    }
+    producing.store(false, std::memory_order_release);
+  });
+
+  uint64_t lastSequence = 0;
+  int framesSeen = 0;
+  bool intact = true;
+  bool ordered = true;
+  std::vector<std::chrono::steady_clock::duration> latencies;
+  for (bool done = false; !done;) {
+    done = !producing.load(std::memory_order_acquire);
+    const Frame* frame = sink.acquireLatest();
+    if (!frame || frame->sequence == lastSequence) {
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      continue;
+    }
+    latencies.push_back(std::chrono::steady_clock::now() - frame->publishedAt);
+    ordered = ordered && frame->sequence > lastSequence;
+    lastSequence = frame->sequence;
+    ++framesSeen;
+    for (int y = 0; y < frame->height && intact; ++y) {
+      for (int x = 0; x < frame->width; ++x) {
+        const int tile = (y >> kTileShift) * tilesX + (x >> kTileShift);
+        if (frame->pixels[static_cast<size_t>(y) * frame->width + x] != expected[frame->sequence * tiles + tile]) {
+          intact = false;
+          break;
+        }
+      }
+    }
+  }
+  producer.join();
+  // The last acquire after the producer finished
+  const Frame* last = sink.acquireLatest();
+
+  expect(intact, "every acquired frame is exactly the one published");
+  expect(ordered, "frames arrive in publish order");
+  expect(last && last->sequence == kFrames, "the newest frame is the last one published");
+  expect(framesSeen > 1, "the consumer sees frames while the producer runs");
+  sink.detachConsumer();
+  expect(!sink.hasConsumer() && sink.attachConsumer(), "a consumer can attach once the last one detached");
+  expect(frameRequests == 2, "every attach asks for a frame");
+  testHeldFrames();
+  if (!latencies.empty()) {
+    std::sort(latencies.begin(), latencies.end());
+    const auto median = latencies[latencies.size() / 2];
+    const auto worst = latencies.back();
+    std::printf("%d frames acquired, latency median %.3f ms, max %.3f ms\n", framesSeen,
+                std::chrono::duration<double, std::milli>(median).count(),
+                std::chrono::duration<double, std::milli>(worst).count());
+    expect(median < kMaxMedianLatency, "median publish-to-acquire latency within bounds");
+  }
+  return failures();
+}
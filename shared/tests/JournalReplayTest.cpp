@@ -0,0 +1,257 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "BrushPreset.h"
+#include "BrushTextureAtlas.h"
+#include "CanvasSession.h"
+#include "TestSupport.h"
+#include "WorkerPool.h"
+
+// A journal replayed into a fresh session redraws the canvas bit for bit and
+// writes the same journal again. Journals of another version are refused
+// rather than replayed. A resize redraws only what is still on the canvas,
+// without motion or wet steps, so it matches a canvas drawn without them at
+// the new size and scale, including strokes drawn while the redraw ran.
+
+using namespace facebook::react;
+using namespace facebook::react::test;
+
+namespace {
+
+constexpr int kWidth = 300;
+constexpr int kHeight = 220;
+constexpr auto kTimeout = std::chrono::seconds(10);
+
+class Commands {
+public:
+  RenderCommand& push(RenderCommandType type, int strokeId = 0, double x = 0, double y = 0) {
+    auto command = std::make_unique<RenderCommand>();
+    command->type = type;
+    command->strokeId = strokeId;
+    command->point.x = x;
+    command->point.y = y;
+    command->point.pressure = 0.5 + 0.4 * std::sin(x * 0.37 + y * 0.11);
+    command->point.timestamp = static_cast<double>(commands_.size()) * 4.0;
+    commands_.push_back(std::move(command));
+    return *commands_.back();
+  }
+
+  void applyTo(CanvasSession& session, WorkerPool& workers) {
+    std::vector<RenderCommand*> pointers;
+    for (auto& command : commands_) {
+      pointers.push_back(command.get());
+    }
+    session.apply(pointers, workers, UINT64_MAX);
+    commands_.clear();
+  }
+
+private:
+  std::vector<std::unique_ptr<RenderCommand>> commands_;
+};
+
+std::vector<uint8_t> journalOf(CanvasSession& session, WorkerPool& workers) {
+  std::vector<uint8_t> journal;
+  Commands commands;
+  commands.push(RenderCommandType::CaptureJournal).onJournal = [&](std::vector<uint8_t> bytes) {
+    journal = std::move(bytes);
+  };
+  commands.applyTo(session, workers);
+  return journal;
+}
+
+bool samePixels(CanvasSession& a, CanvasSession& b) {
+  const TileGrid first = a.captureSnapshot();
+  const TileGrid second = b.captureSnapshot();
+  if (first.width() != second.width() || first.height() != second.height()) {
+    return false;
+  }
+  for (int y = 0; y < first.height(); ++y) {
+    for (int x = 0; x < first.width(); ++x) {
+      if (first.pixel(x, y) != second.pixel(x, y)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void stroke(Commands& commands, int strokeId, double x, double y, uint32_t color) {
+  BrushStyleData brush;
+  brush.size = 14;
+  brush.color = color;
+  commands.push(RenderCommandType::BeginStroke, strokeId, x, y).stroke =
+      std::make_shared<Stroke>(std::make_shared<BrushPreset>(brush));
+  for (int i = 1; i < 40; ++i) {
+    commands.push(RenderCommandType::AddPoint, strokeId, x + i * 3.1, y + i * 1.7);
+  }
+  commands.push(RenderCommandType::EndStroke, strokeId, x + 130, y + 70);
+}
+
+// Overlapping strokes of every texture, a registered tip image, layers and
+// a stroke taken back by undo. With simulate, also wet paint, motion, and a
+// fill and a clear that undo takes back, none of which a redraw keeps.
+void draw(CanvasSession& session, WorkerPool& workers, bool simulate) {
+  std::vector<uint8_t> tip(24 * 16);
+  for (size_t i = 0; i < tip.size(); ++i) {
+    tip[i] = static_cast<uint8_t>(i * 37);
+  }
+  BrushTextureAtlas::shared().set(BrushTexture::Normal, BrushImageKind::Tip,
+                                  std::make_shared<BrushImage>(24, 16, tip.data(), BrushImageKind::Tip));
+
+  Commands commands;
+  const BrushTexture textures[] = {BrushTexture::Normal, BrushTexture::Chalk, BrushTexture::Watercolor,
+                                   BrushTexture::Eraser};
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int s = 0; s < 4; ++s) {
+      BrushStyleData brush;
+      brush.texture = textures[s];
+      brush.size = 10 + s * 4;
+      brush.color = 0xFF000000u | (0x3A1F07u * (s + 1 + pass * 4));
+      brush.fluidResponse = 0.6;
+      commands.push(RenderCommandType::BeginStroke, s + 1, 20 + s * 60.3, 30.7 + pass * 90).stroke =
+          std::make_shared<Stroke>(std::make_shared<BrushPreset>(brush));
+    }
+    for (int i = 0; i < 90; ++i) {
+      for (int s = 0; s < 4; ++s) {
+        commands.push(RenderCommandType::AddPoint, s + 1, 20 + s * 60.3 + i * 1.9, 30.7 + pass * 90 + i * 0.83);
+      }
+    }
+    for (int s = 0; s < 4; ++s) {
+      commands.push(RenderCommandType::EndStroke, s + 1, 280, 200 - pass * 40);
+    }
+    if (simulate) {
+      RenderCommand& motion = commands.push(RenderCommandType::ApplyMotion);
+      motion.acceleration[0] = 0.3;
+      motion.acceleration[1] = -0.2;
+      for (int step = 0; step < 5; ++step) {
+        commands.push(RenderCommandType::WetStep);
+      }
+    }
+    if (pass == 0) {
+      commands.push(RenderCommandType::AddLayer);
+      commands.push(RenderCommandType::SetActiveLayer).layer = 1;
+      RenderCommand& properties = commands.push(RenderCommandType::SetLayerProperties);
+      properties.layer = 1;
+      properties.layerProperties.opacity = 180;
+      properties.layerProperties.blendMode = BlendMode::Multiply;
+    }
+  }
+  if (simulate) {
+    RenderCommand& fill = commands.push(RenderCommandType::Fill, 0, 150.3, 110.6);
+    fill.color = 0xFFFF8800;
+    fill.tolerance = 30;
+  }
+  stroke(commands, 9, 40.2, 20.5, 0xFF2060C0);
+  if (simulate) {
+    commands.push(RenderCommandType::Clear);
+    commands.push(RenderCommandType::Undo);
+  }
+  commands.push(RenderCommandType::Undo);
+  if (simulate) {
+    // The fill, then the last motion, which redo brings back
+    commands.push(RenderCommandType::Undo);
+    commands.push(RenderCommandType::Undo);
+    commands.push(RenderCommandType::Redo);
+  }
+  commands.applyTo(session, workers);
+}
+
+void resize(CanvasSession& session, WorkerPool& workers, int width, int height, double scale) {
+  Commands commands;
+  RenderCommand& resize = commands.push(RenderCommandType::Resize);
+  resize.width = width;
+  resize.height = height;
+  resize.scale = scale;
+  commands.applyTo(session, workers);
+}
+
+bool redrawn(CanvasSession& session) {
+  const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  while (session.isRedrawing() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  return !session.isRedrawing();
+}
+
+// A fresh session with the journal applied
+std::shared_ptr<CanvasSession> replay(const std::vector<uint8_t>& journal, int id,
+                                      const std::shared_ptr<PerfStats>& stats, WorkerPool& workers) {
+  JournalReader reader(journal.data(), journal.size());
+  JournalHeader header;
+  expect(reader.readHeader(header), "journal header reads back");
+  auto session = std::make_shared<CanvasSession>(id, header.width, header.height, header.backgroundColor, stats);
+  std::vector<std::unique_ptr<RenderCommand>> commands;
+  std::vector<RenderCommand*> pointers;
+  for (auto command = std::make_unique<RenderCommand>(); reader.next(*command);
+       command = std::make_unique<RenderCommand>()) {
+    pointers.push_back(command.get());
+    commands.push_back(std::move(command));
+  }
+  expect(!reader.failed(), "journal decodes without errors");
+  session->apply(pointers, workers, UINT64_MAX);
+  return session;
+}
+
+} // namespace
+
+int main() {
+  WorkerPool workers(3);
+  auto stats = std::make_shared<PerfStats>();
+  auto original = std::make_shared<CanvasSession>(1, kWidth, kHeight, 0xFFFFFFFF, stats);
+  draw(*original, workers, true);
+  const std::vector<uint8_t> journal = journalOf(*original, workers);
+  // What a redraw keeps, drawn directly
+  auto model = std::make_shared<CanvasSession>(3, kWidth, kHeight, 0xFFFFFFFF, stats);
+  draw(*model, workers, false);
+  auto unscaled = std::make_shared<CanvasSession>(5, kWidth, kHeight, 0xFFFFFFFF, stats);
+  draw(*unscaled, workers, false);
+
+  // Replay takes its images from the journal, not from what is registered now
+  const std::vector<uint8_t> flat(8 * 8, 9);
+  BrushTextureAtlas::shared().set(BrushTexture::Normal, BrushImageKind::Tip,
+                                  std::make_shared<BrushImage>(8, 8, flat.data(), BrushImageKind::Tip));
+  BrushTextureAtlas::shared().set(BrushTexture::Chalk, BrushImageKind::Grain, nullptr);
+
+  auto replayed = replay(journal, 2, stats, workers);
+  expect(samePixels(*original, *replayed), "replay redraws the canvas bit for bit");
+  expect(journalOf(*replayed, workers) == journal, "replay writes the same journal");
+
+  std::vector<uint8_t> older = journal;
+  const uint16_t olderVersion = CanvasJournal::kVersion - 1;
+  std::memcpy(older.data() + 4, &olderVersion, sizeof(olderVersion));
+  JournalReader olderReader(older.data(), older.size());
+  JournalHeader olderHeader;
+  expect(!olderReader.readHeader(olderHeader) && olderReader.unsupportedVersion(),
+         "a journal of an older version is refused");
+
+  auto resized = replay(journal, 4, stats, workers);
+  resize(*resized, workers, kWidth, kHeight, 1.0);
+  expect(redrawn(*resized), "a redraw lands");
+  expect(samePixels(*model, *resized), "a same-size resize redraws only what is still on the canvas");
+  
+  resize(*resized, workers, kWidth * 2, kHeight * 2, 2.0);
+  const TileGrid preview = resized->captureSnapshot();
+  expect(preview.width() == kWidth * 2 && preview.height() == kHeight * 2,
+         "a resize takes the new size before its redraw lands");
+  resize(*model, workers, kWidth * 2, kHeight * 2, 2.0);
+  expect(redrawn(*resized) && redrawn(*model), "redraws at a new scale land");
+  expect(samePixels(*model, *resized), "a resize redraws at the new scale");
+  
+  resize(*resized, workers, kWidth, kHeight, 1.0);
+  expect(redrawn(*resized), "a redraw back at the first scale lands");
+  expect(samePixels(*unscaled, *resized), "resizing back redraws the pixels at the first scale");
+  
+  // Drawn over the stand-in, then again into the redraw before it lands
+  resize(*resized, workers, kWidth, kHeight, 1.0);
+  Commands commands;
+  stroke(commands, 1, 60.5, 150.25, 0xFF10A040);
+  commands.applyTo(*resized, workers);
+  stroke(commands, 1, 60.5, 150.25, 0xFF10A040);
+  commands.applyTo(*unscaled, workers);
+  expect(redrawn(*resized), "a redraw lands while strokes come in");
+  expect(samePixels(*unscaled, *resized), "strokes drawn during a redraw stay on the canvas");
+  return failures();
+}
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <vector>
+#include "BlendKernels.h"
+#include "PixelKernels.h"
+#include "TestSupport.h"
+
+// Every kernel works pixel by pixel, and a span of one is always finished
+// by the scalar tail, so running a span one pixel at a time gives the scalar
+// result to hold the NEON/SSE2 path against. Lengths cover every remainder
+// of the vector widths.
+
+using namespace facebook::react;
+using namespace facebook::react::test;
+
+namespace {
+
+constexpr int kRounds = 400;
+constexpr int kMaxCount = 67;
+
+constexpr BlendMode kModes[] = {
+    BlendMode::Normal, BlendMode::Multiply, BlendMode::Screen, BlendMode::Overlay,
+    BlendMode::Darken, BlendMode::Lighten, BlendMode::Additive, BlendMode::Erase,
+};
+
+// Channels biased towards 0, 128 and 255, where rounding and clamping go wrong
+uint8_t channel(Random& random) {
+  switch (random.next() % 4) {
+    case 0:
+      return static_cast<uint8_t>(random.range(0, 2) * 127 + random.range(0, 1));
+    default:
+      return static_cast<uint8_t>(random.next());
+  }
+}
+
+uint32_t pixel(Random& random) {
+  uint32_t result = 0;
+  for (int shift = 0; shift < 32; shift += 8) {
+    result |= static_cast<uint32_t>(channel(random)) << shift;
+  }
+  return result;
+}
+
+std::vector<uint32_t> pixels(Random& random, int count) {
+  std::vector<uint32_t> result(count);
+  for (auto& value : result) {
+    value = pixel(random);
+  }
+  return result;
+}
+
+std::vector<uint8_t> bytes(Random& random, int count) {
+  std::vector<uint8_t> result(count);
+  for (auto& value : result) {
+    value = channel(random);
+  }
+  return result;
+}
+
+// count weights of at least 0 summing to kFilterOne
+std::vector<int16_t> filterWeights(Random& random, int count) {
+  std::vector<int16_t> weights(count, 0);
+  int left = kFilterOne;
+  for (int k = 0; k + 1 < count; ++k) {
+    weights[k] = static_cast<int16_t>(random.range(0, left));
+    left -= weights[k];
+  }
+  weights[count - 1] = static_cast<int16_t>(left);
+  return weights;
+}
+
+void testBlendSpans(Random& random) {
+  for (BlendMode mode : kModes) {
+    for (int round = 0; round < kRounds; ++round) {
+      const int count = random.range(1, kMaxCount);
+      const std::vector<uint32_t> below = pixels(random, count);
+      const std::vector<uint32_t> above = pixels(random, count);
+      const std::vector<uint8_t> coverage = bytes(random, count);
+      const uint32_t color = pixel(random);
+      const uint8_t opacity = channel(random);
+
+      std::vector<uint32_t> span = below;
+      std::vector<uint32_t> single = below;
+      colorSpanKernel(mode)(span.data(), color, coverage.data(), count);
+      for (int i = 0; i < count; ++i) {
+        colorSpanKernel(mode)(single.data() + i, color, coverage.data() + i, 1);
+      }
+      expect(span == single, "colorSpanKernel matches its scalar path");
+
+      span = below;
+      single = below;
+      layerSpanKernel(mode)(span.data(), above.data(), count, opacity);
+      for (int i = 0; i < count; ++i) {
+        layerSpanKernel(mode)(single.data() + i, above.data() + i, 1, opacity);
+      }
+      expect(span == single, "layerSpanKernel matches its scalar path");
+    }
+  }
+}
+
+void testDownsample(Random& random) {
+  for (int round = 0; round < kRounds; ++round) {
+    const int count = random.range(1, kMaxCount);
+    const std::vector<uint32_t> row0 = pixels(random, count * 2);
+    const std::vector<uint32_t> row1 = pixels(random, count * 2);
+    std::vector<uint32_t> span(count);
+    std::vector<uint32_t> single(count);
+    downsample2x2(row0.data(), row1.data(), span.data(), count);
+    for (int i = 0; i < count; ++i) {
+      downsample2x2(row0.data() + i * 2, row1.data() + i * 2, single.data() + i, 1);
+    }
+    expect(span == single, "downsample2x2 matches its scalar path");
+  }
+}
+
+void testFilters(Random& random) {
+  for (int round = 0; round < kRounds; ++round) {
+    const int count = random.range(1, kMaxCount);
+    const int taps = random.range(1, 8);
+    const std::vector<uint32_t> source = pixels(random, count + taps + 16);
+
+    std::vector<int> starts(count);
+    std::vector<int16_t> weights;
+    for (int i = 0; i < count; ++i) {
+      starts[i] = random.range(0, static_cast<int>(source.size()) - taps);
+      const std::vector<int16_t> own = filterWeights(random, taps);
+      weights.insert(weights.end(), own.begin(), own.end());
+    }
+    std::vector<uint32_t> span(count);
+    std::vector<uint32_t> single(count);
+    filterRow(source.data(), span.data(), count, starts.data(), weights.data(), taps);
+    for (int i = 0; i < count; ++i) {
+      filterRow(source.data(), single.data() + i, 1, starts.data() + i, weights.data() + i * taps, taps);
+    }
+    expect(span == single, "filterRow matches its scalar path");
+
+    std::vector<std::vector<uint32_t>> rows(taps);
+    std::vector<const uint32_t*> rowPointers(taps);
+    for (int k = 0; k < taps; ++k) {
+      rows[k] = pixels(random, count);
+      rowPointers[k] = rows[k].data();
+    }
+    const std::vector<int16_t> columnWeights = filterWeights(random, taps);
+    filterColumns(rowPointers.data(), columnWeights.data(), taps, span.data(), count);
+    for (int i = 0; i < count; ++i) {
+      std::vector<const uint32_t*> shifted(taps);
+      for (int k = 0; k < taps; ++k) {
+        shifted[k] = rowPointers[k] + i;
+      }
+      filterColumns(shifted.data(), columnWeights.data(), taps, single.data() + i, 1);
+    }
+    expect(span == single, "filterColumns matches its scalar path");
+  }
+}
+
+void testWetStencils(Random& random) {
+  for (int round = 0; round < kRounds; ++round) {
+    const int count = random.range(1, kMaxCount);
+    // One pixel either side, which the stencils read
+    const std::vector<uint8_t> water = bytes(random, count + 2);
+    const std::vector<uint8_t> waterAbove = bytes(random, count + 2);
+    const std::vector<uint8_t> waterBelow = bytes(random, count + 2);
+    const std::vector<uint8_t> rim = bytes(random, count);
+    const uint8_t evaporation = static_cast<uint8_t>(random.range(0, 3));
+
+    std::vector<uint8_t> span(count);
+    std::vector<uint8_t> single(count);
+    std::vector<uint8_t> spanRim = rim;
+    std::vector<uint8_t> singleRim = rim;
+    diffuseWater(waterAbove.data() + 1, water.data() + 1, waterBelow.data() + 1, span.data(), spanRim.data(),
+                 count, evaporation);
+    for (int i = 0; i < count; ++i) {
+      diffuseWater(waterAbove.data() + 1 + i, water.data() + 1 + i, waterBelow.data() + 1 + i, single.data() + i,
+                   singleRim.data() + i, 1, evaporation);
+    }
+    expect(span == single && spanRim == singleRim, "diffuseWater matches its scalar path");
+
+    const std::vector<uint32_t> row = pixels(random, count + 2);
+    const std::vector<uint32_t> above = pixels(random, count + 2);
+    const std::vector<uint32_t> below = pixels(random, count + 2);
+    const int bleed = random.range(0, 128);
+    std::vector<uint32_t> spanPixels(count);
+    std::vector<uint32_t> singlePixels(count);
+    diffusePigment(above.data() + 1, row.data() + 1, below.data() + 1, water.data() + 1, bleed, spanPixels.data(),
+                   count);
+    for (int i = 0; i < count; ++i) {
+      diffusePigment(above.data() + 1 + i, row.data() + 1 + i, below.data() + 1 + i, water.data() + 1 + i, bleed,
+                     singlePixels.data() + i, 1);
+    }
+    expect(spanPixels == singlePixels, "diffusePigment matches its scalar path");
+  }
+}
+
+void testMatchColor(Random& random) {
+  for (int round = 0; round < kRounds; ++round) {
+    const int count = random.range(1, 64);
+    const uint32_t color = pixel(random);
+    const uint8_t tolerance = static_cast<uint8_t>(random.next() % 3 == 0 ? 0 : random.range(0, 255));
+    // Mostly near the color, so both sides of the tolerance come up
+    std::vector<uint32_t> source(count);
+    for (auto& value : source) {
+      value = color;
+      for (int shift = 0; shift < 32; shift += 8) {
+        const int moved = std::clamp(static_cast<int>((color >> shift) & 0xFF) + random.range(-tolerance - 1, tolerance + 1), 0, 255);
+        value = (value & ~(0xFFu << shift)) | static_cast<uint32_t>(moved) << shift;
+      }
+    }
+    const uint64_t span = matchColor(source.data(), count, color, tolerance);
+    uint64_t single = 0;
+    for (int i = 0; i < count; ++i) {
+      single |= matchColor(source.data() + i, 1, color, tolerance) << i;
+    }
+    expect(span == single, "matchColor matches its scalar path");
+  }
+}
+
+} // namespace
+
+int main() {
+  Random random(1);
+  testBlendSpans(random);
+  testDownsample(random);
+  testFilters(random);
+  testWetStencils(random);
+  testMatchColor(random);
+  return failures();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+namespace facebook::react::test {
+
+// Failed expectations are printed and counted; a test's main returns the count
+inline int& failures() {
+  static int count = 0;
+  return count;
+}
+
+inline bool expect(bool ok, const char* what) {
+  if (!ok) {
+    std::fprintf(stderr, "FAILED: %s\n", what);
+    ++failures();
+  }
+  return ok;
+}
+
+// Repeatable inputs, so a failure reproduces on every run
+class Random {
+public:
+  explicit Random(uint64_t seed) : state_(seed * 0x9E3779B97F4A7C15ull + 1) {}
+
+  uint32_t next() {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 7;
+    state_ ^= state_ << 17;
+    return static_cast<uint32_t>(state_ >> 32);
+  }
+  // In [low, high]
+  int range(int low, int high) { return low + static_cast<int>(next() % static_cast<uint32_t>(high - low + 1)); }
+
+private:
+  uint64_t state_;
+};
+
+} // namespace facebook::react::test
@@ -11,7 +11,7 @@ export interface BrushStyle {
   size: number;
   opacity: number;
   color: string;
-  texture: string;
+  texture: string; // "normal", "chalk", "watercolor" or "eraser" (ignores color)
   dampening: number;
   fluidResponse: number;
 }
@@ -26,17 +26,77 @@ export interface Spec extends TurboModule {
   // Canvas management
   createCanvas: (config: CanvasConfig) => number; // Returns canvas ID
   destroyCanvas: (canvasId: number) => void;
+  createCanvasHandle: (config: CanvasConfig) => Object; // See utils/canvasHandles.ts
+  createGestureInput: (canvasId: number, brushStyle: Object) => Object; // UI-thread stroke input
   clearCanvas: (canvasId: number) => void;
+  // Paint bucket on the active layer: fills the connected pixels within
+  // tolerance (0-1, per channel) of the one at (x, y)
+  floodFill: (
+    canvasId: number,
+    x: number,
+    y: number,
+    color: string,
+    tolerance: number,
+  ) => void;
 
-  // Stroke handling
+  // Stroke handling. Brush styles may be a BrushStyle or a handle returned by
+  // registerBrushStyle, which parses and pre-bakes the style once.
+  registerBrushStyle: (brushStyle: BrushStyle) => Object;
+  // Grayscale image for a texture's tip (stretched over each dab) or grain
+  // (tiled over the canvas); pixels is an ArrayBuffer or Uint8Array of
+  // width * height bytes. Applies to brush styles resolved afterwards.
+  registerBrushTexture: (
+    texture: string,
+    kind: string, // "tip" or "grain"
+    width: number,
+    height: number,
+    pixels: Object,
+  ) => void;
   beginStroke: (
     canvasId: number,
     point: Point,
-    brushStyle: BrushStyle,
+    brushStyle: Object, // BrushStyle | BrushStyleHandle
   ) => number; // Returns stroke ID
   addPointToStroke: (canvasId: number, strokeId: number, point: Point) => void;
   endStroke: (canvasId: number, strokeId: number, point: Point) => void;
 
+  // History: undoes the last stroke group, clear or run of physics steps
+  undo: (canvasId: number) => void;
+  redo: (canvasId: number) => void;
+  setUndoBudget: (canvasId: number, bytes: number) => void; // Default 64 MB
+
+  // Redraws the canvas from its strokes and fills at a new size, e.g. on
+  // rotation, in the background; a filtered copy shows until it lands.
+  // Motion and wet-paint drying aren't redrawn. Points and brush sizes that
+  // follow are in pixels at `scale`.
+  setCanvasSize: (
+    canvasId: number,
+    width: number,
+    height: number,
+    scale: number,
+  ) => void;
+  resizeCanvas: (
+    canvasId: number,
+    width: number,
+    height: number,
+    mode: string, // 'crop' | 'bilinear' | 'area'; keeps pixels, not strokes
+  ) => void;
+
+  // Layers: 0 is the base layer and each added layer goes on top (up to 8).
+  // Strokes draw into the active layer and motion only moves the wet one.
+  addLayer: (canvasId: number) => void;
+  setLayerProperties: (
+    canvasId: number,
+    layer: number,
+    opacity: number, // 0-1
+    visible: boolean,
+    // 'normal' | 'multiply' | 'screen' | 'overlay' | 'darken' | 'lighten' |
+    // 'additive' | 'erase' (shows the background through the layer's paint)
+    blendMode: string,
+  ) => void;
+  setActiveLayer: (canvasId: number, layer: number) => void;
+  setWetLayer: (canvasId: number, layer: number) => void;
+
   // Motion impact (for physics-based effects)
   applyMotionToCanvas: (
     canvasId: number,
@@ -47,9 +107,40 @@ export interface Spec extends TurboModule {
 
   // Canvas rendering
   getCanvasSnapshot: (canvasId: number) => string; // Returns base64 encoded image
+  getCanvasSnapshotAsync: (canvasId: number) => Promise<string>; // Encodes off the JS thread
+  getCanvasThumbnail: (canvasId: number, maxWidth: number) => string; // Nearest mip level
+  exportCanvasToFile: (
+    canvasId: number,
+    path: string,
+    format: string, // 'bmp' | 'raw'
+  ) => Promise<string>; // Resolves with the written path
+  exportCanvasJournal: (canvasId: number, path: string) => Promise<string>;
+  replayCanvasJournal: (path: string) => Promise<number>; // New canvas ID
+  saveCanvasToFile: (
+    canvasId: number,
+    path: string,
+    includeJournal: boolean,
+  ) => Promise<string>; // Native document; resolves with the written path
+  openCanvasFromFile: (path: string) => Promise<number>; // New canvas ID
+  enableAutosave: (
+    canvasId: number,
+    path: string,
+    intervalMs: number,
+  ) => Promise<string>; // Resolves once the first checkpoint is written
+  disableAutosave: (canvasId: number) => void;
+  recoverCanvasFromAutosave: (path: string) => Promise<number>; // New canvas ID
 
   // Performance metrics
   getAverageRenderTime: () => number;
+  getPerformanceReport: () => Object; // See utils/performanceReport.ts
+  configureFrameScheduler: (
+    mode: string, // 'immediate' (default) | 'native' | 'manual' | 'display' (iOS canvas views' display link)
+    framesPerSecond: number,
+  ) => void; // Wet watercolor dries one step per frame; 'immediate' only has frames while commands arrive
+  tick: () => void; // Frame tick in 'manual' mode (e.g. from a display link)
+  setRenderListener: (
+    listener: (commandCount: number, renderTimeMs: number) => void,
+  ) => void; // Called after each batch the native render thread applies
 }
 
 export default TurboModuleRegistry.getEnforcing<Spec>('NativeGestureCanvas');
@@ -0,0 +1,60 @@
+import NativeGestureCanvas, {
+  BrushStyle,
+  CanvasConfig,
+  Point,
+} from '../specs/NativeGestureCanvas';
+
+// Shapes of the host objects returned by the native module. Calls through a
+// handle go straight to the native canvas/stroke without id lookups.
+
+// Opaque, pre-resolved brush style from registerBrushStyle. Accepted anywhere
+// a BrushStyle is.
+export interface BrushStyleHandle {
+  readonly __brand: 'BrushStyleHandle';
+}
+
+export type BrushStyleInput = BrushStyle | BrushStyleHandle;
+
+export const registerBrushStyle = (brushStyle: BrushStyle): BrushStyleHandle =>
+  NativeGestureCanvas.registerBrushStyle(brushStyle) as BrushStyleHandle;
+export interface StrokeHandle {
+  readonly id: number;
+  addPoint(point: Point): void;
+  end(point: Point): void;
+  dispose(): void; // Drops the stroke without a final point
+}
+
+export interface CanvasHandle {
+  readonly id: number; // Usable with the id-based module methods
+  beginStroke(point: Point, brushStyle: BrushStyleInput): StrokeHandle | null;
+  clear(): void;
+  undo(): void;
+  redo(): void;
+  applyMotion(
+    accelerationX: number,
+    accelerationY: number,
+    accelerationZ: number,
+  ): void;
+  setSize(width: number, height: number, scale?: number): void; // Redraws at the new size
+  getSnapshot(): string;
+  dispose(): void;
+}
+
+export const createCanvasHandle = (config: CanvasConfig): CanvasHandle =>
+  NativeGestureCanvas.createCanvasHandle(config) as CanvasHandle;
+
+// Fed from gesture worklets on the UI thread; capture it in the worklet and
+// call begin/addPoint/end directly. All three must come from the same thread.
+export interface GestureInput {
+  begin(x: number, y: number, pressure: number, timestamp: number): void;
+  addPoint(x: number, y: number, pressure: number, timestamp: number): void;
+  end(x: number, y: number, pressure: number, timestamp: number): void;
+  setBrushStyle(brushStyle: BrushStyleInput): void; // Applies to the next stroke; plain styles on the JS thread only
+  dispose(): void; // Cancels strokes in progress; later input is dropped
+}
+
+export const createGestureInput = (
+  canvasId: number,
+  brushStyle: BrushStyleInput,
+): GestureInput =>
+  NativeGestureCanvas.createGestureInput(canvasId, brushStyle) as GestureInput;
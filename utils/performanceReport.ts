@@ -0,0 +1,30 @@
+import NativeGestureCanvas from '../specs/NativeGestureCanvas';
+
+// Latency percentiles for one native operation; times are in milliseconds
+export interface OperationStats {
+  count: number;
+  p50: number;
+  p95: number;
+  p99: number;
+  max: number;
+  mean: number;
+  pixels: number; // Total pixels touched
+  pixelsPerOp: number;
+}
+
+export interface PerformanceReport {
+  pointIngest: OperationStats; // Submit to render-thread pickup
+  strokeRaster: OperationStats;
+  physicsStep: OperationStats;
+  snapshotEncode: OperationStats;
+  jsiMarshal: OperationStats;
+  autosave: OperationStats; // One checkpoint, off the render thread
+  rerasterize: OperationStats; // Redrawing a canvas after a resize
+  resample: OperationStats; // resizeCanvas
+  wetStep: OperationStats; // Watercolor spreading and drying, once per frame while wet
+  floodFill: OperationStats; // floodFill
+  shedSegments: number; // Segments drawn without texture noise to make a frame
+}
+
+export const getPerformanceReport = (): PerformanceReport =>
+  NativeGestureCanvas.getPerformanceReport() as PerformanceReport;